@@ -0,0 +1,229 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Measure GDB remote protocol round trip times against a running OpenOCD
+ * gdb server, as the counterpart of tcl/tools/benchmark.tcl.
+ *
+ * Connects like GDB would, then times "g" (read all registers), "m" (read
+ * memory) and "X" (binary memory write) packets of the given size.  Results
+ * are printed in the same "BENCH {json}" line format as the Tcl benchmarks.
+ *
+ * The target must be halted and the memory range writable RAM.
+ *
+ * Build:  cc -O2 -o gdb_rsp_bench gdb_rsp_bench.c
+ * Usage:  gdb_rsp_bench [-h host] [-p port] [-n iterations] address length
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#define MAX_PACKET 16384
+
+static int sock = -1;
+static char reply[MAX_PACKET * 2 + 16];
+
+static double now_ms(void)
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static int read_byte(void)
+{
+	unsigned char c;
+	ssize_t n = read(sock, &c, 1);
+	if (n != 1) {
+		fprintf(stderr, "connection lost: %s\n", n < 0 ? strerror(errno) : "EOF");
+		exit(1);
+	}
+	return c;
+}
+
+static void write_all(const void *buf, size_t len)
+{
+	const char *p = buf;
+	while (len) {
+		ssize_t n = write(sock, p, len);
+		if (n <= 0) {
+			fprintf(stderr, "write failed: %s\n", strerror(errno));
+			exit(1);
+		}
+		p += n;
+		len -= n;
+	}
+}
+
+/* send one packet, wait for the ack and return the reply payload length */
+static size_t transact(const char *payload, size_t len)
+{
+	static char frame[MAX_PACKET * 2 + 16];
+	unsigned char sum = 0;
+
+	frame[0] = '$';
+	memcpy(frame + 1, payload, len);
+	for (size_t i = 0; i < len; i++)
+		sum += (unsigned char)payload[i];
+	snprintf(frame + 1 + len, 4, "#%02x", sum);
+	write_all(frame, len + 4);
+
+	if (read_byte() != '+') {
+		fprintf(stderr, "packet not acknowledged\n");
+		exit(1);
+	}
+
+	/* skip anything (e.g. console output) up to the start of the reply */
+	while (read_byte() != '$')
+		;
+
+	size_t n = 0;
+	for (;;) {
+		int c = read_byte();
+		if (c == '#')
+			break;
+		if (n < sizeof(reply) - 1)
+			reply[n++] = c;
+	}
+	read_byte();
+	read_byte();
+	write_all("+", 1);
+
+	reply[n] = '\0';
+	return n;
+}
+
+static void emit(const char *name, unsigned bytes, unsigned iterations, double ms)
+{
+	double per = ms / iterations;
+	printf("BENCH {\"bench\":\"%s\",\"bytes\":%u,\"iterations\":%u,\"ms\":%.3f",
+			name, bytes, iterations, per);
+	if (bytes && per > 0)
+		printf(",\"kbps\":%.1f", bytes / 1.024 / per);
+	printf("}\n");
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-h host] [-p port] [-n iterations] address length\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	const char *host = "localhost";
+	const char *port = "3333";
+	unsigned iterations = 100;
+	int c;
+
+	while ((c = getopt(argc, argv, "h:p:n:")) != -1) {
+		switch (c) {
+			case 'h':
+				host = optarg;
+				break;
+			case 'p':
+				port = optarg;
+				break;
+			case 'n':
+				iterations = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (argc - optind != 2 || iterations == 0)
+		usage(argv[0]);
+
+	unsigned long address = strtoul(argv[optind], NULL, 0);
+	unsigned length = strtoul(argv[optind + 1], NULL, 0);
+	if (length == 0 || length > MAX_PACKET / 2 - 64) {
+		fprintf(stderr, "length must be between 1 and %d\n", MAX_PACKET / 2 - 64);
+		return 1;
+	}
+
+	struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+	struct addrinfo *res;
+	int err = getaddrinfo(host, port, &hints, &res);
+	if (err) {
+		fprintf(stderr, "%s: %s\n", host, gai_strerror(err));
+		return 1;
+	}
+	for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+		sock = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (sock >= 0 && connect(sock, ai->ai_addr, ai->ai_addrlen) == 0)
+			break;
+		if (sock >= 0)
+			close(sock);
+		sock = -1;
+	}
+	freeaddrinfo(res);
+	if (sock < 0) {
+		fprintf(stderr, "cannot connect to %s:%s\n", host, port);
+		return 1;
+	}
+
+	/* like GDB, don't let Nagle's algorithm delay the small packets */
+	int one = 1;
+	setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	char packet[MAX_PACKET];
+	double start;
+	size_t n;
+
+	/* the first packets after connecting pay for the attach, keep them out */
+	transact("?", 1);
+
+	start = now_ms();
+	for (unsigned i = 0; i < iterations; i++)
+		transact("g", 1);
+	emit("gdb_g", 0, iterations, now_ms() - start);
+
+	n = snprintf(packet, sizeof(packet), "m%lx,%x", address, length);
+	start = now_ms();
+	for (unsigned i = 0; i < iterations; i++) {
+		if (transact(packet, n) != 2 * length) {
+			fprintf(stderr, "m packet failed: %s\n", reply);
+			return 1;
+		}
+	}
+	emit("gdb_m", length, iterations, now_ms() - start);
+
+	/* payload bytes never need escaping: avoid '#', '$', '}' and '*' */
+	n = snprintf(packet, sizeof(packet), "X%lx,%x:", address, length);
+	for (unsigned i = 0; i < length; i++)
+		packet[n++] = 0x40 + (i % 0x20);
+	start = now_ms();
+	for (unsigned i = 0; i < iterations; i++) {
+		transact(packet, n);
+		if (strcmp(reply, "OK")) {
+			fprintf(stderr, "X packet failed: %s\n", reply);
+			return 1;
+		}
+	}
+	emit("gdb_X", length, iterations, now_ms() - start);
+
+	/* detach, as GDB would when quitting */
+	transact("D", 1);
+	close(sock);
+	return 0;
+}
@@ -19,8 +19,9 @@
  ***************************************************************************/
 
 /*
-	r0 - address in - crc out
-	r1 - char count
+	r0 - address of a list of (address, char count) word pairs, each
+	     address is replaced by the crc of its region
+	r1 - number of pairs
 */
 
 	.text
@@ -28,14 +29,20 @@
 
 _start:
 main:
-	mov		r2, r0
+	mov		r8, r0
+	mov		r9, r1
+	ldr		r7, CRC32XOR
+next:
+	cmp		r9, #0
+	beq		end
+	sub		r9, r9, #1
+	ldr		r2, [r8]
+	ldr		r3, [r8, #4]
 	mov		r0, #0xffffffff	/* crc */
-	mov		r3, r1
 	mov		r4, #0
 	b		ncomp
 nbyte:
 	ldrb	r1, [r2, r4]
-	ldr		r7, CRC32XOR
 	eor		r0, r0, r1, asl #24
 	mov		r5, #0
 loop:
@@ -50,6 +57,8 @@ loop:
 ncomp:
 	cmp		r4, r3
 	bne		nbyte
+	str		r0, [r8], #8
+	b		next
 end:
 	bkpt	#0
 
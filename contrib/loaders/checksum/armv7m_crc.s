@@ -20,8 +20,9 @@
 
 /*
 	parameters:
-	r0 - address in - crc out
-	r1 - char count
+	r0 - address of a list of (address, char count) word pairs, each
+	     address is replaced by the crc of its region
+	r1 - number of pairs
 */
 
 	.text
@@ -34,11 +35,19 @@
 
 _start:
 main:
-	mov		r2, r0
+	mov		r7, r0
+	mov		ip, r1
+	ldr		r6, CRC32XOR
+next:
+	mov		r1, ip
+	cmp		r1, #0
+	beq		done
+	subs	r1, #1
+	mov		ip, r1
+	ldr		r2, [r7, #0]
+	ldr		r3, [r7, #4]
 	movs	r0, #0
 	mvns	r0, r0
-	ldr		r6, CRC32XOR
-	mov		r3, r1
 	movs	r4, #0
 	b		ncomp
 nbyte:
@@ -55,13 +64,17 @@ loop:
 notset:
 	lsls	r0, r0, #1
 cont:
-	adds	r5, r5, #1
+	adds	r5, #1
 	cmp		r5, #8
 	bne		loop
-	adds	r4, r4, #1
+	adds	r4, #1
 ncomp:
 	cmp		r4, r3
 	bne		nbyte
+	str		r0, [r7, #0]
+	adds	r7, #8
+	b		next
+done:
 	bkpt	#0
 
 	.align	2
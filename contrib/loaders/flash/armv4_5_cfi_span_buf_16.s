@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+	.text
+	.syntax unified
+	.arch armv4t
+	.arm
+
+	.align 2
+
+/* Spansion write buffer programming, one write buffer page per fifo block.
+ * The fifo follows the target_run_flash_async_algorithm() layout: write
+ * pointer at [r0], read pointer at [r0, #4], data from r0 + 8 to r1. */
+
+/* input parameters - */
+/*	R0 = fifo start */
+/*	R1 = fifo end */
+/*	R2 = destination address, page aligned (in/out) */
+/*	R3 = number of pages */
+/*	R4 = constant to mask DQ7 bits */
+/*	R5 = constant to mask DQ5 bits, 0 if DQ5 is not supported */
+/*	R6 = write buffer word count - 1 command */
+/*	R7 = write to buffer command */
+/*	R8 = unlock1_addr */
+/*	R9 = program buffer to flash command */
+/*	R10 = unlock2_addr */
+/*	R11 = page size - 1 */
+/* temp registers - */
+/*	R12 = read pointer, value read from flash to test status */
+/*	LR = holding register */
+/* on error the read pointer is set to 0 */
+
+code:
+	ldr		lr, [r0, #0]		/* read wp */
+	cmp		lr, #0
+	beq		exit			/* abort if wp == 0 */
+	ldr		r12, [r0, #4]
+	cmp		r12, lr		/* wait until rp != wp */
+	beq		code
+	mov		lr, #0xaa
+	orr		lr, lr, lr, lsl #8
+	orr		lr, lr, lr, lsl #16
+	strh	lr, [r8]
+	mvn		lr, lr
+	strh	lr, [r10]
+	strh	r7, [r2]		/* write to buffer */
+	strh	r6, [r2]		/* word count - 1 */
+copy:
+	ldrh	lr, [r12], #2
+	strh	lr, [r2], #2
+	tst		r2, r11
+	bne		copy			/* until the end of the page */
+	strh	r9, [r2, #-2]	/* program buffer to flash */
+	cmp		r12, r1		/* wrap rp at the end of the fifo */
+	addcs	r12, r0, #8
+	str		r12, [r0, #4]	/* store rp */
+busy:
+	ldrh	r12, [r2, #-2]
+	tst		r12, r5
+	bne		dq5			/* b if DQ5 high */
+	eor		r12, r12, lr
+	tst		r12, r4
+	bne		busy			/* b if DQ7 != Data7 */
+	b		cont
+dq5:
+	ldrh	r12, [r2, #-2]
+	eor		r12, r12, lr
+	tst		r12, r4
+	bne		error
+cont:
+	subs	r3, r3, #1
+	bne		code
+	b		exit
+error:
+	mov		r12, #0
+	str		r12, [r0, #4]	/* set rp = 0 on error */
+exit:
+	b		exit
+
+	.end
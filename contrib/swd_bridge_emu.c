@@ -0,0 +1,917 @@
+/*
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Emulate the serial SWD/JTAG bridge of the mbprog driver on a
+ * pseudo-terminal, so the bridge protocol in src/jtag/drivers/bitbang.c can
+ * be tested and benchmarked without a probe.
+ *
+ * Served are the wire level SWD commands (0xF0/0xF1 shifts, 0xE0/0xE1
+ * SWDIO direction), the 0xC0 SWD transaction with WAIT retry, and the long
+ * frame form of all of them.  JTAG commands (0xD0-0xD2) are acknowledged,
+ * TDO reads as zero.
+ *
+ * Behind the wire sits a SW-DP with one MEM-AP and RAM.  With -c the
+ * Cortex-M debug registers (ROM table, SCS, halt control and core register
+ * transfer) are emulated well enough for OpenOCD to examine a cortex_m
+ * target; the core never executes anything.  -w makes every AP access
+ * answer WAIT a number of times first, to exercise the retry paths.  -b
+ * and -l slow the link down to a given baud rate and per-byte latency.
+ *
+ * Build:  cc -O2 -o swd_bridge_emu swd_bridge_emu.c
+ * Usage:  swd_bridge_emu [-c] [-v] [-r ram_base] [-s ram_size] [-w waits]
+ *                        [-b baud] [-l latency_us]
+ *
+ * The name of the pseudo-terminal is printed on startup, use it with
+ * "interface mbprog", "transport select swd" and "mbprog_port <name>".
+ * Statistics are printed on SIGINT.
+ *
+ * swd_bridge_emu_test.py runs the protocol checks against it, it is part of
+ * "make check" when the mbprog driver is built.
+ */
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#define BRIDGE_LONG		0x08
+
+#define ACK_OK			1
+#define ACK_WAIT		2
+#define ACK_FAULT		4
+#define ACK_NONE		7
+
+/* DP CTRL/STAT */
+#define ORUNDETECT		(1u << 0)
+#define STICKYORUN		(1u << 1)
+#define STICKYCMP		(1u << 4)
+#define STICKYERR		(1u << 5)
+#define WDATAERR		(1u << 7)
+#define CDBGPWRUPREQ		(1u << 28)
+#define CDBGPWRUPACK		(1u << 29)
+#define CSYSPWRUPREQ		(1u << 30)
+#define CSYSPWRUPACK		(1u << 31)
+
+#define DPIDR			0x2ba01477
+#define AHB_AP_IDR		0x24770011
+
+/* Cortex-M debug */
+#define ROM_TABLE		0xe00ff000
+#define SCS_BASE		0xe000e000
+#define CPUID			0xe000ed00
+#define AIRCR			0xe000ed0c
+#define DFSR			0xe000ed30
+#define DHCSR			0xe000edf0
+#define DCRSR			0xe000edf4
+#define DCRDR			0xe000edf8
+#define DEMCR			0xe000edfc
+
+static bool cortex_m;
+static bool verbose;
+static uint32_t ram_base = 0x20000000;
+static uint32_t ram_size = 0x10000;
+static uint8_t *ram;
+static unsigned int wait_count;
+static unsigned int baud;
+static unsigned int latency_us;
+
+static int fd = -1;
+static volatile sig_atomic_t stop;
+
+static struct {
+	unsigned long frames;
+	unsigned long bytes_in;
+	unsigned long bytes_out;
+	unsigned long swd_ok;
+	unsigned long swd_wait;
+	unsigned long swd_fault;
+	unsigned long transactions;
+} stats;
+
+/*
+ * Link
+ */
+
+static void link_delay(size_t bytes)
+{
+	unsigned long long us = (unsigned long long)bytes * latency_us;
+
+	if (baud)
+		us += bytes * 10ULL * 1000000 / baud;
+	if (us)
+		usleep(us);
+}
+
+static int get_byte(void)
+{
+	static uint8_t buf[4096];
+	static ssize_t len, pos;
+
+	while (pos == len) {
+		if (stop)
+			return -1;
+		pos = 0;
+		len = read(fd, buf, sizeof(buf));
+		if (len < 0) {
+			len = 0;
+			if (errno == EINTR)
+				continue;
+			/* EIO while no client has the terminal open */
+			if (errno == EIO) {
+				usleep(100000);
+				continue;
+			}
+			perror("read");
+			return -1;
+		}
+		stats.bytes_in += len;
+		link_delay(len);
+	}
+
+	return buf[pos++];
+}
+
+static int hex_value(int c)
+{
+	if (c >= '0' && c <= '9')
+		return c - '0';
+	if (c >= 'A' && c <= 'F')
+		return c - 'A' + 10;
+	if (c >= 'a' && c <= 'f')
+		return c - 'a' + 10;
+	return -1;
+}
+
+static int get_hex_byte(uint8_t *value)
+{
+	int hi = hex_value(get_byte());
+	int lo = hex_value(get_byte());
+
+	if (hi < 0 || lo < 0)
+		return -1;
+	*value = hi << 4 | lo;
+	return 0;
+}
+
+static int get_count(bool long_frame, uint32_t *count)
+{
+	*count = 0;
+	for (int i = 0; i < (long_frame ? 4 : 1); i++) {
+		uint8_t b;
+		if (get_hex_byte(&b) < 0)
+			return -1;
+		*count = *count << 8 | b;
+	}
+	return 0;
+}
+
+static void put_hex(const uint8_t *data, size_t len)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	char *out = malloc(2 * len);
+
+	if (!out) {
+		perror("malloc");
+		exit(1);
+	}
+	for (size_t i = 0; i < len; i++) {
+		out[2 * i] = digits[data[i] >> 4];
+		out[2 * i + 1] = digits[data[i] & 0xf];
+	}
+
+	link_delay(2 * len);
+	for (size_t done = 0; done < 2 * len; ) {
+		ssize_t n = write(fd, out + done, 2 * len - done);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror("write");
+			break;
+		}
+		done += n;
+	}
+	stats.bytes_out += 2 * len;
+	free(out);
+}
+
+static void put_ack(void)
+{
+	uint8_t zero = 0;
+	put_hex(&zero, 1);
+}
+
+/*
+ * Cortex-M debug registers
+ */
+
+static struct {
+	uint32_t dhcsr;		/* C_* control bits */
+	bool halted;
+	bool reset_st;
+	uint32_t dfsr;
+	uint32_t dcrdr;
+	uint32_t demcr;
+	uint32_t regs[128];
+} core;
+
+static const struct {
+	uint32_t address;
+	uint32_t value;
+} cortex_m_id_regs[] = {
+	/* ROM table: SCS, end marker, component and peripheral ID */
+	{ ROM_TABLE + 0x000, (SCS_BASE - ROM_TABLE) | 3 },
+	{ ROM_TABLE + 0xfd0, 0x04 },
+	{ ROM_TABLE + 0xfe0, 0xc4 },
+	{ ROM_TABLE + 0xfe4, 0xb4 },
+	{ ROM_TABLE + 0xfe8, 0x0b },
+	{ ROM_TABLE + 0xff0, 0x0d },
+	{ ROM_TABLE + 0xff4, 0x10 },
+	{ ROM_TABLE + 0xff8, 0x05 },
+	{ ROM_TABLE + 0xffc, 0xb1 },
+	/* SCS of a Cortex-M4 */
+	{ SCS_BASE + 0xfd0, 0x04 },
+	{ SCS_BASE + 0xfe0, 0x0c },
+	{ SCS_BASE + 0xfe4, 0xb0 },
+	{ SCS_BASE + 0xfe8, 0x0b },
+	{ SCS_BASE + 0xff0, 0x0d },
+	{ SCS_BASE + 0xff4, 0xe0 },
+	{ SCS_BASE + 0xff8, 0x05 },
+	{ SCS_BASE + 0xffc, 0xb1 },
+	{ CPUID, 0x410fc241 },
+};
+
+static void core_reset(void)
+{
+	core.reset_st = true;
+	core.regs[16] = 0x01000000;	/* xPSR, thumb */
+	if (ram_size >= 8) {
+		memcpy(&core.regs[13], ram, 4);
+		memcpy(&core.regs[15], ram + 4, 4);
+		core.regs[15] &= ~1u;
+	}
+	/* VC_CORERESET */
+	core.halted = (core.dhcsr & 1) && (core.demcr & 1);
+	if (core.halted)
+		core.dfsr |= 0x08;
+}
+
+static uint32_t core_read(uint32_t address)
+{
+	switch (address) {
+	case DHCSR:
+	{
+		uint32_t value = core.dhcsr | (1u << 16);
+		if (core.halted)
+			value |= 1u << 17;
+		if (core.reset_st)
+			value |= 1u << 25;
+		core.reset_st = false;
+		return value;
+	}
+	case DCRDR:
+		return core.dcrdr;
+	case DEMCR:
+		return core.demcr;
+	case DFSR:
+		return core.dfsr;
+	case AIRCR:
+		return 0xfa050000;
+	}
+
+	for (size_t i = 0; i < sizeof(cortex_m_id_regs) / sizeof(cortex_m_id_regs[0]); i++)
+		if (cortex_m_id_regs[i].address == address)
+			return cortex_m_id_regs[i].value;
+
+	/* everything else in the PPB reads as zero */
+	return 0;
+}
+
+static void core_write(uint32_t address, uint32_t value)
+{
+	switch (address) {
+	case DHCSR:
+		if ((value >> 16) != 0xa05f)
+			return;
+		core.dhcsr = value & 0xf;
+		if (!(core.dhcsr & 1)) {
+			core.halted = false;
+		} else if (core.dhcsr & 2) {
+			if (!core.halted)
+				core.dfsr |= 0x01;
+			core.halted = true;
+		} else if (core.dhcsr & 4) {
+			/* a step executes one 16-bit instruction */
+			core.regs[15] += 2;
+			core.halted = true;
+			core.dfsr |= 0x01;
+		} else {
+			core.halted = false;
+		}
+		break;
+	case DCRSR:
+		if (value & (1u << 16))
+			core.regs[value & 0x7f] = core.dcrdr;
+		else
+			core.dcrdr = core.regs[value & 0x7f];
+		break;
+	case DCRDR:
+		core.dcrdr = value;
+		break;
+	case DEMCR:
+		core.demcr = value;
+		break;
+	case DFSR:
+		core.dfsr &= ~value;
+		break;
+	case AIRCR:
+		/* SYSRESETREQ or VECTRESET */
+		if ((value >> 16) == 0x05fa && (value & 0x5))
+			core_reset();
+		break;
+	}
+}
+
+/*
+ * Bus behind the MEM-AP, accesses of size 1, 2 or 4 at naturally aligned
+ * addresses.  Returns false on a bus error.
+ */
+static bool bus_read(uint32_t address, unsigned int size, uint32_t *value)
+{
+	if (address >= ram_base && address - ram_base <= ram_size - size) {
+		uint8_t *p = ram + (address - ram_base);
+		*value = 0;
+		for (unsigned int i = 0; i < size; i++)
+			*value |= (uint32_t)p[i] << (8 * i);
+		return true;
+	}
+
+	if (cortex_m && address >= 0xe0000000 && address < 0xe0100000) {
+		uint32_t word = core_read(address & ~3u);
+		*value = word >> (8 * (address & 3));
+		return true;
+	}
+
+	return false;
+}
+
+static bool bus_write(uint32_t address, unsigned int size, uint32_t value)
+{
+	if (address >= ram_base && address - ram_base <= ram_size - size) {
+		uint8_t *p = ram + (address - ram_base);
+		for (unsigned int i = 0; i < size; i++)
+			p[i] = value >> (8 * i);
+		return true;
+	}
+
+	if (cortex_m && address >= 0xe0000000 && address < 0xe0100000) {
+		if (size == 4)
+			core_write(address, value);
+		return true;
+	}
+
+	return false;
+}
+
+/*
+ * SW-DP and MEM-AP
+ */
+
+static struct {
+	uint32_t ctrl_stat;
+	uint32_t select;
+	uint32_t rdbuff;
+	unsigned int waits_left;
+	uint32_t csw;
+	uint32_t tar;
+} dp = {
+	.csw = 0x03000042,
+};
+
+static uint32_t ap_mem_access(bool rnw, uint32_t address, uint32_t value)
+{
+	unsigned int size = 1u << (dp.csw & 3);
+	unsigned int lane = address & 3;
+	uint32_t data = 0;
+	bool ok;
+
+	if (size == 8 || (address & (size - 1))) {
+		dp.ctrl_stat |= STICKYERR;
+		return 0;
+	}
+
+	if (rnw) {
+		ok = bus_read(address, size, &data);
+		data <<= 8 * lane;
+	} else {
+		ok = bus_write(address, size, value >> (8 * lane));
+	}
+	if (!ok)
+		dp.ctrl_stat |= STICKYERR;
+
+	return data;
+}
+
+static uint32_t ap_access(bool rnw, unsigned int reg, uint32_t value)
+{
+	uint32_t data = 0;
+
+	/* only AP #0 exists */
+	if (dp.select >> 24)
+		return 0;
+
+	switch (reg) {
+	case 0x00:
+		if (rnw)
+			return dp.csw | (1u << 6);
+		dp.csw = value & ~(1u << 6);
+		break;
+	case 0x04:
+		if (rnw)
+			return dp.tar;
+		dp.tar = value;
+		break;
+	case 0x0c:
+		data = ap_mem_access(rnw, dp.tar, value);
+		/* auto increment, within a 1 KiB block like most MEM-APs */
+		if (dp.csw & 0x30) {
+			uint32_t next = dp.tar + (1u << (dp.csw & 3));
+			dp.tar = (dp.tar & ~0x3ffu) | (next & 0x3ff);
+		}
+		return data;
+	case 0x10:
+	case 0x14:
+	case 0x18:
+	case 0x1c:
+		if ((dp.csw & 3) != 2) {
+			dp.ctrl_stat |= STICKYERR;
+			return 0;
+		}
+		return ap_mem_access(rnw, (dp.tar & ~0xfu) | (reg & 0xc), value);
+	case 0xf8:
+		return cortex_m ? ROM_TABLE | 3 : 0xffffffff;
+	case 0xfc:
+		return AHB_AP_IDR;
+	}
+
+	return 0;
+}
+
+static uint32_t dp_read(unsigned int reg)
+{
+	switch (reg) {
+	case 0x0:
+		return DPIDR;
+	case 0x4:
+	{
+		uint32_t value = dp.ctrl_stat;
+		if (value & CDBGPWRUPREQ)
+			value |= CDBGPWRUPACK;
+		if (value & CSYSPWRUPREQ)
+			value |= CSYSPWRUPACK;
+		return value;
+	}
+	case 0x8:
+	case 0xc:
+		return dp.rdbuff;
+	}
+	return 0;
+}
+
+static void dp_write(unsigned int reg, uint32_t value)
+{
+	switch (reg) {
+	case 0x0:
+		if (value & (1u << 1))
+			dp.ctrl_stat &= ~STICKYCMP;
+		if (value & (1u << 2))
+			dp.ctrl_stat &= ~STICKYERR;
+		if (value & (1u << 3))
+			dp.ctrl_stat &= ~WDATAERR;
+		if (value & (1u << 4))
+			dp.ctrl_stat &= ~STICKYORUN;
+		break;
+	case 0x4:
+		dp.ctrl_stat = (dp.ctrl_stat & (STICKYORUN | STICKYCMP | STICKYERR | WDATAERR))
+			| (value & (CDBGPWRUPREQ | CSYSPWRUPREQ | (1u << 26) | 0xf00 | ORUNDETECT));
+		break;
+	case 0x8:
+		dp.select = value;
+		break;
+	}
+}
+
+static bool request_valid(uint8_t req)
+{
+	unsigned int parity = __builtin_popcount(req & 0x1e) & 1;
+
+	return (req & 0x01) && !(req & 0x40) && (req & 0x80)
+		&& parity == ((req >> 5) & 1);
+}
+
+/*
+ * Handle the request phase of a transaction: returns the ACK and, for an
+ * accepted read, the data.  Accepted writes complete in swd_write_data().
+ */
+static int swd_request(uint8_t req, uint32_t *data)
+{
+	bool ap = req & 0x02;
+	bool rnw = req & 0x04;
+	unsigned int reg = (req >> 1) & 0xc;
+
+	if (!request_valid(req))
+		return ACK_NONE;
+
+	if (ap && (dp.ctrl_stat & (STICKYERR | STICKYCMP | STICKYORUN | WDATAERR))) {
+		stats.swd_fault++;
+		return ACK_FAULT;
+	}
+
+	if (ap && dp.waits_left) {
+		dp.waits_left--;
+		stats.swd_wait++;
+		return ACK_WAIT;
+	}
+	if (ap)
+		dp.waits_left = wait_count;
+
+	stats.swd_ok++;
+	if (rnw) {
+		if (ap) {
+			/* AP reads are posted */
+			*data = dp.rdbuff;
+			dp.rdbuff = ap_access(true, (dp.select & 0xf0) | reg, 0);
+		} else {
+			*data = dp_read(reg);
+		}
+	}
+
+	return ACK_OK;
+}
+
+static void swd_write_data(uint8_t req, uint32_t value, bool parity_ok)
+{
+	unsigned int reg = (req >> 1) & 0xc;
+
+	if (!parity_ok) {
+		dp.ctrl_stat |= WDATAERR;
+		return;
+	}
+
+	if (req & 0x02)
+		ap_access(false, (dp.select & 0xf0) | reg, value);
+	else
+		dp_write(reg, value);
+}
+
+/*
+ * Wire level SWD: bits written by the host are collected, and when the
+ * host releases SWDIO the last eight of them are taken as the request.
+ * The target's part of the transaction is then queued for the host's
+ * next read.
+ */
+static struct {
+	uint8_t req_shift;
+	unsigned int ones;
+	uint64_t response;
+	unsigned int response_bits;
+	bool wdata_phase;
+	uint8_t wdata_req;
+	uint64_t wdata;
+	unsigned int wdata_bits;
+} wire;
+
+static void wire_host_bit(int bit)
+{
+	if (wire.wdata_phase) {
+		wire.wdata |= (uint64_t)bit << wire.wdata_bits;
+		if (++wire.wdata_bits == 33) {
+			uint32_t value = wire.wdata;
+			bool parity_ok = (__builtin_popcount(value) & 1) == (int)(wire.wdata >> 32);
+			swd_write_data(wire.wdata_req, value, parity_ok);
+			wire.wdata_phase = false;
+		}
+		return;
+	}
+
+	wire.req_shift = (wire.req_shift >> 1) | (bit << 7);
+	if (!bit) {
+		wire.ones = 0;
+	} else if (++wire.ones == 50) {
+		/* line reset */
+		wire.response_bits = 0;
+		if (verbose)
+			fprintf(stderr, "line reset\n");
+	}
+}
+
+static int wire_target_bit(void)
+{
+	int bit = 1;	/* pull-up */
+
+	if (wire.response_bits) {
+		bit = wire.response & 1;
+		wire.response >>= 1;
+		wire.response_bits--;
+	}
+	return bit;
+}
+
+static void wire_release(void)
+{
+	uint8_t req = wire.req_shift;
+	uint32_t data = 0;
+	int ack = swd_request(req, &data);
+
+	if (verbose)
+		fprintf(stderr, "request %02x ack %d\n", req, ack);
+
+	/* turnaround, ACK, then data, parity and turnaround for reads */
+	wire.response = (uint64_t)ack << 1;
+	wire.response_bits = 4;
+	if (ack == ACK_OK && (req & 0x04)) {
+		wire.response |= (uint64_t)data << 4;
+		wire.response |= (uint64_t)(__builtin_popcount(data) & 1) << 36;
+		wire.response_bits = 38;
+	}
+
+	if (ack == ACK_OK && !(req & 0x04)) {
+		wire.wdata_phase = true;
+		wire.wdata_req = req;
+		wire.wdata = 0;
+		wire.wdata_bits = 0;
+	}
+}
+
+/*
+ * Commands
+ */
+
+static int handle_shift(bool rnw, bool long_frame)
+{
+	uint32_t bit_cnt, offset, data_len;
+
+	if (get_count(long_frame, &bit_cnt) < 0 || get_count(long_frame, &offset) < 0
+			|| get_count(long_frame, &data_len) < 0)
+		return -1;
+
+	uint8_t *buf = calloc(data_len ? data_len : 1, 1);
+	if (!buf)
+		return -1;
+
+	if (!rnw) {
+		for (uint32_t i = 0; i < data_len; i++)
+			if (get_hex_byte(&buf[i]) < 0)
+				goto error;
+		for (uint32_t i = offset; i < offset + bit_cnt; i++)
+			wire_host_bit(data_len ? (buf[i / 8] >> (i % 8)) & 1 : 0);
+		put_ack();
+	} else if (data_len == 0) {
+		/* idle clocks, no reply */
+		for (uint32_t i = 0; i < bit_cnt; i++)
+			wire_host_bit(0);
+	} else {
+		for (uint32_t i = offset; i < offset + bit_cnt && i / 8 < data_len; i++)
+			buf[i / 8] |= wire_target_bit() << (i % 8);
+		put_hex(buf, data_len);
+	}
+
+	free(buf);
+	return 0;
+
+error:
+	free(buf);
+	return -1;
+}
+
+static int handle_transaction(bool long_frame)
+{
+	uint32_t req, retry, data_len;
+	uint8_t data[4] = { 0 };
+	uint8_t reply[8];
+	uint32_t value = 0;
+	unsigned int waits = 0;
+	int ack;
+
+	if (get_count(long_frame, &req) < 0 || get_count(long_frame, &retry) < 0
+			|| get_count(long_frame, &data_len) < 0)
+		return -1;
+	for (uint32_t i = 0; i < data_len; i++) {
+		uint8_t b;
+		if (get_hex_byte(&b) < 0)
+			return -1;
+		if (i < 4)
+			data[i] = b;
+	}
+
+	stats.transactions++;
+	for (;;) {
+		ack = swd_request(req, &value);
+		if (ack != ACK_WAIT || waits >= retry)
+			break;
+		waits++;
+	}
+	if (ack == ACK_OK && !(req & 0x04)) {
+		value = data[0] | data[1] << 8 | data[2] << 16 | (uint32_t)data[3] << 24;
+		swd_write_data(req, value, true);
+	}
+
+	reply[0] = ack;
+	reply[1] = __builtin_popcount(value) & 1;
+	reply[2] = waits;
+	reply[3] = waits >> 8;
+	for (int i = 0; i < 4; i++)
+		reply[4 + i] = value >> (8 * i);
+	put_hex(reply, sizeof(reply));
+	return 0;
+}
+
+static int handle_jtag(uint8_t cmd, bool long_frame)
+{
+	uint32_t bit_cnt, flags, data_len;
+
+	if (get_count(long_frame, &bit_cnt) < 0 || get_count(long_frame, &flags) < 0
+			|| get_count(long_frame, &data_len) < 0)
+		return -1;
+	for (uint32_t i = 0; i < data_len; i++) {
+		uint8_t b;
+		if (get_hex_byte(&b) < 0)
+			return -1;
+	}
+
+	if (cmd == 0xd1 && (flags & 0x01)) {
+		uint8_t *tdo = calloc(data_len ? data_len : 1, 1);
+		if (!tdo)
+			return -1;
+		put_hex(tdo, data_len);
+		free(tdo);
+	} else {
+		put_ack();
+	}
+	return 0;
+}
+
+static void serve(void)
+{
+	for (;;) {
+		int c = get_byte();
+		if (c < 0)
+			return;
+
+		stats.frames++;
+		bool long_frame = c & BRIDGE_LONG;
+		int ret = 0;
+
+		switch (c) {
+		case 0xe0:
+		case 0xe1:
+			/* the host releases SWDIO after sending the request */
+			if (c == 0xe0 && !wire.wdata_phase)
+				wire_release();
+			break;
+		case 0xf0:
+		case 0xf8:
+		case 0xf1:
+		case 0xf9:
+			ret = handle_shift(c & 1, long_frame);
+			break;
+		case 0xc0:
+		case 0xc8:
+			ret = handle_transaction(long_frame);
+			break;
+		case 0xd0:
+		case 0xd1:
+		case 0xd2:
+		case 0xd8:
+		case 0xd9:
+		case 0xda:
+			ret = handle_jtag(c & ~BRIDGE_LONG, long_frame);
+			break;
+		default:
+			stats.frames--;
+			if (verbose)
+				fprintf(stderr, "skipping byte %02x\n", c);
+			break;
+		}
+
+		if (ret < 0 && verbose)
+			fprintf(stderr, "malformed frame %02x\n", c);
+	}
+}
+
+static void on_signal(int sig)
+{
+	(void)sig;
+	stop = 1;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "usage: %s [-c] [-v] [-r ram_base] [-s ram_size] [-w waits] "
+			"[-b baud] [-l latency_us]\n", name);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	int c;
+
+	while ((c = getopt(argc, argv, "cvr:s:w:b:l:")) != -1) {
+		switch (c) {
+			case 'c':
+				cortex_m = true;
+				break;
+			case 'v':
+				verbose = true;
+				break;
+			case 'r':
+				ram_base = strtoul(optarg, NULL, 0);
+				break;
+			case 's':
+				ram_size = strtoul(optarg, NULL, 0);
+				break;
+			case 'w':
+				wait_count = strtoul(optarg, NULL, 0);
+				break;
+			case 'b':
+				baud = strtoul(optarg, NULL, 0);
+				break;
+			case 'l':
+				latency_us = strtoul(optarg, NULL, 0);
+				break;
+			default:
+				usage(argv[0]);
+		}
+	}
+	if (optind != argc || ram_size < 4)
+		usage(argv[0]);
+
+	ram = calloc(ram_size, 1);
+	if (!ram) {
+		perror("calloc");
+		return 1;
+	}
+	dp.waits_left = wait_count;
+	core_reset();
+	core.reset_st = false;
+
+	fd = posix_openpt(O_RDWR | O_NOCTTY);
+	if (fd < 0 || grantpt(fd) < 0 || unlockpt(fd) < 0) {
+		perror("pseudo-terminal");
+		return 1;
+	}
+	const char *name = ptsname(fd);
+
+	/* hold the slave open, so the master doesn't see EIO between clients */
+	int slave = open(name, O_RDWR | O_NOCTTY);
+	struct termios tty;
+	if (slave < 0 || tcgetattr(slave, &tty) < 0) {
+		perror(name);
+		return 1;
+	}
+	cfmakeraw(&tty);
+	tcsetattr(slave, TCSANOW, &tty);
+
+	struct sigaction sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = on_signal;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	printf("bridge on %s, RAM at 0x%08x (%u bytes)%s\n", name,
+			(unsigned)ram_base, (unsigned)ram_size, cortex_m ? ", Cortex-M" : "");
+	fflush(stdout);
+
+	serve();
+
+	printf("frames %lu, bytes in %lu out %lu, transactions %lu, "
+			"ACK OK %lu WAIT %lu FAULT %lu\n",
+			stats.frames, stats.bytes_in, stats.bytes_out, stats.transactions,
+			stats.swd_ok, stats.swd_wait, stats.swd_fault);
+
+	close(slave);
+	close(fd);
+	free(ram);
+	return 0;
+}
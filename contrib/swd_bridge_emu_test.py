@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""
+Protocol test of the serial SWD/JTAG bridge against swd_bridge_emu,
+covered by GNU GPLv2 or later.
+
+Starts the emulator with Cortex-M registers and two WAIT answers per AP
+access, then checks the emulator's side of the protocol with a minimal
+host written here: line resets in short and long frames, wire level
+(0xF0/0xF1) DP and AP accesses with host side WAIT retries, 0xC0
+transactions with bridge side retries, the Cortex-M ROM table, CPUID and
+DHCSR, a bus fault and the 0xD1 JTAG scan framing.  That host is not
+src/jtag/drivers/bitbang.c and says nothing about the driver.
+
+The driver is covered when an OpenOCD binary is given in $OPENOCD: a
+second emulator is then driven by "interface mbprog" and "transport
+select swd", OpenOCD examines the cortex_m target and writes and reads
+back RAM and CPUID with mww/mdw.  Without $OPENOCD that part is skipped
+and only the emulator is checked.
+
+The emulator binary is taken from $SWD_BRIDGE_EMU, or from the first
+argument.  Exits 0 on success, 1 on a failed check and 77 (skipped) if
+the pseudo-terminal can't be used.
+"""
+
+import os
+import re
+import select
+import signal
+import subprocess
+import sys
+import tty
+
+DPIDR = 0x2ba01477
+CPUID_CM4 = 0x410fc241
+
+ACK_OK = 1
+ACK_WAIT = 2
+ACK_FAULT = 4
+
+failures = 0
+
+
+def check(what, got, expected):
+    global failures
+    if got == expected:
+        print("ok   %s" % what)
+    else:
+        print("FAIL %s: got %r, expected %r" % (what, got, expected))
+        failures += 1
+
+
+class Bridge:
+    def __init__(self, fd):
+        self.fd = fd
+
+    def read_hex(self, n):
+        s = b''
+        while len(s) < 2 * n:
+            r, _, _ = select.select([self.fd], [], [], 2.0)
+            if not r:
+                raise RuntimeError("no reply from the bridge")
+            s += os.read(self.fd, 2 * n - len(s))
+        return bytes.fromhex(s.decode())
+
+    def frame(self, cmd, c0, c1, data_len, data=b''):
+        long_frame = c0 > 0xff or c1 > 0xff or data_len > 0xff
+        width = 4 if long_frame else 1
+        f = bytes([cmd | (0x08 if long_frame else 0)])
+        for count in (c0, c1, data_len):
+            f += count.to_bytes(width, 'big').hex().upper().encode()
+        f += data.hex().upper().encode()
+        os.write(self.fd, f)
+
+    def bits_out(self, bits):
+        buf = bytearray((len(bits) + 7) // 8)
+        for i, b in enumerate(bits):
+            buf[i // 8] |= b << (i % 8)
+        self.frame(0xF0, len(bits), 0, len(buf), bytes(buf))
+        self.read_hex(1)
+
+    def bits_in(self, n):
+        data_len = (n + 7) // 8
+        self.frame(0xF1, n, 0, data_len)
+        d = self.read_hex(data_len)
+        return [(d[i // 8] >> (i % 8)) & 1 for i in range(n)]
+
+    def drive(self, on):
+        os.write(self.fd, b'\xE1' if on else b'\xE0')
+
+
+def request(ap, rnw, addr):
+    r = 1 | ap << 1 | rnw << 2 | ((addr >> 2) & 3) << 3
+    parity = bin(r & 0x1e).count('1') & 1
+    return r | parity << 5 | 1 << 7
+
+
+def to_bits(value, n):
+    return [(value >> i) & 1 for i in range(n)]
+
+
+def from_bits(bits):
+    return sum(b << i for i, b in enumerate(bits))
+
+
+def wire_read(br, ap, addr):
+    """Wire level read, retrying WAIT on the host like bitbang.c does."""
+    waits = 0
+    while True:
+        br.bits_out(to_bits(request(ap, 1, addr), 8))
+        br.drive(False)
+        r = br.bits_in(1 + 3 + 32 + 1 + 1)
+        br.drive(True)
+        ack = from_bits(r[1:4])
+        if ack != ACK_WAIT:
+            return ack, from_bits(r[4:36]), waits
+        waits += 1
+
+
+def wire_write(br, ap, addr, value):
+    waits = 0
+    while True:
+        br.bits_out(to_bits(request(ap, 0, addr), 8))
+        br.drive(False)
+        r = br.bits_in(1 + 3 + 1)
+        br.drive(True)
+        parity = bin(value).count('1') & 1
+        br.bits_out(to_bits(value, 32) + [parity])
+        ack = from_bits(r[1:4])
+        if ack != ACK_WAIT:
+            return ack, waits
+        waits += 1
+
+
+def transaction(br, ap, rnw, addr, value=0, retry=5):
+    """0xC0 transaction, returns (ack, waits, data)."""
+    r = request(ap, rnw, addr)
+    if rnw:
+        br.frame(0xC0, r, retry, 0)
+    else:
+        br.frame(0xC0, r, retry, 4, value.to_bytes(4, 'little'))
+    d = br.read_hex(8)
+    return d[0] & 7, int.from_bytes(d[2:4], 'little'), int.from_bytes(d[4:8], 'little')
+
+
+def mem_read(br, addr):
+    transaction(br, 1, 0, 0x4, addr)
+    transaction(br, 1, 1, 0xC)
+    return transaction(br, 0, 1, 0xC)
+
+
+def run(br):
+    br.bits_out([1] * 60)
+    ack, value, _ = wire_read(br, 0, 0x0)
+    check("wire level DPIDR", (ack, value), (ACK_OK, DPIDR))
+
+    # a line reset beyond 255 bits needs a long frame
+    br.bits_out([1] * 300)
+    ack, value, _ = wire_read(br, 0, 0x0)
+    check("DPIDR after a long frame line reset", (ack, value), (ACK_OK, DPIDR))
+
+    check("power up request", wire_write(br, 0, 0x4, 0x50000000)[0], ACK_OK)
+    ack, value, _ = wire_read(br, 0, 0x4)
+    check("power up acknowledged", (ack, value & 0xf0000000), (ACK_OK, 0xf0000000))
+
+    # 32 bit auto-incrementing accesses, AP accesses WAIT twice first
+    ack, waits = wire_write(br, 1, 0x0, 0x23000052)
+    check("CSW write after WAIT", (ack, waits), (ACK_OK, 2))
+    wire_write(br, 1, 0x4, 0x20000000)
+    for i in range(4):
+        wire_write(br, 1, 0xC, 0x11111111 * (i + 1))
+
+    ack, waits, _ = transaction(br, 1, 0, 0x4, 0x20000000)
+    check("0xC0 TAR write retried in the bridge", (ack, waits), (ACK_OK, 2))
+    transaction(br, 1, 1, 0xC)
+    ack, _, first = transaction(br, 1, 1, 0xC)
+    ack, _, second = transaction(br, 0, 1, 0xC)
+    check("posted RAM reads", (first, second), (0x11111111, 0x22222222))
+
+    ack, waits, _ = transaction(br, 1, 1, 0xC, retry=1)
+    check("WAIT reported when the bridge gives up", (ack, waits), (ACK_WAIT, 1))
+    transaction(br, 0, 0, 0x0, 0x1e)
+
+    transaction(br, 0, 0, 0x8, 0xF0)
+    transaction(br, 1, 1, 0x8)
+    ack, _, base = transaction(br, 0, 1, 0xC)
+    check("ROM table base", (ack, base & ~3), (ACK_OK, 0xe00ff000))
+    transaction(br, 0, 0, 0x8, 0)
+
+    transaction(br, 1, 0, 0x4, 0xE000EDF0)
+    transaction(br, 1, 0, 0xC, 0xA05F0003)
+    ack, _, dhcsr = mem_read(br, 0xE000EDF0)
+    check("DHCSR halted", (ack, bool(dhcsr & (1 << 17))), (ACK_OK, True))
+
+    ack, _, cpuid = mem_read(br, 0xE000ED00)
+    check("CPUID", (ack, cpuid), (ACK_OK, CPUID_CM4))
+
+    transaction(br, 1, 0, 0x4, 0x10000000)
+    transaction(br, 1, 1, 0xC)
+    ack, _, _ = transaction(br, 1, 1, 0xC)
+    check("bus error answers FAULT", ack, ACK_FAULT)
+    ack, _, ctrl = transaction(br, 0, 1, 0x4)
+    check("STICKYERR set", (ack, bool(ctrl & (1 << 5))), (ACK_OK, True))
+
+    # an in-only scan still carries its (zero) TDI bytes
+    br.frame(0xD1, 16, 0x03, 2, b'\x00\x00')
+    check("0xD1 scan captures TDO", br.read_hex(2), b'\x00\x00')
+    br.frame(0xD2, 5, 0x04, 0)
+    check("0xD2 clocks acknowledged", len(br.read_hex(1)), 1)
+
+
+def run_openocd(openocd, dev):
+    """Examine the emulated target and access its RAM through the driver."""
+    commands = [
+        'gdb_port disabled', 'telnet_port disabled', 'tcl_port disabled',
+        'interface mbprog', 'mbprog_port %s' % dev, 'transport select swd',
+        'swd newdap emu cpu -expected-id 0x%08x' % DPIDR,
+        'target create emu.cpu cortex_m -chain-position emu.cpu',
+        'init',
+        'mww 0x20000000 0x5aa5c33c 16', 'mww 0x20000008 0x12345678',
+        'mdw 0x20000000 4', 'mdw 0xe000ed00',
+        'shutdown',
+    ]
+    args = [openocd]
+    for c in commands:
+        args += ['-c', c]
+    try:
+        out = subprocess.run(args, stdout=subprocess.PIPE, stderr=subprocess.STDOUT,
+                             universal_newlines=True, timeout=60).stdout
+    except subprocess.TimeoutExpired:
+        raise RuntimeError("openocd timed out")
+
+    words = {}
+    for m in re.finditer(r'^0x([0-9a-f]+): ((?:[0-9a-f]{8} ?)+)', out, re.M):
+        for i, w in enumerate(m.group(2).split()):
+            words[int(m.group(1), 16) + 4 * i] = int(w, 16)
+
+    check("openocd mww/mdw through the driver",
+          [words.get(0x20000000 + 4 * i) for i in range(4)],
+          [0x5aa5c33c, 0x5aa5c33c, 0x12345678, 0x5aa5c33c])
+    check("openocd CPUID through the driver", words.get(0xe000ed00), CPUID_CM4)
+    if failures:
+        print(out)
+
+
+def with_emulator(emu, test):
+    p = subprocess.Popen([emu, '-c', '-w', '2'], stdout=subprocess.PIPE,
+                         universal_newlines=True)
+    try:
+        line = p.stdout.readline()
+        print(line.strip())
+        if not line.startswith('bridge on '):
+            return 77
+        test(line.split()[2].rstrip(','))
+    except RuntimeError as e:
+        print("FAIL %s" % e)
+        return 1
+    finally:
+        p.send_signal(signal.SIGINT)
+        print(p.stdout.read().strip())
+        p.wait()
+    return 0
+
+
+def run_protocol(dev):
+    fd = os.open(dev, os.O_RDWR | os.O_NOCTTY)
+    tty.setraw(fd)
+    try:
+        run(Bridge(fd))
+    finally:
+        os.close(fd)
+
+
+def main():
+    emu = os.environ.get('SWD_BRIDGE_EMU') or (sys.argv[1] if len(sys.argv) > 1 else None)
+    if not emu:
+        print("usage: %s <swd_bridge_emu>" % sys.argv[0])
+        return 1
+
+    ret = with_emulator(emu, run_protocol)
+    if ret:
+        return ret
+
+    openocd = os.environ.get('OPENOCD')
+    if openocd:
+        ret = with_emulator(emu, lambda dev: run_openocd(openocd, dev))
+        if ret:
+            return ret
+    else:
+        print("skip openocd against the emulator, $OPENOCD is not set")
+
+    if failures:
+        print("%d check(s) failed" % failures)
+        return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -1603,7 +1603,7 @@ static int cfi_spansion_write_block_mips(struct flash_bank *bank, const uint8_t
 	return retval;
 }
 
-static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buffer,
+static int cfi_spansion_write_block_word(struct flash_bank *bank, const uint8_t *buffer,
 	uint32_t address, uint32_t count)
 {
 	struct cfi_flash_bank *cfi_info = bank->driver_priv;
@@ -1966,7 +1966,8 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 		count -= thisrun_count;
 	}
 
-	target_free_all_working_areas(target);
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
@@ -1982,6 +1983,413 @@ static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buff
 	return retval;
 }
 
+static int cfi_spansion_write_block_buffered(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct cfi_spansion_pri_ext *pri_ext = cfi_info->pri_ext;
+	struct target *target = bank->target;
+	struct reg_param reg_params[12];
+	struct arm_algorithm armv4_5_algo;
+	struct armv7m_algorithm armv7m_algo;
+	struct working_area *write_algorithm;
+	struct working_area *source;
+	uint32_t buffersize =
+		(1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+	uint32_t bufferwsize = buffersize / bank->bus_width;
+	uint32_t buffer_size = 32768;
+	bool async;
+	int retval = ERROR_OK;
+
+	/* One write buffer page is loaded and programmed per fifo block, see
+	 * contrib/loaders/flash/armv*_cfi_span_buf_*.s for the register usage.
+	 * The address is page aligned and count a multiple of the page size. */
+
+	/* see contrib/loaders/flash/armv7m_cfi_span_buf_16.s for src */
+	static const uint32_t armv7m_buf_16_code[] = {
+		/* 00000000 <code>: */
+		0xE000F8D0,		/* ldr.w lr, [r0] */
+		0x0F00F1BE,		/* cmp.w lr, #0 */
+		0xF8D0D035,		/* beq exit; ldr.w r12, [r0, #4] */
+		0x45F4C004,		/* cmp r12, lr */
+		0xF04FD0F6,		/* beq code; mov.w lr, #0xaaaaaaaa */
+		0xF8A83EAA,		/* strh.w lr, [r8] */
+		0xF04FE000,		/* mov.w lr, #0x55555555 */
+		0xF8AA3E55,		/* strh.w lr, [r10] */
+		0x8017E000,		/* strh r7, [r2] */
+		0xF83C8016,		/* strh r6, [r2]; <copy>: ldrh lr, [r12], #2 */
+		0xF822EB02,		/* strh lr, [r2], #2 */
+		0xEA12EB02,		/* tst.w r2, r11 */
+		0xD1F80F0B,		/* bne copy */
+		0x9C02F822,		/* strh r9, [r2, #-2] */
+		0xBF28458C,		/* cmp r12, r1; it hs */
+		0x0C08F100,		/* addhs.w r12, r0, #8 */
+		0xC004F8C0,		/* str.w r12, [r0, #4] */
+		/* 00000044 <busy>: */
+		0xCC02F832,		/* ldrh r12, [r2, #-2] */
+		0x0F05EA1C,		/* tst.w r12, r5 */
+		0xEA8CD105,		/* bne dq5; eor.w r12, r12, lr */
+		0xEA1C0C0E,		/* tst.w r12, r4 */
+		0xD1F50F04,		/* bne busy */
+		0xF832E006,		/* b cont; <dq5>: ldrh r12, [r2, #-2] */
+		0xEA8CCC02,		/* eor.w r12, r12, lr */
+		0xEA1C0C0E,		/* tst.w r12, r4 */
+		0xD1020F04,		/* bne error */
+		/* 00000068 <cont>: */
+		0xD1C91E5B,		/* subs r3, r3, #1; bne code */
+		0xF04FE003,		/* b exit; <error>: mov.w r12, #0 */
+		0xF8C00C00,		/* str.w r12, [r0, #4] */
+		0xBE00C004		/* <exit>: bkpt #0 */
+	};
+
+	/* see contrib/loaders/flash/armv7m_cfi_span_buf_32.s for src */
+	static const uint32_t armv7m_buf_32_code[] = {
+		/* 00000000 <code>: */
+		0xE000F8D0,		/* ldr.w lr, [r0] */
+		0x0F00F1BE,		/* cmp.w lr, #0 */
+		0xF8D0D035,		/* beq exit; ldr.w r12, [r0, #4] */
+		0x45F4C004,		/* cmp r12, lr */
+		0xF04FD0F6,		/* beq code; mov.w lr, #0xaaaaaaaa */
+		0xF8C83EAA,		/* str.w lr, [r8] */
+		0xF04FE000,		/* mov.w lr, #0x55555555 */
+		0xF8CA3E55,		/* str.w lr, [r10] */
+		0x6017E000,		/* str r7, [r2] */
+		0xF85C6016,		/* str r6, [r2]; <copy>: ldr lr, [r12], #4 */
+		0xF842EB04,		/* str lr, [r2], #4 */
+		0xEA12EB04,		/* tst.w r2, r11 */
+		0xD1F80F0B,		/* bne copy */
+		0x9C04F842,		/* str r9, [r2, #-4] */
+		0xBF28458C,		/* cmp r12, r1; it hs */
+		0x0C08F100,		/* addhs.w r12, r0, #8 */
+		0xC004F8C0,		/* str.w r12, [r0, #4] */
+		/* 00000044 <busy>: */
+		0xCC04F852,		/* ldr r12, [r2, #-4] */
+		0x0F05EA1C,		/* tst.w r12, r5 */
+		0xEA8CD105,		/* bne dq5; eor.w r12, r12, lr */
+		0xEA1C0C0E,		/* tst.w r12, r4 */
+		0xD1F50F04,		/* bne busy */
+		0xF852E006,		/* b cont; <dq5>: ldr r12, [r2, #-4] */
+		0xEA8CCC04,		/* eor.w r12, r12, lr */
+		0xEA1C0C0E,		/* tst.w r12, r4 */
+		0xD1020F04,		/* bne error */
+		/* 00000068 <cont>: */
+		0xD1C91E5B,		/* subs r3, r3, #1; bne code */
+		0xF04FE003,		/* b exit; <error>: mov.w r12, #0 */
+		0xF8C00C00,		/* str.w r12, [r0, #4] */
+		0xBE00C004		/* <exit>: bkpt #0 */
+	};
+
+	/* see contrib/loaders/flash/armv4_5_cfi_span_buf_16.s for src */
+	static const uint32_t armv4_5_buf_16_code[] = {
+		/* 00000000 <code>: */
+		0xE590E000,		/* ldr lr, [r0] */
+		0xE35E0000,		/* cmp lr, #0 */
+		0x0A000022,		/* beq exit */
+		0xE590C004,		/* ldr r12, [r0, #4] */
+		0xE15C000E,		/* cmp r12, lr */
+		0x0AFFFFF9,		/* beq code */
+		0xE3A0E0AA,		/* mov lr, #0xaa */
+		0xE18EE40E,		/* orr lr, lr, lr, lsl #8 */
+		0xE18EE80E,		/* orr lr, lr, lr, lsl #16 */
+		0xE1C8E0B0,		/* strh lr, [r8] */
+		0xE1E0E00E,		/* mvn lr, lr */
+		0xE1CAE0B0,		/* strh lr, [r10] */
+		0xE1C270B0,		/* strh r7, [r2] */
+		0xE1C260B0,		/* strh r6, [r2] */
+		/* 00000038 <copy>: */
+		0xE0DCE0B2,		/* ldrh lr, [r12], #2 */
+		0xE0C2E0B2,		/* strh lr, [r2], #2 */
+		0xE112000B,		/* tst r2, r11 */
+		0x1AFFFFFB,		/* bne copy */
+		0xE14290B2,		/* strh r9, [r2, #-2] */
+		0xE15C0001,		/* cmp r12, r1 */
+		0x2280C008,		/* addhs r12, r0, #8 */
+		0xE580C004,		/* str r12, [r0, #4] */
+		/* 00000058 <busy>: */
+		0xE152C0B2,		/* ldrh r12, [r2, #-2] */
+		0xE11C0005,		/* tst r12, r5 */
+		0x1A000003,		/* bne dq5 */
+		0xE02CC00E,		/* eor r12, r12, lr */
+		0xE11C0004,		/* tst r12, r4 */
+		0x1AFFFFF9,		/* bne busy */
+		0xEA000003,		/* b cont */
+		/* 00000074 <dq5>: */
+		0xE152C0B2,		/* ldrh r12, [r2, #-2] */
+		0xE02CC00E,		/* eor r12, r12, lr */
+		0xE11C0004,		/* tst r12, r4 */
+		0x1A000002,		/* bne error */
+		/* 00000084 <cont>: */
+		0xE2533001,		/* subs r3, r3, #1 */
+		0x1AFFFFDC,		/* bne code */
+		0xEA000001,		/* b exit */
+		/* 00000090 <error>: */
+		0xE3A0C000,		/* mov r12, #0 */
+		0xE580C004,		/* str r12, [r0, #4] */
+		/* 00000098 <exit>: */
+		0xEAFFFFFE		/* b exit */
+	};
+
+	/* see contrib/loaders/flash/armv4_5_cfi_span_buf_32.s for src */
+	static const uint32_t armv4_5_buf_32_code[] = {
+		/* 00000000 <code>: */
+		0xE590E000,		/* ldr lr, [r0] */
+		0xE35E0000,		/* cmp lr, #0 */
+		0x0A000022,		/* beq exit */
+		0xE590C004,		/* ldr r12, [r0, #4] */
+		0xE15C000E,		/* cmp r12, lr */
+		0x0AFFFFF9,		/* beq code */
+		0xE3A0E0AA,		/* mov lr, #0xaa */
+		0xE18EE40E,		/* orr lr, lr, lr, lsl #8 */
+		0xE18EE80E,		/* orr lr, lr, lr, lsl #16 */
+		0xE588E000,		/* str lr, [r8] */
+		0xE1E0E00E,		/* mvn lr, lr */
+		0xE58AE000,		/* str lr, [r10] */
+		0xE5827000,		/* str r7, [r2] */
+		0xE5826000,		/* str r6, [r2] */
+		/* 00000038 <copy>: */
+		0xE49CE004,		/* ldr lr, [r12], #4 */
+		0xE482E004,		/* str lr, [r2], #4 */
+		0xE112000B,		/* tst r2, r11 */
+		0x1AFFFFFB,		/* bne copy */
+		0xE5029004,		/* str r9, [r2, #-4] */
+		0xE15C0001,		/* cmp r12, r1 */
+		0x2280C008,		/* addhs r12, r0, #8 */
+		0xE580C004,		/* str r12, [r0, #4] */
+		/* 00000058 <busy>: */
+		0xE512C004,		/* ldr r12, [r2, #-4] */
+		0xE11C0005,		/* tst r12, r5 */
+		0x1A000003,		/* bne dq5 */
+		0xE02CC00E,		/* eor r12, r12, lr */
+		0xE11C0004,		/* tst r12, r4 */
+		0x1AFFFFF9,		/* bne busy */
+		0xEA000003,		/* b cont */
+		/* 00000074 <dq5>: */
+		0xE512C004,		/* ldr r12, [r2, #-4] */
+		0xE02CC00E,		/* eor r12, r12, lr */
+		0xE11C0004,		/* tst r12, r4 */
+		0x1A000002,		/* bne error */
+		/* 00000084 <cont>: */
+		0xE2533001,		/* subs r3, r3, #1 */
+		0x1AFFFFDC,		/* bne code */
+		0xEA000001,		/* b exit */
+		/* 00000090 <error>: */
+		0xE3A0C000,		/* mov r12, #0 */
+		0xE580C004,		/* str r12, [r0, #4] */
+		/* 00000098 <exit>: */
+		0xEAFFFFFE		/* b exit */
+	};
+
+	const uint32_t *target_code_src;
+	int target_code_size;
+	void *arm_algo;
+
+	/* Cortex-M cores can run the algorithm while the fifo is refilled,
+	 * other ARM cores get the fifo filled up front for every run */
+	async = is_armv7m(target_to_armv7m(target));
+	if (async) {
+		armv7m_algo.common_magic = ARMV7M_COMMON_MAGIC;
+		armv7m_algo.core_mode = ARM_MODE_THREAD;
+		arm_algo = &armv7m_algo;
+		if (bank->bus_width == 2) {
+			target_code_src = armv7m_buf_16_code;
+			target_code_size = sizeof(armv7m_buf_16_code);
+		} else {
+			target_code_src = armv7m_buf_32_code;
+			target_code_size = sizeof(armv7m_buf_32_code);
+		}
+	} else {
+		armv4_5_algo.common_magic = ARM_COMMON_MAGIC;
+		armv4_5_algo.core_mode = ARM_MODE_SVC;
+		armv4_5_algo.core_state = ARM_STATE_ARM;
+		arm_algo = &armv4_5_algo;
+		if (bank->bus_width == 2) {
+			target_code_src = armv4_5_buf_16_code;
+			target_code_size = sizeof(armv4_5_buf_16_code);
+		} else {
+			target_code_src = armv4_5_buf_32_code;
+			target_code_size = sizeof(armv4_5_buf_32_code);
+		}
+	}
+
+	/* convert bus-width dependent algorithm code to correct endianness */
+	uint8_t *target_code = malloc(target_code_size);
+	if (target_code == NULL) {
+		LOG_ERROR("Out of memory");
+		return ERROR_FAIL;
+	}
+
+	target_buffer_set_u32_array(target, target_code, target_code_size / 4, target_code_src);
+
+	retval = target_alloc_working_area(target, target_code_size, &write_algorithm);
+	if (retval != ERROR_OK) {
+		free(target_code);
+		return retval;
+	}
+
+	retval = target_write_buffer(target, write_algorithm->address,
+			target_code_size, target_code);
+	free(target_code);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
+		return retval;
+	}
+
+	/* the fifo holds whole pages, plus the read and write pointers */
+	if (buffer_size < buffersize)
+		buffer_size = buffersize;
+	while (target_alloc_working_area_try(target, buffer_size + 8, &source) != ERROR_OK) {
+		buffer_size /= 2;
+		if (buffer_size < buffersize) {
+			target_free_working_area(target, write_algorithm);
+			LOG_WARNING("not enough working area available, can't do buffered block writes");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+	}
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);
+	init_reg_param(&reg_params[7], "r7", 32, PARAM_OUT);
+	init_reg_param(&reg_params[8], "r8", 32, PARAM_OUT);
+	init_reg_param(&reg_params[9], "r9", 32, PARAM_OUT);
+	init_reg_param(&reg_params[10], "r10", 32, PARAM_OUT);
+	init_reg_param(&reg_params[11], "r11", 32, PARAM_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, source->address);
+	buf_set_u32(reg_params[2].value, 0, 32, address);
+	buf_set_u32(reg_params[4].value, 0, 32, cfi_command_val(bank, 0x80));
+	buf_set_u32(reg_params[5].value, 0, 32,
+			(cfi_info->status_poll_mask & (1 << 5)) ? cfi_command_val(bank, 0x20) : 0);
+	buf_set_u32(reg_params[6].value, 0, 32, cfi_command_val(bank, bufferwsize - 1));
+	buf_set_u32(reg_params[7].value, 0, 32, cfi_command_val(bank, 0x25));
+	buf_set_u32(reg_params[8].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock1));
+	buf_set_u32(reg_params[9].value, 0, 32, cfi_command_val(bank, 0x29));
+	buf_set_u32(reg_params[10].value, 0, 32, flash_address(bank, 0, pri_ext->_unlock2));
+	buf_set_u32(reg_params[11].value, 0, 32, buffersize - 1);
+
+	if (async) {
+		buf_set_u32(reg_params[1].value, 0, 32, source->address + 8 + buffer_size);
+		buf_set_u32(reg_params[3].value, 0, 32, count / buffersize);
+
+		retval = target_run_flash_async_algorithm(target, buffer, count / buffersize,
+				buffersize, 0, NULL, 12, reg_params,
+				source->address, buffer_size + 8,
+				write_algorithm->address, 0, arm_algo);
+	} else {
+		uint8_t *fifo = malloc(buffer_size + 8);
+		if (fifo == NULL) {
+			LOG_ERROR("Out of memory");
+			retval = ERROR_FAIL;
+			count = 0;
+		}
+
+		while (count > 0) {
+			uint32_t thisrun_count = (count > buffer_size) ? buffer_size : count;
+			uint32_t end = source->address + 8 + thisrun_count;
+
+			/* write pointer, read pointer and data in one transfer */
+			target_buffer_set_u32(target, fifo, end);
+			target_buffer_set_u32(target, fifo + 4, source->address + 8);
+			memcpy(fifo + 8, buffer, thisrun_count);
+			retval = target_write_buffer(target, source->address, thisrun_count + 8, fifo);
+			if (retval != ERROR_OK)
+				break;
+
+			buf_set_u32(reg_params[1].value, 0, 32, end);
+			buf_set_u32(reg_params[3].value, 0, 32, thisrun_count / buffersize);
+
+			retval = target_run_algorithm(target, 0, NULL, 12, reg_params,
+					write_algorithm->address,
+					write_algorithm->address + target_code_size - 4,
+					10000 + (thisrun_count / buffersize) * cfi_info->buf_write_timeout,
+					arm_algo);
+			if (retval != ERROR_OK)
+				break;
+
+			if (buf_get_u32(reg_params[2].value, 0, 32) != address + thisrun_count) {
+				retval = ERROR_FLASH_OPERATION_FAILED;
+				break;
+			}
+
+			buffer += thisrun_count;
+			address += thisrun_count;
+			count -= thisrun_count;
+		}
+
+		free(fifo);
+	}
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		LOG_ERROR("flash write buffer programming failed at address 0x%" PRIx32,
+				buf_get_u32(reg_params[2].value, 0, 32) - buffersize);
+
+		/* leave the write-to-buffer-abort state */
+		if (cfi_send_command(bank, 0xaa, flash_address(bank, 0, pri_ext->_unlock1)) == ERROR_OK
+				&& cfi_send_command(bank, 0x55, flash_address(bank, 0, pri_ext->_unlock2)) == ERROR_OK)
+			cfi_send_command(bank, 0xf0, flash_address(bank, 0, 0x0));
+	}
+
+	target_free_working_area(target, source);
+	target_free_working_area(target, write_algorithm);
+
+	for (int i = 0; i < 12; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return retval;
+}
+
+static int cfi_spansion_write_block(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t address, uint32_t count)
+{
+	struct cfi_flash_bank *cfi_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t buffersize =
+		(1UL << cfi_info->max_buf_write_size) * (bank->bus_width / bank->chip_width);
+	uint32_t buffermask = buffersize - 1;
+	uint32_t head, pages;
+	int retval;
+
+	/* Write buffer programming needs a chip with a write buffer whose
+	 * word count fits the buffer load command, and an ARM core.  Anything
+	 * else, and the unaligned head and tail, use word programming. */
+	if (cfi_info->buf_write_timeout_typ == 0
+			|| (bank->bus_width != 2 && bank->bus_width != 4)
+			|| buffersize / bank->bus_width > 256
+			|| strncmp(target_type_name(target), "mips_m4k", 8) == 0
+			|| !(is_armv7m(target_to_armv7m(target)) || is_arm(target_to_arm(target))))
+		return cfi_spansion_write_block_word(bank, buffer, address, count);
+
+	head = (buffersize - (address & buffermask)) & buffermask;
+	if (head > count)
+		head = count;
+	pages = (count - head) & ~buffermask;
+	if (pages == 0)
+		return cfi_spansion_write_block_word(bank, buffer, address, count);
+
+	if (head) {
+		retval = cfi_spansion_write_block_word(bank, buffer, address, head);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	retval = cfi_spansion_write_block_buffered(bank, buffer + head, address + head, pages);
+	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		retval = cfi_spansion_write_block_word(bank, buffer + head, address + head, pages);
+	if (retval != ERROR_OK)
+		return retval;
+
+	count -= head + pages;
+	if (count)
+		retval = cfi_spansion_write_block_word(bank, buffer + head + pages,
+				address + head + pages, count);
+
+	return retval;
+}
+
 static int cfi_intel_write_word(struct flash_bank *bank, uint8_t *word, uint32_t address)
 {
 	int retval;
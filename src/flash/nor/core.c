@@ -26,6 +26,7 @@
 #include <flash/nor/core.h>
 #include <flash/nor/imp.h>
 #include <target/image.h>
+#include <helper/perf.h>
 
 /**
  * @file
@@ -40,7 +41,9 @@ int flash_driver_erase(struct flash_bank *bank, int first, int last)
 {
 	int retval;
 
+	int64_t start = perf_now();
 	retval = bank->driver->erase(bank, first, last);
+	perf_record(PERF_HIST_FLASH_ERASE, start);
 	if (retval != ERROR_OK)
 		LOG_ERROR("failed erasing sectors %d to %d", first, last);
 
@@ -90,7 +93,9 @@ int flash_driver_write(struct flash_bank *bank,
 {
 	int retval;
 
+	int64_t start = perf_now();
 	retval = bank->driver->write(bank, buffer, offset, count);
+	perf_record(PERF_HIST_FLASH_WRITE, start);
 	if (retval != ERROR_OK) {
 		LOG_ERROR(
 			"error writing to flash at address 0x%08" PRIx32 " at offset 0x%8.8" PRIx32,
@@ -97,6 +97,9 @@
 struct efm32x_flash_bank {
 	int probed;
 	uint32_t lb_page[LOCKBITS_PAGE_SZ/4];
+	/* what the lock bits page is known to hold in flash */
+	uint32_t lb_flash[LOCKBITS_PAGE_SZ/4];
+	bool lb_flash_valid;
 	uint32_t reg_base;
 	uint32_t reg_lock;
 };
@@ -110,8 +113,10 @@ struct efm32_info {
 	uint16_t page_size;
 };
 
-static int efm32x_write(struct flash_bank *bank, const uint8_t *buffer,
-	uint32_t offset, uint32_t count);
+static int efm32x_priv_write(struct flash_bank *bank, const uint8_t *buffer,
+	uint32_t offset, uint32_t count, uint32_t erase_pages);
+static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
+	uint32_t offset, uint32_t count, uint32_t erase_addr, uint32_t erase_pages);
 
 static int efm32x_get_flash_size(struct flash_bank *bank, uint16_t *flash_sz)
 {
@@ -354,6 +359,7 @@ FLASH_BANK_COMMAND_HANDLER(efm32x_flash_bank_command)
 	bank->driver_priv = efm32x_info;
 	efm32x_info->probed = 0;
 	memset(efm32x_info->lb_page, 0xff, LOCKBITS_PAGE_SZ);
+	efm32x_info->lb_flash_valid = false;
 
 	return ERROR_OK;
 }
@@ -486,13 +492,24 @@ static int efm32x_erase(struct flash_bank *bank, int first, int last)
 		return ret;
 	}
 
-	for (i = first; i <= last; i++) {
-		ret = efm32x_erase_page(bank, bank->sectors[i].offset);
-		if (ERROR_OK != ret)
-			LOG_ERROR("Failed to erase page %d", i);
+	/* erase the whole range in one loader run if possible */
+	ret = efm32x_write_block(bank, NULL, 0, 0,
+		bank->base + bank->sectors[first].offset, last - first + 1);
+
+	if (ret == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		for (i = first; i <= last; i++) {
+			ret = efm32x_erase_page(bank, bank->sectors[i].offset);
+			if (ERROR_OK != ret)
+				LOG_ERROR("Failed to erase page %d", i);
+		}
+	} else if (ERROR_OK != ret) {
+		LOG_ERROR("Failed to erase pages %d..%d", first, last);
 	}
 
-	ret = efm32x_set_wren(bank, 0);
+	if (ERROR_OK == ret)
+		ret = efm32x_set_wren(bank, 0);
+	else
+		efm32x_set_wren(bank, 0);
 	efm32x_msc_lock(bank, 1);
 
 	return ret;
@@ -548,22 +565,57 @@ static int efm32x_read_lock_data(struct flash_bank *bank)
 		return ret;
 	}
 
+	/* words not read above are assumed to be left erased */
+	memcpy(efm32x_info->lb_flash, efm32x_info->lb_page, LOCKBITS_PAGE_SZ);
+	efm32x_info->lb_flash_valid = true;
+
 	return ERROR_OK;
 }
 
 static int efm32x_write_lock_data(struct flash_bank *bank)
 {
 	struct efm32x_flash_bank *efm32x_info = bank->driver_priv;
-	int ret = 0;
+	uint32_t *lb_page = efm32x_info->lb_page;
+	uint32_t *lb_flash = efm32x_info->lb_flash;
+	bool in_place = efm32x_info->lb_flash_valid;
+	int i = 0;
+	int ret = ERROR_OK;
+
+	/* Locking only clears bits, so unless a bit has to go back to 1 the
+	 * changed words are programmed over the current page contents */
+	for (i = 0; i < LOCKBITS_PAGE_SZ/4 && in_place; i++) {
+		if (lb_page[i] & ~lb_flash[i])
+			in_place = false;
+	}
+
+	if (in_place) {
+		i = 0;
+		while (i < LOCKBITS_PAGE_SZ/4 && ERROR_OK == ret) {
+			int n = 0;
+
+			while (i + n < LOCKBITS_PAGE_SZ/4 && lb_page[i + n] != lb_flash[i + n])
+				n++;
+
+			if (n)
+				ret = efm32x_priv_write(bank, (uint8_t *)&lb_page[i],
+					EFM32_MSC_LOCK_BITS + i * 4, n * 4, 0);
+			i += n + 1;
+		}
+	} else {
+		/* erase and rewrite the whole page in one go */
+		ret = efm32x_priv_write(bank, (uint8_t *)lb_page, EFM32_MSC_LOCK_BITS,
+			LOCKBITS_PAGE_SZ, 1);
+	}
 
-	ret = efm32x_erase_page(bank, EFM32_MSC_LOCK_BITS);
 	if (ERROR_OK != ret) {
-		LOG_ERROR("Failed to erase LB page");
+		efm32x_info->lb_flash_valid = false;
 		return ret;
 	}
 
-	return efm32x_write(bank, (uint8_t *)efm32x_info->lb_page, EFM32_MSC_LOCK_BITS,
-		LOCKBITS_PAGE_SZ);
+	memcpy(lb_flash, lb_page, LOCKBITS_PAGE_SZ);
+	efm32x_info->lb_flash_valid = true;
+
+	return ERROR_OK;
 }
 
 static int efm32x_get_page_lock(struct flash_bank *bank, size_t page)
@@ -626,15 +678,19 @@ static int efm32x_protect(struct flash_bank *bank, int set, int first, int last)
 	return ERROR_OK;
 }
 
+/* Erase erase_pages pages starting at erase_addr, then program and read back
+ * count words at offset, in one run of the loader.  With count == 0 only
+ * the erase is done. */
 static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
-	uint32_t offset, uint32_t count)
+	uint32_t offset, uint32_t count, uint32_t erase_addr, uint32_t erase_pages)
 {
 	struct target *target = bank->target;
 	uint32_t buffer_size = 16384;
 	struct working_area *write_algorithm;
-	struct working_area *source;
+	struct working_area *source = NULL;
+	uint32_t fifo_start, fifo_end;
 	uint32_t address = bank->base + offset;
-	struct reg_param reg_params[5];
+	struct reg_param reg_params[8];
 	struct armv7m_algorithm armv7m_info;
 	struct efm32x_flash_bank *efm32x_info = bank->driver_priv;
 	int ret = ERROR_OK;
@@ -647,13 +703,42 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 		/* #define EFM32_MSC_WDATA_OFFSET          0x018 */
 		/* #define EFM32_MSC_STATUS_OFFSET         0x01c */
 
-			0x01, 0x26,    /* movs    r6, #1 */
-			0x86, 0x60,    /* str     r6, [r0, #EFM32_MSC_WRITECTRL_OFFSET] */
+			0x01, 0x27,    /* movs    r7, #1 */
+			0x87, 0x60,    /* str     r7, [r0, #EFM32_MSC_WRITECTRL_OFFSET] */
+
+		/* erase_page: */
+			0x00, 0x2e,    /* cmp     r6, #0 */
+			0x10, 0xd0,    /* beq     write */
+			0x05, 0x61,    /* str     r5, [r0, #EFM32_MSC_ADDRB_OFFSET] */
+			0x01, 0x27,    /* movs    r7, #1 */
+			0xc7, 0x60,    /* str     r7, [r0, #EFM32_MSC_WRITECMD_OFFSET] */
+			0xc7, 0x69,    /* ldr     r7, [r0, #EFM32_MSC_STATUS_OFFSET] */
+			0x7f, 0x08,    /* lsrs    r7, r7, #1 */
+			0xbf, 0x07,    /* lsls    r7, r7, #30 */
+			0x07, 0xd1,    /* bne     erase_error */
+			0x02, 0x27,    /* movs    r7, #2 */
+			0xc7, 0x60,    /* str     r7, [r0, #EFM32_MSC_WRITECMD_OFFSET] */
+
+		/* erase_busy: */
+			0xc7, 0x69,    /* ldr     r7, [r0, #EFM32_MSC_STATUS_OFFSET] */
+			0x7f, 0x08,    /* lsrs    r7, r7, #1 */
+			0xfc, 0xd2,    /* bcs     erase_busy */
+			0x45, 0x44,    /* add     r5, r8 */
+			0x01, 0x3e,    /* subs    r6, #1 */
+			0xee, 0xe7,    /* b       erase_page */
+
+		/* erase_error: */
+			0x2c, 0x46,    /* mov     r4, r5 */
+			0x29, 0xe0,    /* b       error */
+
+		/* write: */
+			0x00, 0x29,    /* cmp     r1, #0 */
+			0x29, 0xd0,    /* beq     exit */
 
 		/* wait_fifo: */
 			0x16, 0x68,    /* ldr     r6, [r2, #0] */
 			0x00, 0x2e,    /* cmp     r6, #0 */
-			0x22, 0xd0,    /* beq     exit */
+			0x26, 0xd0,    /* beq     exit */
 			0x55, 0x68,    /* ldr     r5, [r2, #4] */
 			0xb5, 0x42,    /* cmp     r5, r6 */
 			0xf9, 0xd0,    /* beq     wait_fifo */
@@ -664,7 +749,7 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 			0xc6, 0x69,    /* ldr     r6, [r0, #EFM32_MSC_STATUS_OFFSET] */
 			0x06, 0x27,    /* movs    r7, #6 */
 			0x3e, 0x42,    /* tst     r6, r7 */
-			0x16, 0xd1,    /* bne     error */
+			0x1a, 0xd1,    /* bne     error */
 
 		/* wait_wdataready: */
 			0xc6, 0x69,    /* ldr     r6, [r0, #EFM32_MSC_STATUS_OFFSET] */
@@ -677,15 +762,20 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 			0x08, 0x26,    /* movs    r6, #8 */
 			0xc6, 0x60,    /* str     r6, [r0, #EFM32_MSC_WRITECMD_OFFSET] */
 
-			0x04, 0x35,    /* adds    r5, #4 */
-			0x04, 0x34,    /* adds    r4, #4 */
-
 		/* busy: */
 			0xc6, 0x69,    /* ldr     r6, [r0, #EFM32_MSC_STATUS_OFFSET] */
 			0x01, 0x27,    /* movs    r7, #1 */
 			0x3e, 0x42,    /* tst     r6, r7 */
 			0xfb, 0xd1,    /* bne     busy */
 
+			0x2e, 0x68,    /* ldr     r6, [r5] */
+			0x27, 0x68,    /* ldr     r7, [r4] */
+			0xbe, 0x42,    /* cmp     r6, r7 */
+			0x0a, 0xd1,    /* bne     error */
+
+			0x04, 0x35,    /* adds    r5, #4 */
+			0x04, 0x34,    /* adds    r4, #4 */
+
 			0x9d, 0x42,    /* cmp     r5, r3 */
 			0x01, 0xd3,    /* bcc     no_wrap */
 			0x15, 0x46,    /* mov     r5, r2 */
@@ -693,23 +783,23 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 
 		/* no_wrap: */
 			0x55, 0x60,    /* str     r5, [r2, #4] */
-			0x01, 0x39,    /* subs    r1, r1, #1 */
+			0x49, 0x1e,    /* subs    r1, r1, #1 */
 			0x00, 0x29,    /* cmp     r1, #0 */
 			0x02, 0xd0,    /* beq     exit */
-			0xdb, 0xe7,    /* b       wait_fifo */
+			0xd7, 0xe7,    /* b       wait_fifo */
 
 		/* error: */
-			0x00, 0x20,    /* movs    r0, #0 */
-			0x50, 0x60,    /* str     r0, [r2, #4] */
+			0x00, 0x27,    /* movs    r7, #0 */
+			0x57, 0x60,    /* str     r7, [r2, #4] */
 
 		/* exit: */
-			0x30, 0x46,    /* mov     r0, r6 */
+			0xc0, 0x69,    /* ldr     r0, [r0, #EFM32_MSC_STATUS_OFFSET] */
 			0x00, 0xbe,    /* bkpt    #0 */
 	};
 
 
-	/* flash write code */
-	if (target_alloc_working_area(target, sizeof(efm32x_flash_write_code),
+	/* flash write code, followed by a dummy fifo header for erase only runs */
+	if (target_alloc_working_area(target, sizeof(efm32x_flash_write_code) + 8,
 			&write_algorithm) != ERROR_OK) {
 		LOG_WARNING("no working area available, can't do block memory writes");
 		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
@@ -717,11 +807,13 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 
 	ret = target_write_buffer(target, write_algorithm->address,
 			sizeof(efm32x_flash_write_code), efm32x_flash_write_code);
-	if (ret != ERROR_OK)
+	if (ret != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
 		return ret;
+	}
 
 	/* memory buffer */
-	while (target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
+	while (count && target_alloc_working_area_try(target, buffer_size, &source) != ERROR_OK) {
 		buffer_size /= 2;
 		buffer_size &= ~3UL; /* Make sure it's 4 byte aligned */
 		if (buffer_size <= 256) {
@@ -734,51 +826,77 @@ static int efm32x_write_block(struct flash_bank *bank, const uint8_t *buf,
 		}
 	}
 
+	if (count) {
+		fifo_start = source->address;
+		fifo_end = source->address + source->size;
+	} else {
+		fifo_start = write_algorithm->address + sizeof(efm32x_flash_write_code);
+		fifo_end = fifo_start + 8;
+	}
+
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* flash base (in), status (out) */
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* count (word-32bit) */
 	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer start */
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_OUT);	/* buffer end */
 	init_reg_param(&reg_params[4], "r4", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[5], "r5", 32, PARAM_OUT);	/* first page to erase */
+	init_reg_param(&reg_params[6], "r6", 32, PARAM_OUT);	/* number of pages to erase */
+	init_reg_param(&reg_params[7], "r8", 32, PARAM_OUT);	/* page size */
 
 	buf_set_u32(reg_params[0].value, 0, 32, efm32x_info->reg_base);
 	buf_set_u32(reg_params[1].value, 0, 32, count);
-	buf_set_u32(reg_params[2].value, 0, 32, source->address);
-	buf_set_u32(reg_params[3].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32, fifo_start);
+	buf_set_u32(reg_params[3].value, 0, 32, fifo_end);
 	buf_set_u32(reg_params[4].value, 0, 32, address);
+	buf_set_u32(reg_params[5].value, 0, 32, erase_addr);
+	buf_set_u32(reg_params[6].value, 0, 32, erase_pages);
+	buf_set_u32(reg_params[7].value, 0, 32, bank->sectors[0].size);
 
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
-	ret = target_run_flash_async_algorithm(target, buf, count, 4,
-			0, NULL,
-			5, reg_params,
-			source->address, source->size,
-			write_algorithm->address, 0,
-			&armv7m_info);
+	if (count) {
+		ret = target_run_flash_async_algorithm(target, buf, count, 4,
+				0, NULL,
+				8, reg_params,
+				source->address, source->size,
+				write_algorithm->address, 0,
+				&armv7m_info);
+	} else {
+		ret = target_write_u32(target, fifo_start + 4, fifo_start + 8);
+		if (ret == ERROR_OK)
+			ret = target_run_algorithm(target, 0, NULL, 8, reg_params,
+					write_algorithm->address, 0,
+					EFM32_FLASH_ERASE_TMO * (erase_pages + 1), &armv7m_info);
+		if (ret == ERROR_OK) {
+			uint32_t rp;
+			ret = target_read_u32(target, fifo_start + 4, &rp);
+			if (ret == ERROR_OK && rp == 0)
+				ret = ERROR_FLASH_OPERATION_FAILED;
+		}
+	}
 
 	if (ret == ERROR_FLASH_OPERATION_FAILED) {
-		LOG_ERROR("flash write failed at address 0x%"PRIx32,
+		uint32_t status = buf_get_u32(reg_params[0].value, 0, 32);
+
+		LOG_ERROR("flash %s failed at address 0x%"PRIx32,
+				count ? "write" : "erase",
 				buf_get_u32(reg_params[4].value, 0, 32));
 
-		if (buf_get_u32(reg_params[0].value, 0, 32) &
-				EFM32_MSC_STATUS_LOCKED_MASK) {
+		if (status & EFM32_MSC_STATUS_LOCKED_MASK)
 			LOG_ERROR("flash memory write protected");
-		}
-
-		if (buf_get_u32(reg_params[0].value, 0, 32) &
-				EFM32_MSC_STATUS_INVADDR_MASK) {
+		else if (status & EFM32_MSC_STATUS_INVADDR_MASK)
 			LOG_ERROR("invalid flash memory write address");
-		}
+		else if (count)
+			LOG_ERROR("flash contents differ from the written data");
 	}
 
-	target_free_working_area(target, source);
+	if (count)
+		target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
-	destroy_reg_param(&reg_params[2]);
-	destroy_reg_param(&reg_params[3]);
-	destroy_reg_param(&reg_params[4]);
+	for (int i = 0; i < 8; i++)
+		destroy_reg_param(&reg_params[i]);
 
 	return ret;
 }
@@ -858,8 +976,8 @@ static int efm32x_write_word(struct flash_bank *bank, uint32_t addr,
 	return ERROR_OK;
 }
 
-static int efm32x_write(struct flash_bank *bank, const uint8_t *buffer,
-		uint32_t offset, uint32_t count)
+static int efm32x_priv_write(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count, uint32_t erase_pages)
 {
 	struct target *target = bank->target;
 	uint8_t *new_buffer = NULL;
@@ -900,7 +1018,8 @@ static int efm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		goto cleanup;
 
 	/* try using a block write */
-	retval = efm32x_write_block(bank, buffer, offset, words_remaining);
+	retval = efm32x_write_block(bank, buffer, offset, words_remaining,
+		bank->base + offset, erase_pages);
 
 	if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
 		/* if block write failed (no sufficient working area),
@@ -908,6 +1027,13 @@ static int efm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		LOG_WARNING("couldn't use block writes, falling back to single "
 			"memory accesses");
 
+		for (uint32_t i = 0; i < erase_pages; i++) {
+			retval = efm32x_erase_page(bank,
+				bank->base + offset + i * bank->sectors[0].size);
+			if (retval != ERROR_OK)
+				goto reset_pg_and_lock;
+		}
+
 		while (words_remaining > 0) {
 			uint32_t value;
 			memcpy(&value, buffer, sizeof(uint32_t));
@@ -935,6 +1061,12 @@ cleanup:
 	return retval;
 }
 
+static int efm32x_write(struct flash_bank *bank, const uint8_t *buffer,
+		uint32_t offset, uint32_t count)
+{
+	return efm32x_priv_write(bank, buffer, offset, count, 0);
+}
+
 static int efm32x_probe(struct flash_bank *bank)
 {
 	struct efm32x_flash_bank *efm32x_info = bank->driver_priv;
@@ -946,6 +1078,7 @@ static int efm32x_probe(struct flash_bank *bank)
 
 	efm32x_info->probed = 0;
 	memset(efm32x_info->lb_page, 0xff, LOCKBITS_PAGE_SZ);
+	efm32x_info->lb_flash_valid = false;
 
 	ret = efm32x_read_info(bank, &efm32_mcu_info);
 	if (ERROR_OK != ret)
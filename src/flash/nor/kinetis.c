@@ -127,6 +127,7 @@
 #define FTFx_CMD_BLOCKSTAT  0x00
 #define FTFx_CMD_SECTSTAT   0x01
 #define FTFx_CMD_LWORDPROG  0x06
+#define FTFx_CMD_BLOCKERASE 0x08
 #define FTFx_CMD_SECTERASE  0x09
 #define FTFx_CMD_SECTWRITE  0x0b
 #define FTFx_CMD_MASSERASE  0x44
@@ -1449,6 +1450,83 @@ static int kinetis_fill_fcf(struct flash_bank *bank, uint8_t *fcf)
 	return ERROR_OK;
 }
 
+/* typical and maximum durations of the erase commands, in ms */
+#define FTFx_SECTERASE_TYP_MS	10
+#define FTFx_BLOCKERASE_TYP_MS	100
+#define FTFx_BLOCKERASE_MAX_MS	4000
+
+/*
+ * Wait for CCIF after a command was started.  For commands known to take
+ * a while the first poll is deferred by their typical duration, and the
+ * poll interval grows from there, instead of polling FSTAT back to back.
+ */
+static int kinetis_ftfx_wait(struct target *target, int typical_ms,
+				int timeout_ms, uint8_t *fstat)
+{
+	int64_t ms_timeout = timeval_ms() + timeout_ms;
+	int interval = typical_ms / 8;
+	int result;
+
+	if (typical_ms)
+		alive_sleep(typical_ms);
+
+	do {
+		result = target_read_u8(target, FTFx_FSTAT, fstat);
+		if (result != ERROR_OK)
+			return result;
+
+		if (*fstat & 0x80)
+			break;
+
+		if (interval)
+			alive_sleep(interval);
+	} while (timeval_ms() < ms_timeout);
+
+	return ERROR_OK;
+}
+
+/*
+ * Run an erase command, which only needs the command and address in FCCOB,
+ * and return FSTAT without judging it.
+ */
+static int kinetis_ftfx_erase_raw(struct target *target, uint8_t fcmd,
+				uint32_t faddr, int typical_ms, int timeout_ms, uint8_t *fstat)
+{
+	uint8_t command[4] = {faddr & 0xff, (faddr >> 8) & 0xff, (faddr >> 16) & 0xff, fcmd};
+	int result;
+
+	result = target_write_memory(target, FTFx_FCCOB3, 4, 1, command);
+	if (result != ERROR_OK)
+		return result;
+
+	/* start command */
+	result = target_write_u8(target, FTFx_FSTAT, 0x80);
+	if (result != ERROR_OK)
+		return result;
+
+	return kinetis_ftfx_wait(target, typical_ms, timeout_ms, fstat);
+}
+
+static int kinetis_ftfx_erase_command(struct target *target, uint8_t fcmd,
+				uint32_t faddr, int typical_ms, int timeout_ms)
+{
+	int result;
+	uint8_t fstat;
+
+	result = kinetis_ftfx_erase_raw(target, fcmd, faddr, typical_ms, timeout_ms, &fstat);
+	if (result != ERROR_OK)
+		return result;
+
+	if ((fstat & 0xf0) != 0x80) {
+		LOG_DEBUG("ftfx erase command failed FSTAT: %02X FCMD: %02X FADDR: %06" PRIX32,
+			 fstat, fcmd, faddr);
+
+		return kinetis_ftfx_decode_error(fstat);
+	}
+
+	return ERROR_OK;
+}
+
 static int kinetis_ftfx_command(struct target *target, uint8_t fcmd, uint32_t faddr,
 				uint8_t fccob4, uint8_t fccob5, uint8_t fccob6, uint8_t fccob7,
 				uint8_t fccob8, uint8_t fccob9, uint8_t fccoba, uint8_t fccobb,
@@ -1459,7 +1537,6 @@ static int kinetis_ftfx_command(struct target *target, uint8_t fcmd, uint32_t fa
 			fccobb, fccoba, fccob9, fccob8};
 	int result;
 	uint8_t fstat;
-	int64_t ms_timeout = timeval_ms() + 250;
 
 	result = target_write_memory(target, FTFx_FCCOB3, 4, 3, command);
 	if (result != ERROR_OK)
@@ -1471,16 +1548,9 @@ static int kinetis_ftfx_command(struct target *target, uint8_t fcmd, uint32_t fa
 		return result;
 
 	/* wait for done */
-	do {
-		result = target_read_u8(target, FTFx_FSTAT, &fstat);
-
-		if (result != ERROR_OK)
-			return result;
-
-		if (fstat & 0x80)
-			break;
-
-	} while (timeval_ms() < ms_timeout);
+	result = kinetis_ftfx_wait(target, 0, 250, &fstat);
+	if (result != ERROR_OK)
+		return result;
 
 	if (ftfx_fstat)
 		*ftfx_fstat = fstat;
@@ -1620,18 +1690,46 @@ static int kinetis_erase(struct flash_bank *bank, int first, int last)
 		return ERROR_FLASH_OPERATION_FAILED;
 
 	/*
-	 * FIXME: TODO: use the 'Erase Flash Block' command if the
-	 * requested erase is PFlash or NVM and encompasses the entire
-	 * block.  Should be quicker.
+	 * Each bank is one flash block, so erasing all of it is a single
+	 * 'Erase Flash Block' command instead of one command per sector.
+	 * It is refused if any part of the block is protected or, for
+	 * FlexNVM, backs the EEPROM; fall back to sector erases then.
+	 * A refusal is expected, so FSTAT is checked here without logging
+	 * an error; only a failing sector erase is reported.
 	 */
-	for (i = first; i <= last; i++) {
-		/* set command and sector address */
-		result = kinetis_ftfx_command(bank->target, FTFx_CMD_SECTERASE, k_bank->prog_base + bank->sectors[i].offset,
-				0, 0, 0, 0,  0, 0, 0, 0,  NULL);
+	bool block_erased = false;
+	if (first == 0 && last == bank->num_sectors - 1) {
+		uint8_t fstat;
+		result = kinetis_ftfx_erase_raw(bank->target, FTFx_CMD_BLOCKERASE,
+				k_bank->prog_base, FTFx_BLOCKERASE_TYP_MS, FTFx_BLOCKERASE_MAX_MS,
+				&fstat);
+		if (result != ERROR_OK)
+			return result;
 
-		if (result != ERROR_OK) {
-			LOG_WARNING("erase sector %d failed", i);
-			return ERROR_FLASH_OPERATION_FAILED;
+		if ((fstat & 0xf0) == 0x80) {
+			block_erased = true;
+		} else if (!(fstat & 0x80)) {
+			/* still busy, don't stack sector erases on top of it */
+			return kinetis_ftfx_decode_error(fstat);
+		} else {
+			LOG_DEBUG("erase block refused, FSTAT %02X, erasing sector by sector", fstat);
+			result = kinetis_ftfx_prepare(bank->target);
+			if (result != ERROR_OK)
+				return result;
+		}
+	}
+
+	for (i = first; i <= last; i++) {
+		if (!block_erased) {
+			/* set command and sector address */
+			result = kinetis_ftfx_erase_command(bank->target, FTFx_CMD_SECTERASE,
+					k_bank->prog_base + bank->sectors[i].offset,
+					FTFx_SECTERASE_TYP_MS, 250);
+
+			if (result != ERROR_OK) {
+				LOG_WARNING("erase sector %d failed", i);
+				return ERROR_FLASH_OPERATION_FAILED;
+			}
 		}
 
 		bank->sectors[i].is_erased = 1;
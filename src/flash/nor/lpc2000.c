@@ -259,6 +259,16 @@
 
 #define IAP_CODE_LEN 0x34
 
+/* IAP command list of the trampoline, IAP code and five parameters each */
+#define IAP_LIST_MAX 8
+#define IAP_CMD_LEN 24
+
+/* offset of the fifo_write entry in lpc2000_iap_trampoline */
+#define IAP_FIFO_WRITE_ENTRY 0x14
+
+/* most blocks buffered on the target by the async write */
+#define IAP_FIFO_BLOCKS 8
+
 #define LPC11xx_REG_SECTORS	24
 
 typedef enum {
@@ -283,6 +293,76 @@ struct lpc2000_flash_bank {
 	uint32_t iap_max_stack;
 	uint32_t lpc4300_bank;
 	bool probed;
+	bool iap_trampoline;	/* set if the IAP working area holds the trampoline */
+};
+
+struct lpc2000_iap_cmd {
+	uint32_t code;
+	uint32_t param[5];
+};
+
+/* contrib/loaders/flash/lpc2000_iap.S */
+static const uint8_t lpc2000_iap_trampoline[] = {
+		/* run_list: */
+		0xb5, 0x42,	/* cmp r5, r6 */
+		0x2e, 0xd0,	/* beq done */
+		0x28, 0x46,	/* mov r0, r5 */
+		0x39, 0x46,	/* mov r1, r7 */
+		0xa0, 0x47,	/* blx r4 */
+		0x38, 0x68,	/* ldr r0, [r7] */
+		0x00, 0x28,	/* cmp r0, #0 */
+		0x28, 0xd1,	/* bne done */
+		0x18, 0x35,	/* adds r5, #24 */
+		0xf5, 0xe7,	/* b run_list */
+		/* fifo_write: */
+		0x80, 0x46,	/* mov r8, r0 */
+		0x89, 0x46,	/* mov r9, r1 */
+		0x92, 0x46,	/* mov r10, r2 */
+		/* wait_fifo: */
+		0x40, 0x46,	/* mov r0, r8 */
+		0x01, 0x68,	/* ldr r1, [r0, #0] */
+		0x00, 0x29,	/* cmp r1, #0 */
+		0x1f, 0xd0,	/* beq done */
+		0x42, 0x68,	/* ldr r2, [r0, #4] */
+		0x8a, 0x42,	/* cmp r2, r1 */
+		0xf8, 0xd0,	/* beq wait_fifo */
+		0x2a, 0x62,	/* str r2, [r5, #32] */
+		0x28, 0x46,	/* mov r0, r5 */
+		0x39, 0x46,	/* mov r1, r7 */
+		0xa0, 0x47,	/* blx r4 */
+		0x38, 0x68,	/* ldr r0, [r7] */
+		0x00, 0x28,	/* cmp r0, #0 */
+		0x16, 0xd1,	/* bne error */
+		0x28, 0x46,	/* mov r0, r5 */
+		0x18, 0x30,	/* adds r0, #24 */
+		0x39, 0x46,	/* mov r1, r7 */
+		0xa0, 0x47,	/* blx r4 */
+		0x38, 0x68,	/* ldr r0, [r7] */
+		0x00, 0x28,	/* cmp r0, #0 */
+		0x0f, 0xd1,	/* bne error */
+		0xe8, 0x69,	/* ldr r0, [r5, #28] */
+		0x80, 0x19,	/* adds r0, r0, r6 */
+		0xe8, 0x61,	/* str r0, [r5, #28] */
+		0x2a, 0x6a,	/* ldr r2, [r5, #32] */
+		0x92, 0x19,	/* adds r2, r2, r6 */
+		0x4a, 0x45,	/* cmp r2, r9 */
+		0x01, 0xd3,	/* bcc no_wrap */
+		0x42, 0x46,	/* mov r2, r8 */
+		0x08, 0x32,	/* adds r2, #8 */
+		/* no_wrap: */
+		0x40, 0x46,	/* mov r0, r8 */
+		0x42, 0x60,	/* str r2, [r0, #4] */
+		0x50, 0x46,	/* mov r0, r10 */
+		0x01, 0x38,	/* subs r0, #1 */
+		0x82, 0x46,	/* mov r10, r0 */
+		0xdb, 0xd1,	/* bne wait_fifo */
+		/* done: */
+		0x00, 0xbe,	/* bkpt #0 */
+		/* error: */
+		0x00, 0x21,	/* movs r1, #0 */
+		0x40, 0x46,	/* mov r0, r8 */
+		0x41, 0x60,	/* str r1, [r0, #4] */
+		0x00, 0xbe,	/* bkpt #0 */
 };
 
 enum lpc2000_status_codes {
@@ -648,8 +728,11 @@ static int lpc2000_build_sector_list(struct flash_bank *bank)
  * 0x0 to 0x7: jump gate (BX to thumb state, b -2 to wait)
  * 0x8 to 0x1f: command parameter table (1+5 words)
  * 0x20 to 0x33: command result table (1+4 words)
- * 0x34 to 0xb3|0x104: stack
+ * 0x34 to the end: stack
  *        (128b needed for lpc1xxx/2000/5410x, 208b for lpc43xx/lpc82x and 148b for lpc81x)
+ *
+ * On the Cortex-M parts the IAP trampoline and its command list go between
+ * the result table and the stack, if the working area is large enough.
  */
 
 static int lpc2000_iap_working_area_init(struct flash_bank *bank, struct working_area **iap_working_area)
@@ -657,7 +740,20 @@ static int lpc2000_iap_working_area_init(struct flash_bank *bank, struct working
 	struct target *target = bank->target;
 	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
 
-	if (target_alloc_working_area(target, IAP_CODE_LEN + lpc2000_info->iap_max_stack, iap_working_area) != ERROR_OK) {
+	lpc2000_info->iap_trampoline = false;
+	if (lpc2000_info->variant != lpc2000_v1 && lpc2000_info->variant != lpc2000_v2
+			&& target_alloc_working_area_try(target, IAP_CODE_LEN + sizeof(lpc2000_iap_trampoline)
+				+ IAP_LIST_MAX * IAP_CMD_LEN + lpc2000_info->iap_max_stack, iap_working_area) == ERROR_OK) {
+		if (target_write_buffer(target, (*iap_working_area)->address + IAP_CODE_LEN,
+				sizeof(lpc2000_iap_trampoline), lpc2000_iap_trampoline) == ERROR_OK)
+			lpc2000_info->iap_trampoline = true;
+		else
+			target_free_working_area(target, *iap_working_area);
+	}
+
+	if (!lpc2000_info->iap_trampoline
+			&& target_alloc_working_area(target, IAP_CODE_LEN + lpc2000_info->iap_max_stack,
+				iap_working_area) != ERROR_OK) {
 		LOG_ERROR("no working area specified, can't write LPC2000 internal flash");
 		return ERROR_FLASH_OPERATION_FAILED;
 	}
@@ -696,16 +792,9 @@ static int lpc2000_iap_working_area_init(struct flash_bank *bank, struct working
 	return retval;
 }
 
-/* call LPC8xx/LPC1xxx/LPC4xxx/LPC5410x/LPC2000 IAP function */
-
-static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_working_area, int code,
-		uint32_t param_table[5], uint32_t result_table[4])
+static uint32_t lpc2000_iap_entry_point(struct flash_bank *bank)
 {
 	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
-	struct target *target = bank->target;
-
-	struct arm_algorithm arm_algo;	/* for LPC2000 */
-	struct armv7m_algorithm armv7m_info;	/* for LPC8xx/LPC1xxx/LPC4xxx/LPC5410x */
 	uint32_t iap_entry_point = 0;	/* to make compiler happier */
 
 	switch (lpc2000_info->variant) {
@@ -713,34 +802,53 @@ static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_wo
 		case lpc1100:
 		case lpc1700:
 		case lpc_auto:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
 			iap_entry_point = 0x1fff1ff1;
 			break;
 		case lpc1500:
 		case lpc54100:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
 			iap_entry_point = 0x03000205;
 			break;
 		case lpc2000_v1:
 		case lpc2000_v2:
-			arm_algo.common_magic = ARM_COMMON_MAGIC;
-			arm_algo.core_mode = ARM_MODE_SVC;
-			arm_algo.core_state = ARM_STATE_ARM;
 			iap_entry_point = 0x7ffffff1;
 			break;
 		case lpc4300:
-			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
-			armv7m_info.core_mode = ARM_MODE_THREAD;
 			/* read out IAP entry point from ROM driver table at 0x10400100 */
-			target_read_u32(target, 0x10400100, &iap_entry_point);
+			target_read_u32(bank->target, 0x10400100, &iap_entry_point);
 			break;
 		default:
 			LOG_ERROR("BUG: unknown lpc2000->variant encountered");
 			exit(-1);
 	}
 
+	return iap_entry_point;
+}
+
+/* call LPC8xx/LPC1xxx/LPC4xxx/LPC5410x/LPC2000 IAP function */
+
+static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_working_area, int code,
+		uint32_t param_table[5], uint32_t result_table[4])
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	struct target *target = bank->target;
+
+	struct arm_algorithm arm_algo;	/* for LPC2000 */
+	struct armv7m_algorithm armv7m_info;	/* for LPC8xx/LPC1xxx/LPC4xxx/LPC5410x */
+	uint32_t iap_entry_point = lpc2000_iap_entry_point(bank);
+
+	switch (lpc2000_info->variant) {
+		case lpc2000_v1:
+		case lpc2000_v2:
+			arm_algo.common_magic = ARM_COMMON_MAGIC;
+			arm_algo.core_mode = ARM_MODE_SVC;
+			arm_algo.core_state = ARM_STATE_ARM;
+			break;
+		default:
+			armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+			armv7m_info.core_mode = ARM_MODE_THREAD;
+			break;
+	}
+
 	struct mem_param mem_params[2];
 
 	/* command parameter table */
@@ -777,8 +885,7 @@ static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_wo
 		case lpc_auto:
 			/* IAP stack */
 			init_reg_param(&reg_params[3], "sp", 32, PARAM_OUT);
-			buf_set_u32(reg_params[3].value, 0, 32,
-				iap_working_area->address + IAP_CODE_LEN + lpc2000_info->iap_max_stack);
+			buf_set_u32(reg_params[3].value, 0, 32, iap_working_area->address + iap_working_area->size);
 
 			/* return address */
 			init_reg_param(&reg_params[4], "lr", 32, PARAM_OUT);
@@ -792,8 +899,7 @@ static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_wo
 		case lpc2000_v2:
 			/* IAP stack */
 			init_reg_param(&reg_params[3], "sp_svc", 32, PARAM_OUT);
-			buf_set_u32(reg_params[3].value, 0, 32,
-				iap_working_area->address + IAP_CODE_LEN + lpc2000_info->iap_max_stack);
+			buf_set_u32(reg_params[3].value, 0, 32, iap_working_area->address + iap_working_area->size);
 
 			/* return address */
 			init_reg_param(&reg_params[4], "lr_svc", 32, PARAM_OUT);
@@ -829,12 +935,199 @@ static int lpc2000_iap_call(struct flash_bank *bank, struct working_area *iap_wo
 	return status_code;
 }
 
+static int lpc2000_iap_retval(int status_code, const char *what)
+{
+	switch (status_code) {
+		case ERROR_FLASH_OPERATION_FAILED:
+			return ERROR_FLASH_OPERATION_FAILED;
+		case LPC2000_CMD_SUCCESS:
+			return ERROR_OK;
+		case LPC2000_INVALID_SECTOR:
+			return ERROR_FLASH_SECTOR_INVALID;
+		default:
+			LOG_WARNING("lpc2000 %s returned %i", what, status_code);
+			return ERROR_FLASH_OPERATION_FAILED;
+	}
+}
+
+/* the trampoline registers common to both entries: r4, r5, r7 and sp */
+static void lpc2000_iap_trampoline_regs(struct flash_bank *bank, struct working_area *iap_working_area,
+		struct reg_param *reg_params)
+{
+	uint32_t list = iap_working_area->address + IAP_CODE_LEN + sizeof(lpc2000_iap_trampoline);
+
+	init_reg_param(&reg_params[0], "r4", 32, PARAM_OUT);
+	buf_set_u32(reg_params[0].value, 0, 32, lpc2000_iap_entry_point(bank));
+	init_reg_param(&reg_params[1], "r5", 32, PARAM_IN_OUT);
+	buf_set_u32(reg_params[1].value, 0, 32, list);
+	init_reg_param(&reg_params[2], "r7", 32, PARAM_OUT);
+	buf_set_u32(reg_params[2].value, 0, 32, iap_working_area->address + 0x20);
+	init_reg_param(&reg_params[3], "sp", 32, PARAM_OUT);
+	buf_set_u32(reg_params[3].value, 0, 32, iap_working_area->address + iap_working_area->size);
+}
+
+static int lpc2000_iap_write_list(struct flash_bank *bank, struct working_area *iap_working_area,
+		const struct lpc2000_iap_cmd *cmds, int num_cmds)
+{
+	uint8_t buf[IAP_LIST_MAX * IAP_CMD_LEN];
+
+	for (int i = 0; i < num_cmds; i++) {
+		target_buffer_set_u32(bank->target, buf + i * IAP_CMD_LEN, cmds[i].code);
+		target_buffer_set_u32_array(bank->target, buf + i * IAP_CMD_LEN + 4, 5, cmds[i].param);
+	}
+
+	return target_write_buffer(bank->target,
+			iap_working_area->address + IAP_CODE_LEN + sizeof(lpc2000_iap_trampoline),
+			num_cmds * IAP_CMD_LEN, buf);
+}
+
+/* Run IAP commands in order until one of them fails, with one target
+ * invocation per IAP_LIST_MAX commands when the trampoline is available.
+ * Returns the status code of the failing command, or LPC2000_CMD_SUCCESS,
+ * and stores the number of commands which succeeded in *done.
+ */
+static int lpc2000_iap_run_list(struct flash_bank *bank, struct working_area *iap_working_area,
+		const struct lpc2000_iap_cmd *cmds, int num_cmds, int *done, uint32_t result_table[4])
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	struct target *target = bank->target;
+	int status_code = LPC2000_CMD_SUCCESS;
+
+	*done = 0;
+
+	if (!lpc2000_info->iap_trampoline) {
+		for (; *done < num_cmds; (*done)++) {
+			uint32_t param_table[5];
+			memcpy(param_table, cmds[*done].param, sizeof(param_table));
+			status_code = lpc2000_iap_call(bank, iap_working_area, cmds[*done].code, param_table,
+					result_table);
+			if (status_code != LPC2000_CMD_SUCCESS)
+				break;
+		}
+		return status_code;
+	}
+
+	struct armv7m_algorithm armv7m_info;
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	struct reg_param reg_params[5];
+	lpc2000_iap_trampoline_regs(bank, iap_working_area, reg_params);
+	init_reg_param(&reg_params[4], "r6", 32, PARAM_OUT);
+
+	uint32_t list = iap_working_area->address + IAP_CODE_LEN + sizeof(lpc2000_iap_trampoline);
+	uint8_t result[5 * 4];
+
+	while (*done < num_cmds) {
+		int n = MIN(num_cmds - *done, IAP_LIST_MAX);
+
+		int retval = lpc2000_iap_write_list(bank, iap_working_area, cmds + *done, n);
+		if (retval == ERROR_OK) {
+			buf_set_u32(reg_params[1].value, 0, 32, list);
+			buf_set_u32(reg_params[4].value, 0, 32, list + n * IAP_CMD_LEN);
+			retval = target_run_algorithm(target, 0, NULL, 5, reg_params,
+					iap_working_area->address + IAP_CODE_LEN, 0, 10000 + 1000 * n, &armv7m_info);
+		}
+		if (retval == ERROR_OK)
+			retval = target_read_buffer(target, iap_working_area->address + 0x20, sizeof(result), result);
+		if (retval != ERROR_OK) {
+			status_code = ERROR_FLASH_OPERATION_FAILED;
+			break;
+		}
+
+		int completed = (buf_get_u32(reg_params[1].value, 0, 32) - list) / IAP_CMD_LEN;
+		status_code = target_buffer_get_u32(target, result);
+		target_buffer_get_u32_array(target, result + 4, 4, result_table);
+
+		LOG_DEBUG("IAP command list of %i completed %i, result = %8.8x", n, completed, status_code);
+
+		*done += completed;
+		if (status_code != LPC2000_CMD_SUCCESS)
+			break;
+	}
+
+	for (int i = 0; i < 5; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	return status_code;
+}
+
+/* Program whole blocks of cmd51_max_buffer bytes through the trampoline's
+ * fifo, so the next block is downloaded while the IAP programs the previous
+ * one.  Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if the fifo does not fit.
+ */
+static int lpc2000_iap_write_async(struct flash_bank *bank, struct working_area *iap_working_area,
+		const uint8_t *buffer, uint32_t address, uint32_t num_blocks, const struct lpc2000_iap_cmd *prepare)
+{
+	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
+	struct target *target = bank->target;
+	uint32_t block_size = lpc2000_info->cmd51_max_buffer;
+	struct working_area *fifo;
+	int retval;
+
+	/* one block being programmed, one being downloaded and one spare, as
+	 * the async algorithm never fills the fifo completely */
+	uint32_t blocks = MIN(num_blocks + 1, (uint32_t)IAP_FIFO_BLOCKS);
+	if (blocks < 3)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	while (target_alloc_working_area_try(target, 8 + blocks * block_size, &fifo) != ERROR_OK) {
+		if (--blocks < 3)
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	struct lpc2000_iap_cmd cmds[2] = {
+		*prepare,
+		{ 51, { address, 0, block_size, lpc2000_info->cclk, 0 } },
+	};
+	retval = lpc2000_iap_write_list(bank, iap_working_area, cmds, 2);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, fifo);
+		return retval;
+	}
+
+	struct armv7m_algorithm armv7m_info;
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	struct reg_param reg_params[8];
+	lpc2000_iap_trampoline_regs(bank, iap_working_area, reg_params);
+	init_reg_param(&reg_params[4], "r0", 32, PARAM_OUT);
+	buf_set_u32(reg_params[4].value, 0, 32, fifo->address);
+	init_reg_param(&reg_params[5], "r1", 32, PARAM_OUT);
+	buf_set_u32(reg_params[5].value, 0, 32, fifo->address + 8 + blocks * block_size);
+	init_reg_param(&reg_params[6], "r2", 32, PARAM_OUT);
+	buf_set_u32(reg_params[6].value, 0, 32, num_blocks);
+	init_reg_param(&reg_params[7], "r6", 32, PARAM_OUT);
+	buf_set_u32(reg_params[7].value, 0, 32, block_size);
+
+	LOG_DEBUG("writing %" PRIu32 " blocks of 0x%" PRIx32 " bytes to 0x%" PRIx32 " through a %" PRIu32 " block fifo",
+			num_blocks, block_size, address, blocks);
+
+	retval = target_run_flash_async_algorithm(target, buffer, num_blocks, block_size,
+			0, NULL, 8, reg_params, fifo->address, 8 + blocks * block_size,
+			iap_working_area->address + IAP_CODE_LEN + IAP_FIFO_WRITE_ENTRY, 0, &armv7m_info);
+
+	if (retval == ERROR_FLASH_OPERATION_FAILED) {
+		/* the trampoline stopped on an IAP error, report its status */
+		uint32_t status_code;
+		if (target_read_u32(target, iap_working_area->address + 0x20, &status_code) == ERROR_OK
+				&& status_code != LPC2000_CMD_SUCCESS)
+			retval = lpc2000_iap_retval(status_code, "write");
+	}
+
+	for (int i = 0; i < 8; i++)
+		destroy_reg_param(&reg_params[i]);
+
+	target_free_working_area(target, fifo);
+
+	return retval;
+}
+
 static int lpc2000_iap_blank_check(struct flash_bank *bank, int first, int last)
 {
 	if ((first < 0) || (last >= bank->num_sectors))
 		return ERROR_FLASH_SECTOR_INVALID;
 
-	uint32_t param_table[5] = {0};
 	uint32_t result_table[4];
 	struct working_area *iap_working_area;
 
@@ -844,26 +1137,42 @@ static int lpc2000_iap_blank_check(struct flash_bank *bank, int first, int last)
 		return retval;
 
 	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
-	if (lpc2000_info->variant == lpc4300)
-		param_table[2] = lpc2000_info->lpc4300_bank;
+	int num_cmds = last - first + 1;
+	struct lpc2000_iap_cmd *cmds = calloc(num_cmds, sizeof(*cmds));
+	if (!cmds) {
+		target_free_working_area(bank->target, iap_working_area);
+		return ERROR_FAIL;
+	}
 
-	for (int i = first; i <= last && retval == ERROR_OK; i++) {
-		/* check single sector */
-		param_table[0] = param_table[1] = i;
-		int status_code = lpc2000_iap_call(bank, iap_working_area, 53, param_table, result_table);
+	/* check single sectors, so a non blank one does not hide the others */
+	for (int i = 0; i < num_cmds; i++) {
+		cmds[i].code = 53;
+		cmds[i].param[0] = cmds[i].param[1] = first + i;
+		if (lpc2000_info->variant == lpc4300)
+			cmds[i].param[2] = lpc2000_info->lpc4300_bank;
+	}
+
+	/* the list stops at the first sector which is not blank, resume after it */
+	for (int i = 0; i < num_cmds && retval == ERROR_OK; i++) {
+		int done;
+		int status_code = lpc2000_iap_run_list(bank, iap_working_area, cmds + i, num_cmds - i, &done,
+				result_table);
+
+		for (int j = 0; j < done; j++)
+			bank->sectors[first + i + j].is_erased = 1;
+		i += done;
+		if (i == num_cmds)
+			break;
 
 		switch (status_code) {
 			case ERROR_FLASH_OPERATION_FAILED:
 				retval = ERROR_FLASH_OPERATION_FAILED;
 				break;
-			case LPC2000_CMD_SUCCESS:
-				bank->sectors[i].is_erased = 1;
-				break;
 			case LPC2000_SECTOR_NOT_BLANK:
-				bank->sectors[i].is_erased = 0;
+				bank->sectors[first + i].is_erased = 0;
 				break;
 			case LPC2000_INVALID_SECTOR:
-				bank->sectors[i].is_erased = 0;
+				bank->sectors[first + i].is_erased = 0;
 				break;
 			case LPC2000_BUSY:
 				retval = ERROR_FLASH_BUSY;
@@ -874,6 +1183,8 @@ static int lpc2000_iap_blank_check(struct flash_bank *bank, int first, int last)
 		}
 	}
 
+	free(cmds);
+
 	struct target *target = bank->target;
 	target_free_working_area(target, iap_working_area);
 
@@ -950,16 +1261,8 @@ static int lpc2000_erase(struct flash_bank *bank, int first, int last)
 	}
 
 	struct lpc2000_flash_bank *lpc2000_info = bank->driver_priv;
-	uint32_t param_table[5] = {0};
-
-	param_table[0] = first;
-	param_table[1] = last;
-
-	if (lpc2000_info->variant == lpc4300)
-		param_table[2] = lpc2000_info->lpc4300_bank;
-	else
-		param_table[2] = lpc2000_info->cclk;
-
+	struct lpc2000_iap_cmd cmds[2];
+	int num_cmds = 0;
 	uint32_t result_table[4];
 	struct working_area *iap_working_area;
 
@@ -968,49 +1271,24 @@ static int lpc2000_erase(struct flash_bank *bank, int first, int last)
 	if (retval != ERROR_OK)
 		return retval;
 
-	if (lpc2000_info->variant == lpc4300)
+	if (lpc2000_info->variant == lpc4300) {
 		/* Init IAP Anyway */
+		uint32_t param_table[5] = {0};
 		lpc2000_iap_call(bank, iap_working_area, 49, param_table, result_table);
+	}
 
 	/* Prepare sectors */
-	int status_code = lpc2000_iap_call(bank, iap_working_area, 50, param_table, result_table);
-	switch (status_code) {
-		case ERROR_FLASH_OPERATION_FAILED:
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-		case LPC2000_CMD_SUCCESS:
-			break;
-		case LPC2000_INVALID_SECTOR:
-			retval = ERROR_FLASH_SECTOR_INVALID;
-			break;
-		default:
-			LOG_WARNING("lpc2000 prepare sectors returned %i", status_code);
-			retval = ERROR_FLASH_OPERATION_FAILED;
-			break;
-	}
+	cmds[num_cmds++] = (struct lpc2000_iap_cmd) { 50, { first, last,
+		lpc2000_info->variant == lpc4300 ? lpc2000_info->lpc4300_bank : lpc2000_info->cclk } };
 
-	if (retval == ERROR_OK) {
-		/* Erase sectors */
-		param_table[2] = lpc2000_info->cclk;
-		if (lpc2000_info->variant == lpc4300)
-			param_table[3] = lpc2000_info->lpc4300_bank;
+	/* Erase sectors */
+	cmds[num_cmds++] = (struct lpc2000_iap_cmd) { 52, { first, last, lpc2000_info->cclk,
+		lpc2000_info->variant == lpc4300 ? lpc2000_info->lpc4300_bank : 0 } };
 
-		status_code = lpc2000_iap_call(bank, iap_working_area, 52, param_table, result_table);
-		switch (status_code) {
-			case ERROR_FLASH_OPERATION_FAILED:
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-			case LPC2000_CMD_SUCCESS:
-				break;
-			case LPC2000_INVALID_SECTOR:
-				retval = ERROR_FLASH_SECTOR_INVALID;
-				break;
-			default:
-				LOG_WARNING("lpc2000 erase sectors returned %i", status_code);
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-		}
-	}
+	int done;
+	int status_code = lpc2000_iap_run_list(bank, iap_working_area, cmds, num_cmds, &done, result_table);
+	if (status_code != LPC2000_CMD_SUCCESS)
+		retval = lpc2000_iap_retval(status_code, done == 0 ? "prepare sectors" : "erase sectors");
 
 	struct target *target = bank->target;
 	target_free_working_area(target, iap_working_area);
@@ -1088,15 +1366,7 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	if (retval != ERROR_OK)
 		return retval;
 
-	struct working_area *download_area;
-
-	/* allocate a working area */
-	if (target_alloc_working_area(target, lpc2000_info->cmd51_max_buffer, &download_area) != ERROR_OK) {
-		LOG_ERROR("no working area specified, can't write LPC2000 internal flash");
-		target_free_working_area(target, iap_working_area);
-		return ERROR_FLASH_OPERATION_FAILED;
-	}
-
+	struct working_area *download_area = NULL;
 	uint32_t bytes_remaining = count;
 	uint32_t bytes_written = 0;
 	uint32_t param_table[5] = {0};
@@ -1106,42 +1376,40 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 		/* Init IAP Anyway */
 		lpc2000_iap_call(bank, iap_working_area, 49, param_table, result_table);
 
-	while (bytes_remaining > 0) {
+	/* Prepare sectors, before every copy RAM to flash */
+	struct lpc2000_iap_cmd cmds[2] = {
+		{ 50, { first_sector, last_sector,
+			lpc2000_info->variant == lpc4300 ? lpc2000_info->lpc4300_bank : lpc2000_info->cclk } },
+	};
+
+	/* stream the whole blocks if the trampoline and a fifo fit */
+	uint32_t num_blocks = count / lpc2000_info->cmd51_max_buffer;
+	if (lpc2000_info->iap_trampoline && num_blocks) {
+		retval = lpc2000_iap_write_async(bank, iap_working_area, buffer, bank->base + offset,
+				num_blocks, &cmds[0]);
+		if (retval == ERROR_OK) {
+			bytes_written = num_blocks * lpc2000_info->cmd51_max_buffer;
+			bytes_remaining -= bytes_written;
+		} else if (retval == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+			LOG_DEBUG("no room for a write fifo, programming block by block");
+			retval = ERROR_OK;
+		}
+	}
+
+	/* allocate a working area */
+	if (retval == ERROR_OK && bytes_remaining > 0
+			&& target_alloc_working_area(target, lpc2000_info->cmd51_max_buffer, &download_area) != ERROR_OK) {
+		LOG_ERROR("no working area specified, can't write LPC2000 internal flash");
+		retval = ERROR_FLASH_OPERATION_FAILED;
+	}
+
+	while (bytes_remaining > 0 && retval == ERROR_OK) {
 		uint32_t thisrun_bytes;
 		if (bytes_remaining >= lpc2000_info->cmd51_max_buffer)
 			thisrun_bytes = lpc2000_info->cmd51_max_buffer;
 		else
 			thisrun_bytes = lpc2000_info->cmd51_dst_boundary;
 
-		/* Prepare sectors */
-		param_table[0] = first_sector;
-		param_table[1] = last_sector;
-
-		if (lpc2000_info->variant == lpc4300)
-			param_table[2] = lpc2000_info->lpc4300_bank;
-		else
-			param_table[2] = lpc2000_info->cclk;
-
-		int status_code = lpc2000_iap_call(bank, iap_working_area, 50, param_table, result_table);
-		switch (status_code) {
-			case ERROR_FLASH_OPERATION_FAILED:
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-			case LPC2000_CMD_SUCCESS:
-				break;
-			case LPC2000_INVALID_SECTOR:
-				retval = ERROR_FLASH_SECTOR_INVALID;
-				break;
-			default:
-				LOG_WARNING("lpc2000 prepare sectors returned %i", status_code);
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-		}
-
-		/* Exit if error occured */
-		if (retval != ERROR_OK)
-			break;
-
 		if (bytes_remaining >= thisrun_bytes) {
 			retval = target_write_buffer(bank->target, download_area->address, thisrun_bytes, buffer + bytes_written);
 			if (retval != ERROR_OK) {
@@ -1159,26 +1427,14 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 		LOG_DEBUG("writing 0x%" PRIx32 " bytes to address 0x%" PRIx32, thisrun_bytes,
 				bank->base + offset + bytes_written);
 
-		/* Write data */
-		param_table[0] = bank->base + offset + bytes_written;
-		param_table[1] = download_area->address;
-		param_table[2] = thisrun_bytes;
-		param_table[3] = lpc2000_info->cclk;
-		status_code = lpc2000_iap_call(bank, iap_working_area, 51, param_table, result_table);
-		switch (status_code) {
-			case ERROR_FLASH_OPERATION_FAILED:
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-			case LPC2000_CMD_SUCCESS:
-				break;
-			case LPC2000_INVALID_SECTOR:
-				retval = ERROR_FLASH_SECTOR_INVALID;
-				break;
-			default:
-				LOG_WARNING("lpc2000 returned %i", status_code);
-				retval = ERROR_FLASH_OPERATION_FAILED;
-				break;
-		}
+		/* Prepare sectors and write data */
+		cmds[1] = (struct lpc2000_iap_cmd) { 51, { bank->base + offset + bytes_written,
+			download_area->address, thisrun_bytes, lpc2000_info->cclk } };
+
+		int done;
+		int status_code = lpc2000_iap_run_list(bank, iap_working_area, cmds, 2, &done, result_table);
+		if (status_code != LPC2000_CMD_SUCCESS)
+			retval = lpc2000_iap_retval(status_code, done == 0 ? "prepare sectors" : "write");
 
 		/* Exit if error occured */
 		if (retval != ERROR_OK)
@@ -1192,7 +1448,8 @@ static int lpc2000_write(struct flash_bank *bank, const uint8_t *buffer, uint32_
 	}
 
 	target_free_working_area(target, iap_working_area);
-	target_free_working_area(target, download_area);
+	if (download_area)
+		target_free_working_area(target, download_area);
 
 	return retval;
 }
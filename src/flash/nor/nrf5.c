@@ -26,6 +26,7 @@
 #include <target/algorithm.h>
 #include <target/armv7m.h>
 #include <helper/types.h>
+#include <helper/time_support.h>
 
 enum {
 	NRF5_FLASH_BASE = 0x00000000,
@@ -620,64 +621,129 @@ static int nrf5_erase_page(struct flash_bank *bank,
 }
 
 static const uint8_t nrf5_flash_write_code[] = {
-	/* See contrib/loaders/flash/cortex-m0.S */
+	/* See contrib/loaders/flash/nrf5.S */
+	0x1c, 0x4f,		/* ldr	r7, [pc, #112] */
+	0x01, 0x25,		/* movs	r5, #1 */
+	0x3d, 0x60,		/* str	r5, [r7, #0] */
+	0x00, 0xf0, 0x30, 0xf8,	/* bl	6a <wait_ready> */
+/* <next_word>: */
+	0x33, 0x42,		/* tst	r3, r6 */
+	0x10, 0xd1,		/* bne.n	30 <wait_fifo> */
+	0x00, 0x2a,		/* cmp	r2, #0 */
+	0x0e, 0xd0,		/* beq.n	30 <wait_fifo> */
+	0x15, 0x78,		/* ldrb	r5, [r2, #0] */
+	0x01, 0x32,		/* adds	r2, #1 */
+	0x00, 0x2d,		/* cmp	r5, #0 */
+	0x0a, 0xd0,		/* beq.n	30 <wait_fifo> */
+	0x02, 0x25,		/* movs	r5, #2 */
+	0x3d, 0x60,		/* str	r5, [r7, #0] */
+	0x00, 0xf0, 0x24, 0xf8,	/* bl	6a <wait_ready> */
+	0x7b, 0x60,		/* str	r3, [r7, #4] */
+	0x00, 0xf0, 0x21, 0xf8,	/* bl	6a <wait_ready> */
+	0x01, 0x25,		/* movs	r5, #1 */
+	0x3d, 0x60,		/* str	r5, [r7, #0] */
+	0x00, 0xf0, 0x1d, 0xf8,	/* bl	6a <wait_ready> */
 /* <wait_fifo>: */
-	0x0d, 0x68,		/* ldr	r5,	[r1,	#0] */
-	0x00, 0x2d,		/* cmp	r5,	#0 */
-	0x0b, 0xd0,		/* beq.n	1e <exit> */
-	0x4c, 0x68,		/* ldr	r4,	[r1,	#4] */
-	0xac, 0x42,		/* cmp	r4,	r5 */
-	0xf9, 0xd0,		/* beq.n	0 <wait_fifo> */
-	0x20, 0xcc,		/* ldmia	r4!,	{r5} */
-	0x20, 0xc3,		/* stmia	r3!,	{r5} */
-	0x94, 0x42,		/* cmp	r4,	r2 */
-	0x01, 0xd3,		/* bcc.n	18 <no_wrap> */
-	0x0c, 0x46,		/* mov	r4,	r1 */
-	0x08, 0x34,		/* adds	r4,	#8 */
+	0x0d, 0x68,		/* ldr	r5, [r1, #0] */
+	0x00, 0x2d,		/* cmp	r5, #0 */
+	0x14, 0xd0,		/* beq.n	60 <exit> */
+	0x4c, 0x68,		/* ldr	r4, [r1, #4] */
+	0xac, 0x42,		/* cmp	r4, r5 */
+	0xf9, 0xd0,		/* beq.n	30 <wait_fifo> */
+	0x20, 0xcc,		/* ldmia	r4!, {r5} */
+	0x44, 0x45,		/* cmp	r4, r8 */
+	0x01, 0xd3,		/* bcc.n	46 <no_wrap> */
+	0x0c, 0x46,		/* mov	r4, r1 */
+	0x08, 0x34,		/* adds	r4, #8 */
 /* <no_wrap>: */
-	0x4c, 0x60,		/* str	r4, [r1,	#4] */
+	0x4c, 0x60,		/* str	r4, [r1, #4] */
+	0x1d, 0x60,		/* str	r5, [r3, #0] */
+	0x00, 0xf0, 0x0e, 0xf8,	/* bl	6a <wait_ready> */
+	0x1c, 0x68,		/* ldr	r4, [r3, #0] */
+	0xac, 0x42,		/* cmp	r4, r5 */
+	0x03, 0xd1,		/* bne.n	5c <verify_failed> */
+	0x04, 0x33,		/* adds	r3, #4 */
 	0x04, 0x38,		/* subs	r0, #4 */
-	0xf0, 0xd1,		/* bne.n	0 <wait_fifo> */
+	0xd7, 0xd1,		/* bne.n	a <next_word> */
+	0x01, 0xe0,		/* b.n	60 <exit> */
+/* <verify_failed>: */
+	0x00, 0x24,		/* movs	r4, #0 */
+	0x4c, 0x60,		/* str	r4, [r1, #4] */
 /* <exit>: */
-	0x00, 0xbe		/* bkpt	0x0000 */
+	0x00, 0x25,		/* movs	r5, #0 */
+	0x3d, 0x60,		/* str	r5, [r7, #0] */
+	0x00, 0xf0, 0x01, 0xf8,	/* bl	6a <wait_ready> */
+	0x00, 0xbe,		/* bkpt	0x0000 */
+/* <wait_ready>: */
+	0x03, 0x4c,		/* ldr	r4, [pc, #12] */
+	0x24, 0x68,		/* ldr	r4, [r4, #0] */
+	0x00, 0x2c,		/* cmp	r4, #0 */
+	0xfb, 0xd0,		/* beq.n	6a <wait_ready> */
+	0x70, 0x47,		/* bx	lr */
+	0x04, 0xe5, 0x01, 0x40,	/* .word	0x4001e504 (NVMC_CONFIG) */
+	0x00, 0xe4, 0x01, 0x40,	/* .word	0x4001e400 (NVMC_READY) */
 };
 
+/* Program word by word with plain memory writes, for when there is no
+ * working area to run the loader from */
+static int nrf5_slow_flash_write(struct nrf5_info *chip, uint32_t address, const uint8_t *buffer, uint32_t bytes)
+{
+	int res;
 
-/* Start a low level flash write for the specified region */
-static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t offset, const uint8_t *buffer, uint32_t bytes)
+	res = nrf5_nvmc_write_enable(chip);
+	if (res != ERROR_OK)
+		return res;
+
+	for (; bytes > 0; bytes -= 4) {
+		res = target_write_memory(chip->target, address, 4, 1, buffer);
+		if (res != ERROR_OK)
+			goto set_read_only;
+
+		res = nrf5_wait_for_nvmc(chip);
+		if (res != ERROR_OK)
+			goto set_read_only;
+
+		address += 4;
+		buffer += 4;
+	}
+
+	return nrf5_nvmc_read_only(chip);
+
+set_read_only:
+	nrf5_nvmc_read_only(chip);
+	return res;
+}
+
+/* Start a low level flash write for the specified region.
+ *
+ * The loader erases the pages flagged in erase_map (one byte per page of
+ * page_size bytes, NULL for none) as it reaches them, programs and reads
+ * back every word, and leaves the NVMC read only when done.  Returns
+ * ERROR_TARGET_RESOURCE_NOT_AVAILABLE without touching the flash if it
+ * cannot be run, so the caller can fall back to host driven programming.
+ */
+static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t address, const uint8_t *buffer, uint32_t bytes,
+		const uint8_t *erase_map, uint32_t page_size)
 {
 	struct target *target = chip->target;
 	uint32_t buffer_size = 8192;
 	struct working_area *write_algorithm;
 	struct working_area *source;
-	uint32_t address = NRF5_FLASH_BASE + offset;
-	struct reg_param reg_params[4];
+	struct reg_param reg_params[6];
 	struct armv7m_algorithm armv7m_info;
+	uint32_t map_size = erase_map ? bytes / page_size : 0;
 	int retval = ERROR_OK;
 
 
-	LOG_DEBUG("Writing buffer to flash offset=0x%"PRIx32" bytes=0x%"PRIx32, offset, bytes);
+	LOG_DEBUG("Writing buffer to flash address=0x%"PRIx32" bytes=0x%"PRIx32, address, bytes);
 	assert(bytes % 4 == 0);
 
-	/* allocate working area with flash programming code */
-	if (target_alloc_working_area(target, sizeof(nrf5_flash_write_code),
+	/* allocate working area with flash programming code, the erase map
+	 * goes right after it */
+	if (target_alloc_working_area(target, sizeof(nrf5_flash_write_code) + map_size,
 			&write_algorithm) != ERROR_OK) {
 		LOG_WARNING("no working area available, falling back to slow memory writes");
-
-		for (; bytes > 0; bytes -= 4) {
-			retval = target_write_memory(chip->target, offset, 4, 1, buffer);
-			if (retval != ERROR_OK)
-				return retval;
-
-			retval = nrf5_wait_for_nvmc(chip);
-			if (retval != ERROR_OK)
-				return retval;
-
-			offset += 4;
-			buffer += 4;
-		}
-
-		return ERROR_OK;
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 	}
 
 	LOG_WARNING("using fast async flash loader. This is currently supported");
@@ -687,8 +753,14 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t offset, const ui
 	retval = target_write_buffer(target, write_algorithm->address,
 				sizeof(nrf5_flash_write_code),
 				nrf5_flash_write_code);
-	if (retval != ERROR_OK)
+	if (retval == ERROR_OK && map_size)
+		retval = target_write_buffer(target,
+				write_algorithm->address + sizeof(nrf5_flash_write_code),
+				map_size, erase_map);
+	if (retval != ERROR_OK) {
+		target_free_working_area(target, write_algorithm);
 		return retval;
+	}
 
 	/* memory buffer */
 	while (target_alloc_working_area(target, buffer_size, &source) != ERROR_OK) {
@@ -708,28 +780,35 @@ static int nrf5_ll_flash_write(struct nrf5_info *chip, uint32_t offset, const ui
 
 	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* byte count */
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* buffer start */
-	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* buffer end */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* erase map */
 	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* target address */
+	init_reg_param(&reg_params[4], "r6", 32, PARAM_OUT);	/* page size - 1 */
+	init_reg_param(&reg_params[5], "r8", 32, PARAM_OUT);	/* buffer end */
 
 	buf_set_u32(reg_params[0].value, 0, 32, bytes);
 	buf_set_u32(reg_params[1].value, 0, 32, source->address);
-	buf_set_u32(reg_params[2].value, 0, 32, source->address + source->size);
+	buf_set_u32(reg_params[2].value, 0, 32,
+			map_size ? write_algorithm->address + sizeof(nrf5_flash_write_code) : 0);
 	buf_set_u32(reg_params[3].value, 0, 32, address);
+	buf_set_u32(reg_params[4].value, 0, 32, page_size - 1);
+	buf_set_u32(reg_params[5].value, 0, 32, source->address + source->size);
 
 	retval = target_run_flash_async_algorithm(target, buffer, bytes/4, 4,
 			0, NULL,
-			4, reg_params,
+			6, reg_params,
 			source->address, source->size,
 			write_algorithm->address, 0,
 			&armv7m_info);
 
+	if (retval == ERROR_FLASH_OPERATION_FAILED)
+		LOG_ERROR("nrf5 flash write failed at 0x%08"PRIx32,
+			buf_get_u32(reg_params[3].value, 0, 32));
+
 	target_free_working_area(target, source);
 	target_free_working_area(target, write_algorithm);
 
-	destroy_reg_param(&reg_params[0]);
-	destroy_reg_param(&reg_params[1]);
-	destroy_reg_param(&reg_params[2]);
-	destroy_reg_param(&reg_params[3]);
+	for (int i = 0; i < 6; i++)
+		destroy_reg_param(&reg_params[i]);
 
 	return retval;
 }
@@ -742,46 +821,65 @@ static int nrf5_write_pages(struct flash_bank *bank, uint32_t start, uint32_t en
 	int res = ERROR_FAIL;
 	struct nrf5_info *chip = bank->driver_priv;
 	struct flash_sector *sector;
-	uint32_t offset;
+	uint32_t page_cnt = (end - start) / chip->code_page_size;
+	uint8_t erase_map[page_cnt];
+	unsigned int erase_cnt = 0;
+	struct duration bench;
 
 	assert(start % chip->code_page_size == 0);
 	assert(end % chip->code_page_size == 0);
 
-	/* Erase all sectors */
-	for (offset = start; offset < end; offset += chip->code_page_size) {
-		sector = nrf5_find_sector_by_address(bank, offset);
+	/* Work out which sectors need erasing */
+	for (uint32_t i = 0; i < page_cnt; i++) {
+		sector = nrf5_find_sector_by_address(bank, start + i * chip->code_page_size);
 		if (!sector) {
-			LOG_ERROR("Invalid sector @ 0x%08"PRIx32, offset);
+			LOG_ERROR("Invalid sector @ 0x%08"PRIx32, start + i * chip->code_page_size);
 			return ERROR_FLASH_SECTOR_INVALID;
 		}
 
 		if (sector->is_protected) {
-			LOG_ERROR("Can't erase protected sector @ 0x%08"PRIx32, offset);
+			LOG_ERROR("Can't erase protected sector @ 0x%08"PRIx32, sector->offset);
 			goto error;
 		}
 
-		if (sector->is_erased != 1) {	/* 1 = erased, 0= not erased, -1 = unknown */
+		/* 1 = erased, 0= not erased, -1 = unknown */
+		erase_map[i] = sector->is_erased != 1;
+		erase_cnt += erase_map[i];
+	}
+
+	duration_start(&bench);
+
+	res = nrf5_ll_flash_write(chip, NRF5_FLASH_BASE + start, buffer, end - start,
+			erase_map, chip->code_page_size);
+	if (res == ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		for (uint32_t i = 0; i < page_cnt; i++) {
+			if (!erase_map[i])
+				continue;
+			sector = nrf5_find_sector_by_address(bank, start + i * chip->code_page_size);
 			res = nrf5_erase_page(bank, chip, sector);
 			if (res != ERROR_OK) {
 				LOG_ERROR("Failed to erase sector @ 0x%08"PRIx32, sector->offset);
 				goto error;
 			}
 		}
-		sector->is_erased = 0;
+
+		res = nrf5_slow_flash_write(chip, NRF5_FLASH_BASE + start, buffer, end - start);
 	}
 
-	res = nrf5_nvmc_write_enable(chip);
+	/* Whatever happened, the pages are no longer known to be erased */
+	for (uint32_t i = 0; i < page_cnt; i++)
+		nrf5_find_sector_by_address(bank, start + i * chip->code_page_size)->is_erased = 0;
+
 	if (res != ERROR_OK)
 		goto error;
 
-	res = nrf5_ll_flash_write(chip, start, buffer, (end - start));
-	if (res != ERROR_OK)
-		goto set_read_only;
+	if (duration_measure(&bench) == ERROR_OK)
+		LOG_INFO("nrf5: erased %u and programmed %" PRIu32 " pages in %fs (%0.3f KiB/s)",
+			erase_cnt, page_cnt, duration_elapsed(&bench),
+			duration_kbps(&bench, end - start));
 
-	return nrf5_nvmc_read_only(chip);
+	return ERROR_OK;
 
-set_read_only:
-	nrf5_nvmc_read_only(chip);
 error:
 	LOG_ERROR("Failed to write to nrf5 flash");
 	return res;
@@ -880,19 +978,15 @@ static int nrf5_uicr_flash_write(struct flash_bank *bank,
 			return res;
 	}
 
-	res = nrf5_nvmc_write_enable(chip);
-	if (res != ERROR_OK)
-		return res;
-
 	memcpy(&uicr[offset], buffer, count);
 
-	res = nrf5_ll_flash_write(chip, NRF5_UICR_BASE, uicr, NRF5_UICR_SIZE);
-	if (res != ERROR_OK) {
-		nrf5_nvmc_read_only(chip);
-		return res;
-	}
+	/* The UICR is erased through ERASEUICR above, never by the loader */
+	res = nrf5_ll_flash_write(chip, NRF5_UICR_BASE, uicr, NRF5_UICR_SIZE, NULL, NRF5_UICR_SIZE);
+	if (res == ERROR_TARGET_RESOURCE_NOT_AVAILABLE)
+		res = nrf5_slow_flash_write(chip, NRF5_UICR_BASE, uicr, NRF5_UICR_SIZE);
 
-	return nrf5_nvmc_read_only(chip);
+	sector->is_erased = 0;
+	return res;
 }
 
 
@@ -513,12 +513,203 @@ COMMAND_HANDLER(psoc4_handle_flash_autoerase_command)
 }
 
 
+/* Staged row header in front of the row data, see psoc4_rows.S */
+#define PSOC4_ROW_HDR_SIZE	16
+#define PSOC4_ROWS_PER_RUN	16
+
+static const uint8_t psoc4_write_rows_code[] = {
+	/* See contrib/loaders/flash/psoc4_rows.S */
+/* <row_loop>: */
+	0x00, 0x28,		/* cmp	r0, #0 */
+	0x28, 0xd0,		/* beq.n	56 <done> */
+	0x18, 0xb4,		/* push	{r3, r4} */
+	0x0d, 0x68,		/* ldr	r5, [r1, #0] */
+	0x0e, 0x46,		/* mov	r6, r1 */
+	0x10, 0x36,		/* adds	r6, #16 */
+	0x17, 0x46,		/* mov	r7, r2 */
+/* <compare>: */
+	0x04, 0x3f,		/* subs	r7, #4 */
+	0x15, 0xd3,		/* bcc.n	3e <unchanged> */
+	0xeb, 0x59,		/* ldr	r3, [r5, r7] */
+	0xf4, 0x59,		/* ldr	r4, [r6, r7] */
+	0xa3, 0x42,		/* cmp	r3, r4 */
+	0xf9, 0xd0,		/* beq.n	e <compare> */
+	0x18, 0xbc,		/* pop	{r3, r4} */
+	0x0f, 0x4d,		/* ldr	r5, [pc, #60] */
+	0x0e, 0x46,		/* mov	r6, r1 */
+	0x08, 0x36,		/* adds	r6, #8 */
+	0x6e, 0x60,		/* str	r6, [r5, #4] */
+	0x01, 0x26,		/* movs	r6, #1 */
+	0xf6, 0x07,		/* lsls	r6, r6, #31 */
+	0x04, 0x36,		/* adds	r6, #4 */
+	0x2e, 0x60,		/* str	r6, [r5, #0] */
+	0x00, 0xf0, 0x0d, 0xf8,	/* bl	4a <wait_srom> */
+	0x0e, 0x46,		/* mov	r6, r1 */
+	0x04, 0x36,		/* adds	r6, #4 */
+	0x6e, 0x60,		/* str	r6, [r5, #4] */
+	0x2c, 0x60,		/* str	r4, [r5, #0] */
+	0x00, 0xf0, 0x07, 0xf8,	/* bl	4a <wait_srom> */
+	0x01, 0xe0,		/* b.n	42 <next_row> */
+/* <unchanged>: */
+	0x18, 0xbc,		/* pop	{r3, r4} */
+	0x01, 0x33,		/* adds	r3, #1 */
+/* <next_row>: */
+	0x10, 0x31,		/* adds	r1, #16 */
+	0x11, 0x44,		/* add	r1, r2 */
+	0x01, 0x38,		/* subs	r0, #1 */
+	0xda, 0xe7,		/* b.n	0 <row_loop> */
+/* <wait_srom>: */
+	0x6f, 0x68,		/* ldr	r7, [r5, #4] */
+	0x3e, 0x0f,		/* lsrs	r6, r7, #28 */
+	0x0a, 0x2e,		/* cmp	r6, #10 */
+	0x02, 0xd0,		/* beq.n	58 <srom_done> */
+	0x0f, 0x2e,		/* cmp	r6, #15 */
+	0xf9, 0xd1,		/* bne.n	4a <wait_srom> */
+/* <done>: */
+	0x00, 0xbe,		/* bkpt	0x0000 */
+/* <srom_done>: */
+	0x70, 0x47,		/* bx	lr */
+	0x00, 0x00,		/* (padding) */
+	0x04, 0x00, 0x00, 0x40,	/* .word	0x40000004 (CPUSS_SYSREQ) */
+};
+
+/* Program row_cnt rows from rows[] starting at row row_num.
+ *  Rows are staged in SRAM in batches together with their SROM parameter
+ *  blocks, and a resident helper issues the Load Latch and Program/Write Row
+ *  requests itself, skipping rows which already hold the same data.
+ *  Returns ERROR_TARGET_RESOURCE_NOT_AVAILABLE if there is not enough
+ *  working area, before anything is programmed.
+ */
+static int psoc4_write_rows(struct flash_bank *bank, const uint8_t *rows,
+		uint32_t row_num, uint32_t row_cnt, uint32_t *skipped)
+{
+	struct psoc4_flash_bank *psoc4_info = bank->driver_priv;
+	struct target *target = bank->target;
+	struct working_area *rows_algorithm;
+	struct working_area *staging;
+	struct reg_param reg_params[7];
+	struct armv7m_algorithm armv7m_info;
+	uint32_t row_size = psoc4_info->row_size;
+	uint32_t stride = PSOC4_ROW_HDR_SIZE + row_size;
+	uint32_t batch = row_cnt < PSOC4_ROWS_PER_RUN ? row_cnt : PSOC4_ROWS_PER_RUN;
+	uint8_t *stage;
+	int retval;
+
+	/* same stack size as psoc4_sysreq(), plus the helper's own push */
+	const int stack_size = 196 + 8;
+
+	if (target_alloc_working_area(target, sizeof(psoc4_write_rows_code) + stack_size,
+			&rows_algorithm) != ERROR_OK) {
+		LOG_DEBUG("no working area for row programming code");
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	}
+
+	retval = target_write_buffer(target, rows_algorithm->address,
+			sizeof(psoc4_write_rows_code), psoc4_write_rows_code);
+	if (retval != ERROR_OK)
+		goto cleanup_algo;
+
+	while (target_alloc_working_area_try(target, batch * stride, &staging) != ERROR_OK) {
+		batch /= 2;
+		if (batch == 0) {
+			LOG_DEBUG("no working area for staging rows");
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto cleanup_algo;
+		}
+	}
+
+	stage = malloc(batch * stride);
+	if (stage == NULL) {
+		LOG_ERROR("no memory for staging rows");
+		retval = ERROR_FAIL;
+		goto cleanup_staging;
+	}
+
+	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
+	armv7m_info.core_mode = ARM_MODE_THREAD;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);	/* rows (in), rows left (out) */
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);	/* staged rows */
+	init_reg_param(&reg_params[2], "r2", 32, PARAM_OUT);	/* row size */
+	init_reg_param(&reg_params[3], "r3", 32, PARAM_IN_OUT);	/* rows skipped */
+	init_reg_param(&reg_params[4], "r4", 32, PARAM_OUT);	/* Program/Write Row sysreq */
+	init_reg_param(&reg_params[5], "r7", 32, PARAM_IN);	/* SROM status */
+	init_reg_param(&reg_params[6], "sp", 32, PARAM_OUT);
+
+	while (row_cnt) {
+		uint32_t n = row_cnt < batch ? row_cnt : batch;
+
+		for (uint32_t i = 0; i < n; i++) {
+			uint8_t *p = stage + i * stride;
+			uint32_t row = row_num + i;
+
+			target_buffer_set_u32(target, p, bank->base + row * row_size);
+			target_buffer_set_u32(target, p + 4, PSOC4_SROM_KEY1
+					| ((PSOC4_SROM_KEY2 + psoc4_info->cmd_program_row) << 8)
+					| ((row & 0xffff) << 16));
+			target_buffer_set_u32(target, p + 8, PSOC4_SROM_KEY1
+					| ((PSOC4_SROM_KEY2 + PSOC4_CMD_LOAD_LATCH) << 8));
+			target_buffer_set_u32(target, p + 12, row_size - 1);
+			memcpy(p + PSOC4_ROW_HDR_SIZE, rows, row_size);
+			rows += row_size;
+		}
+
+		retval = target_write_buffer(target, staging->address, n * stride, stage);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, n);
+		buf_set_u32(reg_params[1].value, 0, 32, staging->address);
+		buf_set_u32(reg_params[2].value, 0, 32, row_size);
+		buf_set_u32(reg_params[3].value, 0, 32, 0);
+		buf_set_u32(reg_params[4].value, 0, 32,
+				PSOC4_SROM_SYSREQ_BIT | psoc4_info->cmd_program_row);
+		buf_set_u32(reg_params[6].value, 0, 32,
+				rows_algorithm->address + rows_algorithm->size);
+
+		retval = target_run_algorithm(target, 0, NULL,
+				sizeof(reg_params) / sizeof(*reg_params), reg_params,
+				rows_algorithm->address, 0, 1000 * n, &armv7m_info);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("row programming code execution failed");
+			break;
+		}
+
+		uint32_t left = buf_get_u32(reg_params[0].value, 0, 32);
+		if (left) {
+			LOG_ERROR("programming row %" PRIu32 " failed, SROM status 0x%08" PRIx32,
+					row_num + n - left, buf_get_u32(reg_params[5].value, 0, 32));
+			retval = ERROR_FLASH_OPERATION_FAILED;
+			break;
+		}
+
+		*skipped += buf_get_u32(reg_params[3].value, 0, 32);
+		row_num += n;
+		row_cnt -= n;
+	}
+
+	for (unsigned int i = 0; i < sizeof(reg_params) / sizeof(*reg_params); i++)
+		destroy_reg_param(&reg_params[i]);
+
+	free(stage);
+
+cleanup_staging:
+	target_free_working_area(target, staging);
+
+cleanup_algo:
+	target_free_working_area(target, rows_algorithm);
+
+	return retval;
+}
+
+
 static int psoc4_write(struct flash_bank *bank, const uint8_t *buffer,
 		uint32_t offset, uint32_t count)
 {
 	struct psoc4_flash_bank *psoc4_info = bank->driver_priv;
 	struct target *target = bank->target;
 	uint32_t *sysrq_buffer = NULL;
+	uint8_t *rows = NULL;
 	int retval = ERROR_OK;
 	const int param_sz = 8;
 
@@ -532,30 +723,38 @@ static int psoc4_write(struct flash_bank *bank, const uint8_t *buffer,
 		return ERROR_FLASH_DST_BREAKS_ALIGNMENT;
 	}
 
+	/* Whole rows are programmed, the gaps are filled with zeros */
+	uint32_t row_num = offset / psoc4_info->row_size;
+	uint32_t row_offset = offset - row_num * psoc4_info->row_size;
+	uint32_t row_cnt = DIV_ROUND_UP(row_offset + count, psoc4_info->row_size);
+	uint32_t skipped = 0;
+
+	rows = calloc(row_cnt, psoc4_info->row_size);
 	sysrq_buffer = malloc(param_sz + psoc4_info->row_size);
-	if (sysrq_buffer == NULL) {
+	if (rows == NULL || sysrq_buffer == NULL) {
 		LOG_ERROR("no memory for row buffer");
+		free(rows);
+		free(sysrq_buffer);
 		return ERROR_FAIL;
 	}
-
-	uint8_t *row_buffer = (uint8_t *)sysrq_buffer + param_sz;
-	uint32_t row_num = offset / psoc4_info->row_size;
-	uint32_t row_offset = offset - row_num * psoc4_info->row_size;
-	if (row_offset)
-		memset(row_buffer, 0, row_offset);
+	memcpy(rows + row_offset, buffer, count);
 
 	bool save_poll = jtag_poll_get_enabled();
 	jtag_poll_set_enabled(false);
 
-	while (count) {
-		uint32_t chunk_size = psoc4_info->row_size - row_offset;
-		if (chunk_size > count) {
-			chunk_size = count;
-			memset(row_buffer + chunk_size, 0, psoc4_info->row_size - chunk_size);
-		}
-		memcpy(row_buffer + row_offset, buffer, chunk_size);
-		LOG_DEBUG("offset / row: 0x%08" PRIx32 " / %" PRIu32 ", size %" PRIu32 "",
-				offset, row_offset, chunk_size);
+	retval = psoc4_write_rows(bank, rows, row_num, row_cnt, &skipped);
+	if (retval != ERROR_TARGET_RESOURCE_NOT_AVAILABLE) {
+		if (retval == ERROR_OK && skipped)
+			LOG_INFO("%" PRIu32 " of %" PRIu32 " rows already up to date, skipped",
+					skipped, row_cnt);
+		goto cleanup;
+	}
+
+	/* not enough working area for staging, one sysreq at a time */
+	uint8_t *row_buffer = (uint8_t *)sysrq_buffer + param_sz;
+	for (uint32_t i = 0; i < row_cnt; i++, row_num++) {
+		memcpy(row_buffer, rows + i * psoc4_info->row_size, psoc4_info->row_size);
+		LOG_DEBUG("row %" PRIu32 "", row_num);
 
 		/* Call "Load Latch" system ROM API */
 		sysrq_buffer[1] = psoc4_info->row_size - 1;
@@ -572,18 +771,13 @@ static int psoc4_write(struct flash_bank *bank, const uint8_t *buffer,
 				&sysrq_param, sizeof(sysrq_param));
 		if (retval != ERROR_OK)
 			goto cleanup;
-
-		buffer += chunk_size;
-		row_num++;
-		row_offset = 0;
-		count -= chunk_size;
 	}
 
 cleanup:
 	jtag_poll_set_enabled(save_poll);
 
-	if (sysrq_buffer)
-		free(sysrq_buffer);
+	free(rows);
+	free(sysrq_buffer);
 
 	return retval;
 }
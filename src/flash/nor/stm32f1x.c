@@ -105,6 +105,10 @@
 #define FLASH_WRITE_TIMEOUT 10
 #define FLASH_ERASE_TIMEOUT 100
 
+/* Datasheet minimum page and mass erase time (tERASE, tME); a half-word
+ * program (tPROG, ~50 us) is done before the first poll */
+#define FLASH_ERASE_TIME 20
+
 struct stm32x_options {
 	uint16_t RDP;
 	uint16_t user_options;
@@ -163,13 +167,20 @@ static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *sta
 	return target_read_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_SR), status);
 }
 
-static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
+static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout, int typical)
 {
 	struct target *target = bank->target;
 	uint32_t status;
 	int retval = ERROR_OK;
-
-	/* wait for busy to clear */
+	int interval = 1;
+	int waited = typical;
+
+	/* BSY is set for at least the typical time, then poll every ms and
+	 * back off to 8 ms past twice that */
+	if (typical > 0) {
+		alive_sleep(typical);
+		timeout -= typical;
+	}
 	for (;;) {
 		retval = stm32x_get_flash_status(bank, &status);
 		if (retval != ERROR_OK)
@@ -177,11 +188,15 @@ static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
 		LOG_DEBUG("status: 0x%" PRIx32 "", status);
 		if ((status & FLASH_BSY) == 0)
 			break;
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("timed out waiting for flash");
 			return ERROR_FAIL;
 		}
-		alive_sleep(1);
+		alive_sleep(interval);
+		timeout -= interval;
+		waited += interval;
+		if (waited > 2 * typical)
+			interval = MIN(interval * 2, 8);
 	}
 
 	if (status & FLASH_WRPRTERR) {
@@ -287,7 +302,7 @@ static int stm32x_erase_options(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT);
+	retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT, FLASH_ERASE_TIME);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -438,10 +453,12 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 	if (retval != ERROR_OK)
 		return retval;
 
+	/* PER stays set across pages, only STRT is cleared by the hardware */
+	retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER);
+	if (retval != ERROR_OK)
+		return retval;
+
 	for (i = first; i <= last; i++) {
-		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_CR), FLASH_PER);
-		if (retval != ERROR_OK)
-			return retval;
 		retval = target_write_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_AR),
 				bank->base + bank->sectors[i].offset);
 		if (retval != ERROR_OK)
@@ -451,7 +468,7 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT);
+		retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT, FLASH_ERASE_TIME);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -752,7 +769,7 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 			if (retval != ERROR_OK)
 				goto reset_pg_and_lock;
 
-			retval = stm32x_wait_status_busy(bank, 5);
+			retval = stm32x_wait_status_busy(bank, 5, 0);
 			if (retval != ERROR_OK)
 				goto reset_pg_and_lock;
 
@@ -1546,7 +1563,7 @@ static int stm32x_mass_erase(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT);
+	retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT, FLASH_ERASE_TIME);
 	if (retval != ERROR_OK)
 		return retval;
 
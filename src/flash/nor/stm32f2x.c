@@ -123,6 +123,17 @@
 /* Mass erase time can be as high as 32 s in x8 mode. */
 #define FLASH_MASS_ERASE_TIMEOUT 33000
 
+/* Typical erase time at x32 parallelism, in ms.  The F4 datasheets give
+ * 250 ms for 16 KiB, 550 ms for 64 KiB and 1 s for 128 KiB sectors; this
+ * stays a little below that line, x8/x16 erase is slower.  Word or
+ * half-word programming (~16 us) is done before the first poll. */
+static int stm32x_erase_time(uint32_t size)
+{
+	uint32_t kib = size / 1024;
+
+	return kib > 16 ? 250 + (kib - 16) * 6 : 250;
+}
+
 #define STM32_FLASH_BASE    0x40023c00
 #define STM32_FLASH_ACR     0x40023c00
 #define STM32_FLASH_KEYR    0x40023c04
@@ -224,13 +235,20 @@ static inline int stm32x_get_flash_status(struct flash_bank *bank, uint32_t *sta
 	return target_read_u32(target, stm32x_get_flash_reg(bank, STM32_FLASH_SR), status);
 }
 
-static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
+static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout, int typical)
 {
 	struct target *target = bank->target;
 	uint32_t status;
 	int retval = ERROR_OK;
-
-	/* wait for busy to clear */
+	int interval = 1;
+	int waited = typical;
+
+	/* sleep through the typical time, poll each ms up to twice that,
+	 * then back off to 8 ms */
+	if (typical > 0) {
+		alive_sleep(typical);
+		timeout -= typical;
+	}
 	for (;;) {
 		retval = stm32x_get_flash_status(bank, &status);
 		if (retval != ERROR_OK)
@@ -238,11 +256,15 @@ static int stm32x_wait_status_busy(struct flash_bank *bank, int timeout)
 		LOG_DEBUG("status: 0x%" PRIx32 "", status);
 		if ((status & FLASH_BSY) == 0)
 			break;
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("timed out waiting for flash");
 			return ERROR_FAIL;
 		}
-		alive_sleep(1);
+		alive_sleep(interval);
+		timeout -= interval;
+		waited += interval;
+		if (waited > 2 * typical)
+			interval = MIN(interval * 2, 8);
 	}
 
 
@@ -447,7 +469,7 @@ static int stm32x_write_options(struct flash_bank *bank)
 		return retval;
 
 	/* wait for completion, this might trigger a security erase and take a while */
-	retval = stm32x_wait_status_busy(bank, FLASH_MASS_ERASE_TIMEOUT);
+	retval = stm32x_wait_status_busy(bank, FLASH_MASS_ERASE_TIMEOUT, 0);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -521,7 +543,8 @@ static int stm32x_erase(struct flash_bank *bank, int first, int last)
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT);
+		retval = stm32x_wait_status_busy(bank, FLASH_ERASE_TIMEOUT,
+				stm32x_erase_time(bank->sectors[i].size));
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -767,7 +790,7 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = stm32x_wait_status_busy(bank, FLASH_WRITE_TIMEOUT);
+		retval = stm32x_wait_status_busy(bank, FLASH_WRITE_TIMEOUT, 0);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -785,7 +808,7 @@ static int stm32x_write(struct flash_bank *bank, const uint8_t *buffer,
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = stm32x_wait_status_busy(bank, FLASH_WRITE_TIMEOUT);
+		retval = stm32x_wait_status_busy(bank, FLASH_WRITE_TIMEOUT, 0);
 		if (retval != ERROR_OK)
 			return retval;
 	}
@@ -1368,7 +1391,9 @@ static int stm32x_mass_erase(struct flash_bank *bank)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = stm32x_wait_status_busy(bank, FLASH_MASS_ERASE_TIMEOUT);
+	/* with MER1 both halves are erased at the same time */
+	retval = stm32x_wait_status_busy(bank, FLASH_MASS_ERASE_TIMEOUT,
+			stm32x_erase_time(stm32x_info->has_large_mem ? bank->size / 2 : bank->size));
 	if (retval != ERROR_OK)
 		return retval;
 
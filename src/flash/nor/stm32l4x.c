@@ -49,6 +49,10 @@
 
 #define FLASH_ERASE_TIMEOUT 250
 
+/* Datasheet typical 2 KiB page erase (22.02 ms) and mass erase (22.13 ms)
+ * time */
+#define FLASH_ERASE_TIME 22
+
 #define STM32_FLASH_BASE    0x40022000
 #define STM32_FLASH_ACR     0x40022000
 #define STM32_FLASH_KEYR    0x40022008
@@ -158,13 +162,20 @@ static inline int stm32l4_get_flash_status(struct flash_bank *bank, uint32_t *st
 		target, stm32l4_get_flash_reg(bank, STM32_FLASH_SR), status);
 }
 
-static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
+static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout, int typical)
 {
 	struct target *target = bank->target;
 	uint32_t status;
 	int retval = ERROR_OK;
+	int interval = 1;
+	int waited = typical;
 
-	/* wait for busy to clear */
+	/* first poll after the typical time, 1 ms steps until twice that,
+	 * doubling to 8 ms afterwards */
+	if (typical > 0) {
+		alive_sleep(typical);
+		timeout -= typical;
+	}
 	for (;;) {
 		retval = stm32l4_get_flash_status(bank, &status);
 		if (retval != ERROR_OK)
@@ -172,11 +183,15 @@ static int stm32l4_wait_status_busy(struct flash_bank *bank, int timeout)
 		LOG_DEBUG("status: 0x%" PRIx32 "", status);
 		if ((status & FLASH_BSY) == 0)
 			break;
-		if (timeout-- <= 0) {
+		if (timeout <= 0) {
 			LOG_ERROR("timed out waiting for flash");
 			return ERROR_FAIL;
 		}
-		alive_sleep(1);
+		alive_sleep(interval);
+		timeout -= interval;
+		waited += interval;
+		if (waited > 2 * typical)
+			interval = MIN(interval * 2, 8);
 	}
 
 
@@ -407,7 +422,7 @@ static int stm32l4_erase(struct flash_bank *bank, int first, int last)
 		if (retval != ERROR_OK)
 			return retval;
 
-		retval = stm32l4_wait_status_busy(bank, FLASH_ERASE_TIMEOUT);
+		retval = stm32l4_wait_status_busy(bank, FLASH_ERASE_TIMEOUT, FLASH_ERASE_TIME);
 		if (retval != ERROR_OK)
 			return retval;
 
@@ -859,7 +874,7 @@ static int stm32l4_mass_erase(struct flash_bank *bank, uint32_t action)
 	if (retval != ERROR_OK)
 		return retval;
 
-	retval = stm32l4_wait_status_busy(bank,  FLASH_ERASE_TIMEOUT);
+	retval = stm32l4_wait_status_busy(bank, FLASH_ERASE_TIMEOUT, FLASH_ERASE_TIME);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -29,6 +29,7 @@
 #include "log.h"
 #include "command.h"
 #include "time_support.h"
+#include "perf.h"
 
 #include <stdarg.h>
 
@@ -464,6 +465,7 @@ void kept_alive()
 /* if we sleep for extended periods of time, we must invoke keep_alive() intermittantly */
 void alive_sleep(uint64_t ms)
 {
+	int64_t sleep_start = perf_now();
 	uint64_t napTime = 10;
 	for (uint64_t i = 0; i < ms; i += napTime) {
 		uint64_t sleep_a_bit = ms - i;
@@ -473,6 +475,7 @@ void alive_sleep(uint64_t ms)
 		usleep(sleep_a_bit * 1000);
 		keep_alive();
 	}
+	perf_record(PERF_HIST_ALIVE_SLEEP, sleep_start);
 }
 
 void busy_sleep(uint64_t ms)
@@ -0,0 +1,444 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "perf.h"
+#include "log.h"
+#include "command.h"
+#include "time_support.h"
+
+struct perf_hist {
+	uint64_t count;
+	uint64_t total_us;
+	uint64_t max_us;
+	uint64_t buckets[PERF_HIST_BUCKETS];
+};
+
+struct perf_span {
+	int64_t start;
+	uint32_t dur;
+	uint8_t id;
+};
+
+uint64_t perf_counters[PERF_COUNTER_NUM];
+static struct perf_hist perf_hists[PERF_HIST_NUM];
+
+/* span ring buffer, allocated by 'perf trace start' */
+#define PERF_TRACE_DEFAULT_DEPTH 65536
+static struct perf_span *perf_trace_ring;
+static unsigned perf_trace_depth;
+static uint64_t perf_trace_count;
+static bool perf_tracing;
+
+/* period of the summary log line in ms, 0 disables it */
+static unsigned perf_log_interval;
+static int64_t perf_log_last;
+
+static const char * const perf_counter_names[PERF_COUNTER_NUM] = {
+	[PERF_JTAG_FLUSH] = "jtag_flush",
+	[PERF_JTAG_SCAN_BITS] = "jtag_scan_bits",
+	[PERF_DAP_RUN] = "dap_run",
+	[PERF_SWD_RUN] = "swd_run",
+	[PERF_SWD_ACK_OK] = "swd_ack_ok",
+	[PERF_SWD_ACK_WAIT] = "swd_ack_wait",
+	[PERF_SWD_ACK_FAULT] = "swd_ack_fault",
+	[PERF_SWD_ACK_JUNK] = "swd_ack_junk",
+	[PERF_SWD_WAIT_RETRY] = "swd_wait_retry",
+	[PERF_USB_TRANSFERS] = "usb_transfers",
+	[PERF_USB_BYTES] = "usb_bytes",
+	[PERF_TARGET_READ_BYTES] = "target_read_bytes",
+	[PERF_TARGET_WRITE_BYTES] = "target_write_bytes",
+};
+
+static const char * const perf_hist_names[PERF_HIST_NUM] = {
+	[PERF_HIST_JTAG_FLUSH] = "jtag_flush",
+	[PERF_HIST_DAP_RUN] = "dap_run",
+	[PERF_HIST_SWD_RUN] = "swd_run",
+	[PERF_HIST_GDB_INPUT] = "gdb_input",
+	[PERF_HIST_GDB_QUERY] = "gdb_query",
+	[PERF_HIST_GDB_REG_READ] = "gdb_reg_read",
+	[PERF_HIST_GDB_REG_WRITE] = "gdb_reg_write",
+	[PERF_HIST_GDB_MEM_READ] = "gdb_mem_read",
+	[PERF_HIST_GDB_MEM_WRITE] = "gdb_mem_write",
+	[PERF_HIST_GDB_BREAKPOINT] = "gdb_breakpoint",
+	[PERF_HIST_GDB_RUN_CONTROL] = "gdb_run_control",
+	[PERF_HIST_GDB_V] = "gdb_v",
+	[PERF_HIST_GDB_OTHER] = "gdb_other",
+	[PERF_HIST_TIMER_CALLBACK] = "timer_callback",
+	[PERF_HIST_RUN_ALGORITHM] = "run_algorithm",
+	[PERF_HIST_FLASH_ERASE] = "flash_erase",
+	[PERF_HIST_FLASH_WRITE] = "flash_write",
+	[PERF_HIST_ALIVE_SLEEP] = "alive_sleep",
+};
+
+/* trace viewer thread lane of each span, so that layers stack visually */
+enum perf_lane {
+	PERF_LANE_GDB = 1,
+	PERF_LANE_TARGET,
+	PERF_LANE_ADAPTER,
+	PERF_LANE_TIMER,
+};
+
+static const char * const perf_lane_names[] = {
+	[PERF_LANE_GDB] = "gdb",
+	[PERF_LANE_TARGET] = "target",
+	[PERF_LANE_ADAPTER] = "adapter",
+	[PERF_LANE_TIMER] = "timer",
+};
+
+static enum perf_lane perf_hist_lane(enum perf_histogram id)
+{
+	switch (id) {
+		case PERF_HIST_JTAG_FLUSH:
+		case PERF_HIST_DAP_RUN:
+		case PERF_HIST_SWD_RUN:
+			return PERF_LANE_ADAPTER;
+		case PERF_HIST_RUN_ALGORITHM:
+		case PERF_HIST_FLASH_ERASE:
+		case PERF_HIST_FLASH_WRITE:
+		case PERF_HIST_ALIVE_SLEEP:
+			return PERF_LANE_TARGET;
+		case PERF_HIST_TIMER_CALLBACK:
+			return PERF_LANE_TIMER;
+		default:
+			return PERF_LANE_GDB;
+	}
+}
+
+int64_t perf_now(void)
+{
+#ifdef CLOCK_MONOTONIC
+	/* immune to NTP and wall clock steps */
+	struct timespec now;
+	if (clock_gettime(CLOCK_MONOTONIC, &now) == 0)
+		return (int64_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#endif
+	return timeval_ms() * 1000;
+}
+
+void perf_record(enum perf_histogram id, int64_t start)
+{
+	struct perf_hist *h = &perf_hists[id];
+	int64_t delta = perf_now() - start;
+	uint64_t us = delta > 0 ? delta : 0;
+
+	if (perf_tracing) {
+		struct perf_span *span = &perf_trace_ring[perf_trace_count++ % perf_trace_depth];
+		span->start = start;
+		span->dur = us > UINT32_MAX ? UINT32_MAX : us;
+		span->id = id;
+	}
+
+	/* bucket i holds durations in [2^(i-1), 2^i) us */
+	unsigned bucket = 0;
+	while (bucket < PERF_HIST_BUCKETS - 1 && (us >> bucket))
+		bucket++;
+
+	h->count++;
+	h->total_us += us;
+	if (us > h->max_us)
+		h->max_us = us;
+	h->buckets[bucket]++;
+}
+
+void perf_reset(void)
+{
+	memset(perf_counters, 0, sizeof(perf_counters));
+	memset(perf_hists, 0, sizeof(perf_hists));
+}
+
+void perf_quit(void)
+{
+	perf_tracing = false;
+	free(perf_trace_ring);
+	perf_trace_ring = NULL;
+	perf_trace_depth = 0;
+	perf_trace_count = 0;
+}
+
+void perf_poll(void)
+{
+	if (!perf_log_interval)
+		return;
+
+	int64_t now = timeval_ms();
+	if (now - perf_log_last < perf_log_interval)
+		return;
+	perf_log_last = now;
+
+	char line[512];
+	int len = 0;
+	for (unsigned i = 0; i < PERF_COUNTER_NUM; i++) {
+		if (!perf_counters[i])
+			continue;
+		int n = snprintf(line + len, sizeof(line) - len, " %s=%" PRIu64,
+				perf_counter_names[i], perf_counters[i]);
+		if (n < 0 || (size_t)n >= sizeof(line) - len)
+			break;
+		len += n;
+	}
+
+	LOG_INFO("perf:%s", len ? line : " idle");
+}
+
+COMMAND_HANDLER(handle_perf_dump_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	for (unsigned i = 0; i < PERF_COUNTER_NUM; i++)
+		command_print(CMD_CTX, "%-20s %" PRIu64, perf_counter_names[i], perf_counters[i]);
+
+	command_print(CMD_CTX, "%-20s %10s %12s %10s %10s", "histogram", "count",
+			"total_us", "avg_us", "max_us");
+	for (unsigned i = 0; i < PERF_HIST_NUM; i++) {
+		const struct perf_hist *h = &perf_hists[i];
+		if (!h->count)
+			continue;
+		command_print(CMD_CTX, "%-20s %10" PRIu64 " %12" PRIu64 " %10" PRIu64 " %10" PRIu64,
+				perf_hist_names[i], h->count, h->total_us,
+				h->total_us / h->count, h->max_us);
+	}
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_reset_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	perf_reset();
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_json_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	command_print_sameline(CMD_CTX, "{\"counters\":{");
+	for (unsigned i = 0; i < PERF_COUNTER_NUM; i++)
+		command_print_sameline(CMD_CTX, "%s\"%s\":%" PRIu64, i ? "," : "",
+				perf_counter_names[i], perf_counters[i]);
+
+	command_print_sameline(CMD_CTX, "},\"histograms\":{");
+	for (unsigned i = 0; i < PERF_HIST_NUM; i++) {
+		const struct perf_hist *h = &perf_hists[i];
+		command_print_sameline(CMD_CTX,
+				"%s\"%s\":{\"count\":%" PRIu64 ",\"total_us\":%" PRIu64
+				",\"max_us\":%" PRIu64 ",\"buckets\":[",
+				i ? "," : "", perf_hist_names[i], h->count, h->total_us, h->max_us);
+		for (unsigned b = 0; b < PERF_HIST_BUCKETS; b++)
+			command_print_sameline(CMD_CTX, "%s%" PRIu64, b ? "," : "", h->buckets[b]);
+		command_print_sameline(CMD_CTX, "]}");
+	}
+	command_print(CMD_CTX, "}}");
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_log_interval_command)
+{
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], perf_log_interval);
+		perf_log_last = timeval_ms();
+	}
+
+	command_print(CMD_CTX, "perf log interval: %u ms", perf_log_interval);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_trace_start_command)
+{
+	unsigned depth = PERF_TRACE_DEFAULT_DEPTH;
+
+	if (CMD_ARGC > 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	if (CMD_ARGC == 1) {
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], depth);
+		if (depth == 0)
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	perf_tracing = false;
+	if (depth != perf_trace_depth) {
+		struct perf_span *ring = realloc(perf_trace_ring, depth * sizeof(*ring));
+		if (!ring) {
+			LOG_ERROR("Out of memory");
+			return ERROR_FAIL;
+		}
+		perf_trace_ring = ring;
+		perf_trace_depth = depth;
+	}
+	perf_trace_count = 0;
+	perf_tracing = true;
+
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_trace_stop_command)
+{
+	if (CMD_ARGC != 0)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	perf_tracing = false;
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(handle_perf_trace_dump_command)
+{
+	if (CMD_ARGC != 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (!perf_trace_ring) {
+		command_print(CMD_CTX, "trace capture was never started");
+		return ERROR_FAIL;
+	}
+
+	FILE *f = fopen(CMD_ARGV[0], "w");
+	if (!f) {
+		LOG_ERROR("failed to open trace output '%s'", CMD_ARGV[0]);
+		return ERROR_FAIL;
+	}
+
+	/* oldest span still held in the ring */
+	uint64_t first = 0;
+	if (perf_trace_count > perf_trace_depth)
+		first = perf_trace_count - perf_trace_depth;
+
+	fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	for (unsigned lane = PERF_LANE_GDB; lane <= PERF_LANE_TIMER; lane++)
+		fprintf(f, "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,"
+				"\"args\":{\"name\":\"%s\"}},\n", lane, perf_lane_names[lane]);
+
+	/* spans are stored as they end, so an enclosing span comes after the
+	 * ones nested in it: time is relative to the earliest start */
+	int64_t origin = INT64_MAX;
+	for (uint64_t i = first; i < perf_trace_count; i++) {
+		const struct perf_span *span = &perf_trace_ring[i % perf_trace_depth];
+		if (span->start < origin)
+			origin = span->start;
+	}
+
+	for (uint64_t i = first; i < perf_trace_count; i++) {
+		const struct perf_span *span = &perf_trace_ring[i % perf_trace_depth];
+		fprintf(f, "{\"ph\":\"X\",\"name\":\"%s\",\"pid\":1,\"tid\":%u,"
+				"\"ts\":%" PRId64 ",\"dur\":%" PRIu32 "},\n",
+				perf_hist_names[span->id], perf_hist_lane(span->id),
+				span->start - origin, span->dur);
+	}
+	/* the trace-event format tolerates neither trailing commas nor an empty
+	 * tail, so close the array with a harmless metadata record */
+	fprintf(f, "{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":1,"
+			"\"args\":{\"name\":\"openocd\"}}\n]}\n");
+
+	int retval = ERROR_OK;
+	if (fclose(f) != 0) {
+		LOG_ERROR("failed to write trace output '%s'", CMD_ARGV[0]);
+		retval = ERROR_FAIL;
+	}
+
+	command_print(CMD_CTX, "wrote %" PRIu64 " of %" PRIu64 " spans to %s",
+			perf_trace_count - first, perf_trace_count, CMD_ARGV[0]);
+	return retval;
+}
+
+static const struct command_registration perf_trace_subcommand_handlers[] = {
+	{
+		.name = "start",
+		.handler = handle_perf_trace_start_command,
+		.mode = COMMAND_ANY,
+		.help = "start capturing spans into a ring buffer of 'depth' entries, "
+			"discarding any previous capture",
+		.usage = "[depth]",
+	},
+	{
+		.name = "stop",
+		.handler = handle_perf_trace_stop_command,
+		.mode = COMMAND_ANY,
+		.help = "stop capturing spans, keeping the ring buffer contents",
+		.usage = "",
+	},
+	{
+		.name = "dump",
+		.handler = handle_perf_trace_dump_command,
+		.mode = COMMAND_ANY,
+		.help = "write the captured spans as a Chrome trace-event JSON file",
+		.usage = "filename",
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration perf_subcommand_handlers[] = {
+	{
+		.name = "dump",
+		.handler = handle_perf_dump_command,
+		.mode = COMMAND_ANY,
+		.help = "display all counters and latency histograms",
+		.usage = "",
+	},
+	{
+		.name = "reset",
+		.handler = handle_perf_reset_command,
+		.mode = COMMAND_ANY,
+		.help = "clear all counters and latency histograms",
+		.usage = "",
+	},
+	{
+		.name = "json",
+		.handler = handle_perf_json_command,
+		.mode = COMMAND_ANY,
+		.help = "display counters and histograms as a JSON object",
+		.usage = "",
+	},
+	{
+		.name = "log_interval",
+		.handler = handle_perf_log_interval_command,
+		.mode = COMMAND_ANY,
+		.help = "log a counter summary every 'ms' milliseconds, 0 disables",
+		.usage = "[ms]",
+	},
+	{
+		.name = "trace",
+		.mode = COMMAND_ANY,
+		.help = "ring-buffered timeline capture",
+		.usage = "",
+		.chain = perf_trace_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+static const struct command_registration perf_command_handlers[] = {
+	{
+		.name = "perf",
+		.mode = COMMAND_ANY,
+		.help = "hot-path performance counters",
+		.usage = "",
+		.chain = perf_subcommand_handlers,
+	},
+	COMMAND_REGISTRATION_DONE
+};
+
+int perf_register_commands(struct command_context *cmd_ctx)
+{
+	return register_commands(cmd_ctx, NULL, perf_command_handlers);
+}
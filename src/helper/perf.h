@@ -0,0 +1,106 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_HELPER_PERF_H
+#define OPENOCD_HELPER_PERF_H
+
+/**
+ * @file
+ * Lightweight hot-path counters and latency histograms.
+ *
+ * Counters are plain 64-bit accumulators indexed by a fixed id, so
+ * recording one is a single add.  Histograms collect durations in
+ * microseconds into power-of-two buckets.  Everything is exposed through
+ * the @c perf command.
+ *
+ * While tracing is enabled every recorded duration is also kept as a
+ * span in a ring buffer, which can be written out as a Chrome trace-event
+ * JSON file (loadable in chrome://tracing or Perfetto) after the fact.
+ */
+
+struct command_context;
+
+enum perf_counter {
+	PERF_JTAG_FLUSH,
+	PERF_JTAG_SCAN_BITS,
+	PERF_DAP_RUN,
+	PERF_SWD_RUN,
+	PERF_SWD_ACK_OK,
+	PERF_SWD_ACK_WAIT,
+	PERF_SWD_ACK_FAULT,
+	PERF_SWD_ACK_JUNK,
+	PERF_SWD_WAIT_RETRY,
+	PERF_USB_TRANSFERS,
+	PERF_USB_BYTES,
+	PERF_TARGET_READ_BYTES,
+	PERF_TARGET_WRITE_BYTES,
+	PERF_COUNTER_NUM
+};
+
+enum perf_histogram {
+	PERF_HIST_JTAG_FLUSH,
+	PERF_HIST_DAP_RUN,
+	PERF_HIST_SWD_RUN,
+	PERF_HIST_GDB_INPUT,
+	PERF_HIST_GDB_QUERY,
+	PERF_HIST_GDB_REG_READ,
+	PERF_HIST_GDB_REG_WRITE,
+	PERF_HIST_GDB_MEM_READ,
+	PERF_HIST_GDB_MEM_WRITE,
+	PERF_HIST_GDB_BREAKPOINT,
+	PERF_HIST_GDB_RUN_CONTROL,
+	PERF_HIST_GDB_V,
+	PERF_HIST_GDB_OTHER,
+	PERF_HIST_TIMER_CALLBACK,
+	PERF_HIST_RUN_ALGORITHM,
+	PERF_HIST_FLASH_ERASE,
+	PERF_HIST_FLASH_WRITE,
+	PERF_HIST_ALIVE_SLEEP,
+	PERF_HIST_NUM
+};
+
+/** Number of power-of-two microsecond buckets, the last one is open ended. */
+#define PERF_HIST_BUCKETS 24
+
+extern uint64_t perf_counters[PERF_COUNTER_NUM];
+
+/** Add @a n to counter @a id. */
+static inline void perf_count(enum perf_counter id, uint64_t n)
+{
+	perf_counters[id] += n;
+}
+
+/** @returns a timestamp in microseconds, monotonic where CLOCK_MONOTONIC
+ * is available, otherwise wall-clock, ms resolution. */
+int64_t perf_now(void);
+
+/**
+ * Record the duration since @a start (from perf_now()) in histogram @a id,
+ * and as a trace span if tracing is enabled.
+ */
+void perf_record(enum perf_histogram id, int64_t start);
+
+/** Clear all counters and histograms. */
+void perf_reset(void);
+
+/** Release the trace ring buffer. */
+void perf_quit(void);
+
+/** Emit the periodic summary log line, if enabled and due. */
+void perf_poll(void);
+
+int perf_register_commands(struct command_context *cmd_ctx);
+
+#endif /* OPENOCD_HELPER_PERF_H */
@@ -35,6 +35,7 @@
 #include "interface.h"
 #include <transport/transport.h>
 #include <helper/jep106.h>
+#include <helper/perf.h>
 
 #ifdef HAVE_STRINGS_H
 #include <strings.h>
@@ -842,7 +843,11 @@ int default_interface_jtag_execute_queue(void)
 void jtag_execute_queue_noclear(void)
 {
 	jtag_flush_queue_count++;
+
+	perf_count(PERF_JTAG_FLUSH, 1);
+	int64_t start = perf_now();
 	jtag_set_error(interface_jtag_execute_queue());
+	perf_record(PERF_HIST_JTAG_FLUSH, start);
 
 	if (jtag_flush_queue_sleep > 0) {
 		/* For debug purposes it can be useful to test performance
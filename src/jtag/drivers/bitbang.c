@@ -36,6 +36,7 @@
 #include "bitbang.h"
 #include <jtag/interface.h>
 #include <jtag/commands.h>
+#include <helper/perf.h>
 
 /* YUK! - but this is currently a global.... */
 extern struct jtag_interface *jtag_interface;
@@ -52,8 +53,23 @@ static void bitbang_stableclocks(int num_cycles);
 
 static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk);
 
+static void bitbang_bridge_tms_seq(struct bitbang_bridge *b, const uint8_t *bits,
+		unsigned int num_bits);
+static void bitbang_bridge_clocks(struct bitbang_bridge *b, unsigned int num_cycles, int tms);
+static void bitbang_bridge_scan(struct bitbang_bridge *b, enum scan_type type,
+		uint8_t *buffer, int scan_size);
+static int bitbang_bridge_jtag_run(struct bitbang_bridge *b);
+
 struct bitbang_interface *bitbang_interface;
 
+/* the bridge of the active interface if it carries the JTAG shifts, else NULL */
+static struct bitbang_bridge *bitbang_jtag_bridge(void)
+{
+	struct bitbang_bridge *b = bitbang_interface->bridge;
+
+	return (b && b->jtag) ? b : NULL;
+}
+
 /* DANGER!!!! clock absolutely *MUST* be 0 in idle or reset won't work!
  *
  * Set this to 1 and str912 reset halt will fail.
@@ -85,18 +101,49 @@ static void bitbang_end_state(tap_state_t state)
 	}
 }
 
-static void bitbang_state_move(int skip)
+/* Clock out num_bits TMS bits (LSB first) with TDI low, leaving TCK low */
+static void bitbang_tms_seq(const uint8_t *bits, unsigned int num_bits)
 {
-	int i = 0, tms = 0;
-	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), tap_get_end_state());
-	int tms_count = tap_get_tms_path_len(tap_get_state(), tap_get_end_state());
+	struct bitbang_bridge *b = bitbang_jtag_bridge();
+	int tms = 0;
+
+	if (b) {
+		bitbang_bridge_tms_seq(b, bits, num_bits);
+		return;
+	}
 
-	for (i = skip; i < tms_count; i++) {
-		tms = (tms_scan >> i) & 1;
+	for (unsigned int i = 0; i < num_bits; i++) {
+		tms = (bits[i / 8] >> (i % 8)) & 1;
 		bitbang_interface->write(0, tms, 0);
 		bitbang_interface->write(1, tms, 0);
 	}
 	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+}
+
+/* Clock num_cycles cycles with a constant TMS and TDI low, leaving TCK low */
+static void bitbang_clocks(unsigned int num_cycles, int tms)
+{
+	struct bitbang_bridge *b = bitbang_jtag_bridge();
+
+	if (b) {
+		bitbang_bridge_clocks(b, num_cycles, tms);
+		return;
+	}
+
+	for (unsigned int i = 0; i < num_cycles; i++) {
+		bitbang_interface->write(0, tms, 0);
+		bitbang_interface->write(1, tms, 0);
+	}
+	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+}
+
+static void bitbang_state_move(int skip)
+{
+	uint8_t tms_scan = tap_get_tms_path(tap_get_state(), tap_get_end_state());
+	int tms_count = tap_get_tms_path_len(tap_get_state(), tap_get_end_state());
+
+	tms_scan >>= skip;
+	bitbang_tms_seq(&tms_scan, tms_count - skip);
 
 	tap_set_state(tap_get_end_state());
 }
@@ -112,13 +159,7 @@ static int bitbang_execute_tms(struct jtag_command *cmd)
 
 	DEBUG_JTAG_IO("TMS: %d bits", num_bits);
 
-	int tms = 0;
-	for (unsigned i = 0; i < num_bits; i++) {
-		tms = ((bits[i/8] >> (i % 8)) & 1);
-		bitbang_interface->write(0, tms, 0);
-		bitbang_interface->write(1, tms, 0);
-	}
-	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+	bitbang_tms_seq(bits, num_bits);
 
 	return ERROR_OK;
 }
@@ -127,14 +168,19 @@ static void bitbang_path_move(struct pathmove_command *cmd)
 {
 	int num_states = cmd->num_states;
 	int state_count;
-	int tms = 0;
+	uint8_t *tms_bits = calloc(DIV_ROUND_UP(num_states, 8), 1);
+
+	if (tms_bits == NULL) {
+		LOG_ERROR("BUG: out of memory");
+		exit(-1);
+	}
 
 	state_count = 0;
 	while (num_states) {
 		if (tap_state_transition(tap_get_state(), false) == cmd->path[state_count])
-			tms = 0;
+			;
 		else if (tap_state_transition(tap_get_state(), true) == cmd->path[state_count])
-			tms = 1;
+			tms_bits[state_count / 8] |= 1 << (state_count % 8);
 		else {
 			LOG_ERROR("BUG: %s -> %s isn't a valid TAP transition",
 				tap_state_name(tap_get_state()),
@@ -142,23 +188,19 @@ static void bitbang_path_move(struct pathmove_command *cmd)
 			exit(-1);
 		}
 
-		bitbang_interface->write(0, tms, 0);
-		bitbang_interface->write(1, tms, 0);
-
 		tap_set_state(cmd->path[state_count]);
 		state_count++;
 		num_states--;
 	}
 
-	bitbang_interface->write(CLOCK_IDLE(), tms, 0);
+	bitbang_tms_seq(tms_bits, state_count);
+	free(tms_bits);
 
 	tap_set_end_state(tap_get_state());
 }
 
 static void bitbang_runtest(int num_cycles)
 {
-	int i;
-
 	tap_state_t saved_end_state = tap_get_end_state();
 
 	/* only do a state_move when we're not already in IDLE */
@@ -168,11 +210,7 @@ static void bitbang_runtest(int num_cycles)
 	}
 
 	/* execute num_cycles */
-	for (i = 0; i < num_cycles; i++) {
-		bitbang_interface->write(0, 0, 0);
-		bitbang_interface->write(1, 0, 0);
-	}
-	bitbang_interface->write(CLOCK_IDLE(), 0, 0);
+	bitbang_clocks(num_cycles, 0);
 
 	/* finish in end_state */
 	bitbang_end_state(saved_end_state);
@@ -182,10 +220,16 @@ static void bitbang_runtest(int num_cycles)
 
 static void bitbang_stableclocks(int num_cycles)
 {
+	struct bitbang_bridge *b = bitbang_jtag_bridge();
 	int tms = (tap_get_state() == TAP_RESET ? 1 : 0);
 	int i;
 
-	/* send num_cycles clocks onto the cable */
+	if (b) {
+		bitbang_bridge_clocks(b, num_cycles, tms);
+		return;
+	}
+
+	/* send num_cycles clocks onto the cable, rising edge first */
 	for (i = 0; i < num_cycles; i++) {
 		bitbang_interface->write(1, tms, 0);
 		bitbang_interface->write(0, tms, 0);
@@ -195,6 +239,7 @@ static void bitbang_stableclocks(int num_cycles)
 static void bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int scan_size)
 {
 	tap_state_t saved_end_state = tap_get_end_state();
+	struct bitbang_bridge *b = bitbang_jtag_bridge();
 	int bit_cnt;
 
 	if (!((!ir_scan &&
@@ -209,33 +254,38 @@ static void bitbang_scan(bool ir_scan, enum scan_type type, uint8_t *buffer, int
 		bitbang_end_state(saved_end_state);
 	}
 
-	for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
-		int val = 0;
-		int tms = (bit_cnt == scan_size-1) ? 1 : 0;
-		int tdi;
-		int bytec = bit_cnt/8;
-		int bcval = 1 << (bit_cnt % 8);
-
-		/* if we're just reading the scan, but don't care about the output
-		 * default to outputting 'low', this also makes valgrind traces more readable,
-		 * as it removes the dependency on an uninitialised value
-		 */
-		tdi = 0;
-		if ((type != SCAN_IN) && (buffer[bytec] & bcval))
-			tdi = 1;
-
-		bitbang_interface->write(0, tms, tdi);
-
-		if (type != SCAN_OUT)
-			val = bitbang_interface->read();
-
-		bitbang_interface->write(1, tms, tdi);
-
-		if (type != SCAN_OUT) {
-			if (val)
-				buffer[bytec] |= bcval;
-			else
-				buffer[bytec] &= ~bcval;
+	if (b) {
+		/* one bridge command, exiting the shift state on the last bit */
+		bitbang_bridge_scan(b, type, buffer, scan_size);
+	} else {
+		for (bit_cnt = 0; bit_cnt < scan_size; bit_cnt++) {
+			int val = 0;
+			int tms = (bit_cnt == scan_size-1) ? 1 : 0;
+			int tdi;
+			int bytec = bit_cnt/8;
+			int bcval = 1 << (bit_cnt % 8);
+
+			/* if we're just reading the scan, but don't care about the output
+			 * default to outputting 'low', this also makes valgrind traces more readable,
+			 * as it removes the dependency on an uninitialised value
+			 */
+			tdi = 0;
+			if ((type != SCAN_IN) && (buffer[bytec] & bcval))
+				tdi = 1;
+
+			bitbang_interface->write(0, tms, tdi);
+
+			if (type != SCAN_OUT)
+				val = bitbang_interface->read();
+
+			bitbang_interface->write(1, tms, tdi);
+
+			if (type != SCAN_OUT) {
+				if (val)
+					buffer[bytec] |= bcval;
+				else
+					buffer[bytec] &= ~bcval;
+			}
 		}
 	}
 
@@ -348,212 +398,434 @@ int bitbang_execute_queue(void)
 	if (bitbang_interface->blink)
 		bitbang_interface->blink(0);
 
+	struct bitbang_bridge *b = bitbang_jtag_bridge();
+	if (b && bitbang_bridge_jtag_run(b) != ERROR_OK)
+		retval = ERROR_JTAG_QUEUE_FAILED;
+
 	return retval;
 }
 
 
 bool swd_mode;
-static int queued_retval;
 
-int set_interface_attribs (int fd, int speed, int parity)
+/*
+ * SWD goes through a serial bridge: the probe firmware shifts the bits on
+ * the wire on behalf of the host.  The swd_driver callbacks carry no
+ * context, they work on the bridge of the active bitbang_interface.
+ */
+static struct bitbang_bridge *bitbang_swd_bridge(void)
 {
-    struct termios tty;
-    memset (&tty, 0, sizeof tty);
-    if (tcgetattr (fd, &tty) != 0)
-    {
-        printf ("error %d from tcgetattr", errno);
-        return -1;
-    }
+	return bitbang_interface ? bitbang_interface->bridge : NULL;
+}
 
-    cfsetospeed (&tty, speed);
-    cfsetispeed (&tty, speed);
+static const struct {
+	int rate;
+	speed_t speed;
+} bitbang_bridge_baudrates[] = {
+	{ 9600, B9600 },
+	{ 19200, B19200 },
+	{ 38400, B38400 },
+	{ 57600, B57600 },
+	{ 115200, B115200 },
+	{ 230400, B230400 },
+#ifdef B460800
+	{ 460800, B460800 },
+#endif
+#ifdef B921600
+	{ 921600, B921600 },
+#endif
+#ifdef B1000000
+	{ 1000000, B1000000 },
+#endif
+#ifdef B2000000
+	{ 2000000, B2000000 },
+#endif
+#ifdef B3000000
+	{ 3000000, B3000000 },
+#endif
+};
+
+int bitbang_bridge_set_port(struct bitbang_bridge *b, const char *port)
+{
+	free(b->port);
+	b->port = strdup(port);
+	return b->port ? ERROR_OK : ERROR_FAIL;
+}
+
+const char *bitbang_bridge_get_port(struct bitbang_bridge *b)
+{
+	return b->port ? b->port : BITBANG_BRIDGE_DEFAULT_PORT;
+}
+
+int bitbang_bridge_set_baudrate(struct bitbang_bridge *b, int baudrate)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(bitbang_bridge_baudrates); i++) {
+		if (bitbang_bridge_baudrates[i].rate == baudrate) {
+			b->baudrate = baudrate;
+			return ERROR_OK;
+		}
+	}
 
-    tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8;     // 8-bit chars
-    // disable IGNBRK for mismatched speed tests; otherwise receive break
-    // as \000 chars
-    tty.c_iflag &= ~IGNBRK;         // disable break processing
-    tty.c_lflag = 0;                // no signaling chars, no echo,
-    // no canonical processing
-    tty.c_oflag = 0;                // no remapping, no delays
-    tty.c_cc[VMIN]  = 1;            // read doesn't block
-    tty.c_cc[VTIME] = 5;            // 0.5 seconds read timeout
+	LOG_ERROR("unsupported bridge baudrate %d", baudrate);
+	return ERROR_COMMAND_ARGUMENT_INVALID;
+}
 
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // shut off xon/xoff ctrl
+int bitbang_bridge_get_baudrate(struct bitbang_bridge *b)
+{
+	return b->baudrate;
+}
 
-    tty.c_cflag |= (CLOCAL | CREAD);// ignore modem controls,
-    // enable reading
-    tty.c_cflag &= ~(PARENB | PARODD);      // shut off parity
-    tty.c_cflag |= parity;
-    tty.c_cflag &= ~CSTOPB;
-    tty.c_cflag &= ~CRTSCTS;
+int bitbang_bridge_set_swd_retry(struct bitbang_bridge *b, unsigned int retry)
+{
+	if (retry > 0xff) {
+		LOG_ERROR("at most 255 SWD WAIT retries can be done by the bridge");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
 
-    if (tcsetattr (fd, TCSANOW, &tty) != 0)
-    {
-        printf ("error %d from tcsetattr", errno);
-        return -1;
-    }
-    return 0;
+	b->swd_retry = retry;
+	return ERROR_OK;
 }
 
-void
-set_blocking (int fd, int should_block)
+unsigned int bitbang_bridge_get_swd_retry(struct bitbang_bridge *b)
 {
-    struct termios tty;
-    memset (&tty, 0, sizeof tty);
-    if (tcgetattr (fd, &tty) != 0)
-    {
-        printf ("error %d from tggetattr", errno);
-        return;
-    }
+	return b->swd_retry;
+}
+
+void bitbang_bridge_close(struct bitbang_bridge *b)
+{
+	if (b->fd >= 0)
+		close(b->fd);
+	b->fd = -1;
+	b->jtag = false;
+
+	free(b->tx_buf);
+	b->tx_buf = NULL;
+	b->tx_size = 0;
+	free(b->rx_buf);
+	b->rx_buf = NULL;
+	b->rx_size = 0;
+}
+
+/* raw 8n1, no flow control; reads return what is there or time out after 0.5 s */
+static int bitbang_bridge_setup_tty(struct bitbang_bridge *b)
+{
+	speed_t speed = B115200;
+	for (size_t i = 0; i < ARRAY_SIZE(bitbang_bridge_baudrates); i++) {
+		if (bitbang_bridge_baudrates[i].rate == b->baudrate)
+			speed = bitbang_bridge_baudrates[i].speed;
+	}
+
+	struct termios tty;
+	memset(&tty, 0, sizeof(tty));
+	if (tcgetattr(b->fd, &tty) != 0) {
+		LOG_ERROR("tcgetattr failed: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	cfsetospeed(&tty, speed);
+	cfsetispeed(&tty, speed);
+
+	tty.c_cflag = (tty.c_cflag & ~CSIZE) | CS8;
+	tty.c_cflag |= CLOCAL | CREAD;
+	tty.c_cflag &= ~(PARENB | PARODD | CSTOPB | CRTSCTS);
+	tty.c_iflag &= ~(IGNBRK | IXON | IXOFF | IXANY);
+	tty.c_lflag = 0;
+	tty.c_oflag = 0;
+	tty.c_cc[VMIN] = 0;
+	tty.c_cc[VTIME] = 5;
 
-    tty.c_cc[VMIN]  = should_block ? 1 : 0;
-    tty.c_cc[VTIME] = 5;            // 0.5 seconds read timeout
+	if (tcsetattr(b->fd, TCSANOW, &tty) != 0) {
+		LOG_ERROR("tcsetattr failed: %s", strerror(errno));
+		return ERROR_FAIL;
+	}
 
-    if (tcsetattr (fd, TCSANOW, &tty) != 0)
-        printf ("error %d setting term attributes", errno);
+	return ERROR_OK;
 }
-int fd;
 
+int bitbang_bridge_init(struct bitbang_bridge *b)
+{
+	const char *port = bitbang_bridge_get_port(b);
 
+	bitbang_bridge_close(b);
+	b->fd = open(port, O_RDWR | O_NOCTTY | O_SYNC);
+	if (b->fd < 0) {
+		LOG_ERROR("cannot open bridge %s: %s", port, strerror(errno));
+		return ERROR_FAIL;
+	}
+
+	if (bitbang_bridge_setup_tty(b) != ERROR_OK) {
+		bitbang_bridge_close(b);
+		return ERROR_FAIL;
+	}
+
+	b->jtag = !swd_mode;
+	LOG_INFO("%s bridge on %s at %d baud", swd_mode ? "SWD" : "JTAG", port, b->baudrate);
+	return ERROR_OK;
+}
 
+/* the bridge itself is opened by the driver's init, which runs later */
 static int bitbang_swd_init(void)
 {
 	LOG_DEBUG("bitbang_swd_init");
 	swd_mode = true;
-    char *portname = "/dev/ttyACM0";
-    fd = open (portname, O_RDWR | O_NOCTTY | O_SYNC);
-    if (fd < 0)
-    {
-        printf ("error %d opening %s: %s", errno, portname, strerror (errno));
-        return ERROR_FAIL;
-    }
-    set_interface_attribs (fd, B115200, 0);  // set speed to 115,200 bps, 8n1 (no parity)
-    set_blocking (fd, 0);                // set no blocking
-    
 	return ERROR_OK;
 }
 
 #define GET_UPPER_HEX(x) ((((x) >> 4) & 0x0F) > 9 ? ((((x) >> 4) & 0x0F) - 10 + 'A') : ((((x) >> 4) & 0x0F) + '0'))
 #define GET_LOWER_HEX(x) (((x) & 0x0F) > 9 ? (((x) & 0x0F) - 10 + 'A') : (((x) & 0x0F) + '0'))
 #define HEX_TO_INT(x) ((x) >= 'A' ? ((x) - 'A' + 10) : ((x) - '0'))
-uint8_t local_buf[1024];
 
-#define PRINTF(x, ...) do {                     \
-    }while(0)                                   \
-    
-#define USLEEP(x, ...) do {                     \
-    }while(0)                                   \
-    
+/*
+ * Every bridge command is a command byte followed by three counts and
+ * optional data bytes, all as hex.  In a short frame the counts take two
+ * hex digits each.  Setting BITBANG_BRIDGE_LONG in the command byte selects
+ * a long frame with eight hex digits (32 bits, most significant first) per
+ * count, for transfers beyond 255 bits or bytes.  Short frames are used
+ * whenever the counts fit, so bridges without long frame support keep
+ * working for ordinary traffic.  The last count is the number of data bytes
+ * that follow, except for 0xF1 reads where it is only the reply length.
+ */
+#define BITBANG_BRIDGE_LONG		0x08
+
+/* consecutive silent 0.5 s tty reads before a reply is given up on */
+#define BITBANG_BRIDGE_READ_RETRIES	4
 
-static void bitbang_exchange(bool rnw, uint8_t buf[], unsigned int offset, unsigned int bit_cnt)
+/* make sure the tx and rx buffers hold a frame with data_len bytes of data */
+static int bitbang_bridge_reserve(struct bitbang_bridge *b, size_t data_len)
+{
+	size_t tx_size = 1 + 3 * 8 + 2 * data_len;
+	/* writes are acknowledged with one byte */
+	size_t rx_size = MAX(data_len, 1);
+
+	if (tx_size > b->tx_size) {
+		char *tx = realloc(b->tx_buf, tx_size);
+		if (tx == NULL)
+			return ERROR_FAIL;
+		b->tx_buf = tx;
+		b->tx_size = tx_size;
+	}
+
+	if (rx_size > b->rx_size) {
+		uint8_t *rx = realloc(b->rx_buf, rx_size);
+		if (rx == NULL)
+			return ERROR_FAIL;
+		b->rx_buf = rx;
+		b->rx_size = rx_size;
+	}
+
+	return ERROR_OK;
+}
+
+/* Send one frame; data may be NULL when data_len counts bytes the bridge
+ * doesn't need, e.g. the reply length of a read. */
+static int bitbang_bridge_send(struct bitbang_bridge *b, uint8_t cmd,
+		uint32_t count0, uint32_t count1, uint32_t data_len, const uint8_t *data)
+{
+	const uint32_t counts[] = { count0, count1, data_len };
+	bool long_frame = count0 > 0xff || count1 > 0xff || data_len > 0xff;
+	size_t n = 0;
+
+	if (bitbang_bridge_reserve(b, data_len) != ERROR_OK)
+		return ERROR_FAIL;
+
+	char *frame = b->tx_buf;
+	frame[n++] = long_frame ? cmd | BITBANG_BRIDGE_LONG : cmd;
+	for (unsigned int i = 0; i < ARRAY_SIZE(counts); i++) {
+		for (int shift = long_frame ? 24 : 0; shift >= 0; shift -= 8) {
+			frame[n++] = GET_UPPER_HEX(counts[i] >> shift);
+			frame[n++] = GET_LOWER_HEX(counts[i] >> shift);
+		}
+	}
+	for (uint32_t i = 0; data && i < data_len; i++) {
+		frame[n++] = GET_UPPER_HEX(data[i]);
+		frame[n++] = GET_LOWER_HEX(data[i]);
+	}
+
+	if (write(b->fd, frame, n) != (ssize_t)n) {
+		LOG_ERROR("writing bridge frame failed");
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/* Collect a reply of len bytes, sent by the bridge as two hex digits each */
+static int bitbang_bridge_read_hex(struct bitbang_bridge *b, uint8_t *rx, size_t len)
+{
+	char hex[256];
+	size_t data_cnt = 0;
+	int retries = 0;
+
+	while (data_cnt / 2 < len) {
+		ssize_t n = read(b->fd, hex, MIN(sizeof(hex), 2 * len - data_cnt));
+		if (n <= 0) {
+			if (n < 0 || ++retries >= BITBANG_BRIDGE_READ_RETRIES) {
+				LOG_ERROR("no reply from bridge (%zu of %zu bytes)", data_cnt / 2, len);
+				return ERROR_FAIL;
+			}
+			continue;
+		}
+		retries = 0;
+		for (ssize_t i = 0; i < n; i++) {
+			if ((data_cnt & 0x01) == 0)
+				rx[data_cnt / 2] = HEX_TO_INT(hex[i]) << 4;
+			else
+				rx[data_cnt / 2] |= HEX_TO_INT(hex[i]);
+			data_cnt++;
+		}
+	}
+
+	return ERROR_OK;
+}
+
+/* remember the first bridge error until the queue is run */
+static void bitbang_bridge_check(struct bitbang_bridge *b, int retval)
+{
+	if (retval != ERROR_OK && b->queued_retval == ERROR_OK)
+		b->queued_retval = retval;
+}
+
+/*
+ * Shift bit_cnt bits starting at bit offset of buf through the bridge.
+ *
+ * Frame: 0xF0 (write) or 0xF1 (read), then bit_cnt, offset and data_len,
+ * then for writes data_len bytes of data.
+ * A read answers with data_len bytes as hex, a write with one hex byte.
+ * A read without buffer (data_len 0) just clocks idle cycles.
+ */
+static void bitbang_exchange(struct bitbang_bridge *b, bool rnw, uint8_t buf[],
+		unsigned int offset, unsigned int bit_cnt)
 {
 	LOG_DEBUG("bitbang_exchange");
-//	int tdi;
-    int data_len = DIV_ROUND_UP(bit_cnt + offset, 8);
-    char hex[128];
-    int n;
-    int i = 0;
-    int data_cnt = 0;
-    if (rnw) {
-        hex[0] = 0xF1;
-        hex[1] = GET_UPPER_HEX(bit_cnt);
-        hex[2] = GET_LOWER_HEX(bit_cnt);
-        hex[3] = GET_UPPER_HEX(offset);
-        hex[4] = GET_LOWER_HEX(offset);
-        if (buf != NULL) {
-            hex[5] = GET_UPPER_HEX(data_len);
-            hex[6] = GET_LOWER_HEX(data_len);
-        } else {
-            hex[5] = '0';
-            hex[6] = '0';
-        }
-        n = write(fd, hex, 7);
-        if (buf == NULL) {
-            usleep(10000);
-            return;
-        }
-        while(1) {
-            n = read (fd, hex, sizeof(hex));  // read up to 1 character if ready to read */
-            for (i = 0; i < n; i++) {
-                PRINTF("data_cnt = %d\r\n", data_cnt);
-                if ((data_cnt & 0x01) == 0) {
-                    local_buf[(data_cnt++) / 2] = (HEX_TO_INT(hex[i]) << 4);
-                } else {
-                    local_buf[(data_cnt++) / 2] |= (HEX_TO_INT(hex[i]) << 0);
-                }
-            }
-            if (data_cnt / 2 == data_len) {
-                /* LOG_DEBUG("Read OK\r\n");                  */
-                for (i = offset; (unsigned int)i < bit_cnt + offset; i++) {
-                    int bytec = i/8;
-                    int bcval = 1 << (i % 8);
-                    if (local_buf[bytec] & bcval)
-                        buf[bytec] |= bcval;
-                    else
-                        buf[bytec] &= ~bcval;
-                }
-               PRINTF("read receiving:\r\n");
-                for (i = 0; i < data_len; i++) {
-                    PRINTF("%02x ", buf[i]);
-                }
-                PRINTF("\r\n");
-                return;
-            }
-        }
-    } else {
-        hex[0] = 0xF0;
-        hex[1] = GET_UPPER_HEX(bit_cnt);
-        hex[2] = GET_LOWER_HEX(bit_cnt);
-        hex[3] = GET_UPPER_HEX(offset);
-        hex[4] = GET_LOWER_HEX(offset);
-        if (buf != NULL) {
-            hex[5] = GET_UPPER_HEX(data_len);
-            hex[6] = GET_LOWER_HEX(data_len);
-        } else {
-            hex[5] = '0';
-            hex[6] = '0';
-        }
-        n = write(fd, hex, 7);
-        if (buf != NULL) {
-            for (i = 0; i < data_len; i++){
-                hex[0] = GET_UPPER_HEX(buf[i]);
-                hex[1] = GET_LOWER_HEX(buf[i]);
-                n = write(fd, hex, 2);                            
-            }
-        }
-        data_cnt = 0;
-        while(1) {
-            n = read (fd, hex, sizeof(hex));  // read up to 1 character if ready to read */
-            for (i = 0; i < n; i++) {
-                if ((data_cnt & 0x01) == 0) {
-                    local_buf[(data_cnt++) / 2] = (HEX_TO_INT(hex[i]) << 4);
-                } else {
-                    local_buf[(data_cnt++) / 2] |= (HEX_TO_INT(hex[i]) << 0);
-                }
-            }
-            if (data_cnt / 2 == 1) {
-                return;
-            }
-        }
-    }
+	unsigned int data_len = DIV_ROUND_UP(bit_cnt + offset, 8);
+	int retval;
+
+	retval = bitbang_bridge_send(b, rnw ? 0xF1 : 0xF0, bit_cnt, offset,
+			buf ? data_len : 0, rnw ? NULL : buf);
+	if (retval != ERROR_OK) {
+		bitbang_bridge_check(b, retval);
+		return;
+	}
+
+	if (rnw && buf == NULL) {
+		usleep(10000);
+		return;
+	}
+
+	uint8_t *rx = b->rx_buf;
+	retval = bitbang_bridge_read_hex(b, rx, rnw ? data_len : 1);
+	if (retval != ERROR_OK) {
+		bitbang_bridge_check(b, retval);
+		return;
+	}
+
+	if (!rnw)
+		return;
+
+	for (unsigned int i = offset; i < bit_cnt + offset; i++) {
+		int bytec = i / 8;
+		int bcval = 1 << (i % 8);
+		if (rx[bytec] & bcval)
+			buf[bytec] |= bcval;
+		else
+			buf[bytec] &= ~bcval;
+	}
+}
+
+/*
+ * JTAG through the bridge.  Each command leaves TCK low.
+ *
+ * Frame: command byte, then bit_cnt, flags and data_len, then data_len
+ * bytes of data.  The bridge answers with data_len bytes of TDO as hex if
+ * BITBANG_BRIDGE_JTAG_TDO is set, otherwise with one hex byte.
+ *   0xD0  clock bit_cnt TMS bits from data, TDI low
+ *   0xD1  shift bit_cnt TDI bits from data, TMS low except on the last bit
+ *         if BITBANG_BRIDGE_JTAG_TMS_LAST is set.  The TDI bytes are always
+ *         sent, zeros for in-only scans, so that the frame length follows
+ *         from its header alone
+ *   0xD2  clock bit_cnt cycles, TDI low, TMS high if BITBANG_BRIDGE_JTAG_TMS
+ */
+#define BITBANG_BRIDGE_JTAG_TMS_SEQ	0xD0
+#define BITBANG_BRIDGE_JTAG_SCAN	0xD1
+#define BITBANG_BRIDGE_JTAG_CLOCKS	0xD2
+
+#define BITBANG_BRIDGE_JTAG_TDO		0x01
+#define BITBANG_BRIDGE_JTAG_TMS_LAST	0x02
+#define BITBANG_BRIDGE_JTAG_TMS		0x04
+
+static void bitbang_bridge_jtag_cmd(struct bitbang_bridge *b, uint8_t cmd,
+		unsigned int bit_cnt, uint8_t flags, const uint8_t *out, uint8_t *in)
+{
+	unsigned int data_len = DIV_ROUND_UP(bit_cnt, 8);
+	int retval;
+
+	if (b->queued_retval != ERROR_OK)
+		return;
+
+	retval = bitbang_bridge_send(b, cmd, bit_cnt, flags, out ? data_len : 0, out);
+	if (retval == ERROR_OK) {
+		if (flags & BITBANG_BRIDGE_JTAG_TDO)
+			retval = bitbang_bridge_read_hex(b, in, data_len);
+		else
+			retval = bitbang_bridge_read_hex(b, b->rx_buf, 1);
+	}
+	bitbang_bridge_check(b, retval);
+}
+
+static void bitbang_bridge_tms_seq(struct bitbang_bridge *b, const uint8_t *bits,
+		unsigned int num_bits)
+{
+	bitbang_bridge_jtag_cmd(b, BITBANG_BRIDGE_JTAG_TMS_SEQ, num_bits, 0, bits, NULL);
+}
+
+static void bitbang_bridge_clocks(struct bitbang_bridge *b, unsigned int num_cycles, int tms)
+{
+	bitbang_bridge_jtag_cmd(b, BITBANG_BRIDGE_JTAG_CLOCKS, num_cycles,
+			tms ? BITBANG_BRIDGE_JTAG_TMS : 0, NULL, NULL);
+}
+
+static void bitbang_bridge_scan(struct bitbang_bridge *b, enum scan_type type,
+		uint8_t *buffer, int scan_size)
+{
+	uint8_t flags = BITBANG_BRIDGE_JTAG_TMS_LAST;
+
+	if (type != SCAN_OUT)
+		flags |= BITBANG_BRIDGE_JTAG_TDO;
+
+	/* TDI data is always sent, the buffer holds zeros for SCAN_IN */
+	bitbang_bridge_jtag_cmd(b, BITBANG_BRIDGE_JTAG_SCAN, scan_size, flags,
+			buffer, buffer);
+}
+
+static int bitbang_bridge_jtag_run(struct bitbang_bridge *b)
+{
+	int retval = b->queued_retval;
+	b->queued_retval = ERROR_OK;
+	return retval;
 }
 
 int bitbang_swd_switch_seq(enum swd_special_seq seq)
 {
 	LOG_DEBUG("bitbang_swd_switch_seq");
+	struct bitbang_bridge *b = bitbang_swd_bridge();
+
+	if (b == NULL) {
+		LOG_ERROR("SWD needs a serial bridge");
+		return ERROR_FAIL;
+	}
 
 	switch (seq) {
 	case LINE_RESET:
 		LOG_DEBUG("SWD line reset");
-		bitbang_exchange(false, (uint8_t *)swd_seq_line_reset, 0, swd_seq_line_reset_len);
+		bitbang_exchange(b, false, (uint8_t *)swd_seq_line_reset, 0, swd_seq_line_reset_len);
 		break;
 	case JTAG_TO_SWD:
 		LOG_DEBUG("JTAG-to-SWD");
-		bitbang_exchange(false, (uint8_t *)swd_seq_jtag_to_swd, 0, swd_seq_jtag_to_swd_len);
+		bitbang_exchange(b, false, (uint8_t *)swd_seq_jtag_to_swd, 0, swd_seq_jtag_to_swd_len);
 		break;
 	case SWD_TO_JTAG:
 		LOG_DEBUG("SWD-to-JTAG");
-		bitbang_exchange(false, (uint8_t *)swd_seq_swd_to_jtag, 0, swd_seq_swd_to_jtag_len);
+		bitbang_exchange(b, false, (uint8_t *)swd_seq_swd_to_jtag, 0, swd_seq_swd_to_jtag_len);
 		break;
 	default:
 		LOG_ERROR("Sequence %d not supported", seq);
@@ -566,7 +838,29 @@ int bitbang_swd_switch_seq(enum swd_special_seq seq)
 void bitbang_switch_to_swd(void)
 {
 	LOG_DEBUG("bitbang_switch_to_swd");
-	bitbang_exchange(false, (uint8_t *)swd_seq_jtag_to_swd, 0, swd_seq_jtag_to_swd_len);
+	struct bitbang_bridge *b = bitbang_swd_bridge();
+
+	if (b == NULL)
+		return;
+	bitbang_exchange(b, false, (uint8_t *)swd_seq_jtag_to_swd, 0, swd_seq_jtag_to_swd_len);
+}
+
+static void bitbang_swd_count_ack(int ack)
+{
+	switch (ack) {
+	case SWD_ACK_OK:
+		perf_count(PERF_SWD_ACK_OK, 1);
+		break;
+	case SWD_ACK_WAIT:
+		perf_count(PERF_SWD_ACK_WAIT, 1);
+		break;
+	case SWD_ACK_FAULT:
+		perf_count(PERF_SWD_ACK_FAULT, 1);
+		break;
+	default:
+		perf_count(PERF_SWD_ACK_JUNK, 1);
+		break;
+	}
 }
 
 static void swd_clear_sticky_errors(void)
@@ -574,29 +868,125 @@ static void swd_clear_sticky_errors(void)
 	bitbang_swd_write_reg(swd_cmd(false,  false, DP_ABORT),
 		STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR, 0);
 }
-static void bitbang_interface_swdio_drive(bool out)
-{
-    volatile int i;
-    uint8_t hex[2];
-    if (out) {
-        hex[0] = 0xE1;
-        i = write(fd, hex, 1);
-    } else {
-        hex[0] = 0xE0;
-        i = write(fd, hex, 1);
-    }
-    if (i == 0) {
-        LOG_DEBUG("What?\r\n");
-    }
-    
-};
+
+/* 0xE1 makes the bridge drive SWDIO, 0xE0 releases it for the target */
+static void bitbang_interface_swdio_drive(struct bitbang_bridge *b, bool out)
+{
+	uint8_t cmd = out ? 0xE1 : 0xE0;
+
+	if (write(b->fd, &cmd, 1) != 1)
+		LOG_DEBUG("writing swdio direction failed");
+}
+
+/*
+ * One complete SWD transaction done by the bridge, including the retries
+ * on WAIT.
+ *
+ * Frame: 0xC0, then the request byte, the retry limit and data_len (4 for
+ * writes, 0 for reads), then for writes the data, least significant byte
+ * first.  The bridge answers with 8 bytes: the final ACK, the parity bit,
+ * the number of WAIT answers it retried (16 bit, the final ACK is not one
+ * of them) and the read data (32 bit), both least significant byte first.
+ *
+ * The bridge does not touch the DP on its own: when it gives up on WAIT or
+ * gets a FAULT, the host clears the sticky errors.
+ */
+#define BITBANG_BRIDGE_SWD_TRANSACTION	0xC0
+
+/* same as swd_clear_sticky_errors(), without retrying or queueing */
+static void bitbang_bridge_clear_sticky_errors(struct bitbang_bridge *b)
+{
+	uint8_t cmd = swd_cmd(false, false, DP_ABORT) | SWD_CMD_START | (1 << 7);
+	uint8_t data[4];
+	uint8_t reply[8];
+
+	h_u32_to_le(data, STKCMPCLR | STKERRCLR | WDERRCLR | ORUNERRCLR);
+	if (bitbang_bridge_send(b, BITBANG_BRIDGE_SWD_TRANSACTION, cmd, 0, 4, data) == ERROR_OK)
+		bitbang_bridge_read_hex(b, reply, sizeof(reply));
+}
+
+static int bitbang_swd_transaction(struct bitbang_bridge *b, uint8_t cmd, uint32_t *value,
+		uint32_t ap_delay_clk)
+{
+	uint8_t data[4];
+	uint8_t reply[8];
+	int retval;
+
+	if (!(cmd & SWD_CMD_RnW))
+		h_u32_to_le(data, *value);
+
+	cmd |= SWD_CMD_START | (1 << 7);
+	retval = bitbang_bridge_send(b, BITBANG_BRIDGE_SWD_TRANSACTION, cmd, b->swd_retry,
+			(cmd & SWD_CMD_RnW) ? 0 : 4, data);
+	if (retval == ERROR_OK)
+		retval = bitbang_bridge_read_hex(b, reply, sizeof(reply));
+	if (retval != ERROR_OK)
+		return retval;
+
+	int ack = reply[0] & 0x7;
+	unsigned int waits = le_to_h_u16(&reply[2]);
+	uint32_t rdata = le_to_h_u32(&reply[4]);
+
+	b->queued_transactions++;
+	b->queued_waits += waits;
+	b->queued_max_waits = MAX(b->queued_max_waits, waits);
+	/* every retried WAIT, the final ACK is counted below */
+	perf_count(PERF_SWD_ACK_WAIT, waits);
+	perf_count(PERF_SWD_WAIT_RETRY, waits);
+
+	LOG_DEBUG("%s %s %s reg %X = %08"PRIx32 " after %u WAIT",
+		  ack == SWD_ACK_OK ? "OK" : ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK",
+		  cmd & SWD_CMD_APnDP ? "AP" : "DP",
+		  cmd & SWD_CMD_RnW ? "read" : "write",
+		  (cmd & SWD_CMD_A32) >> 1,
+		  (cmd & SWD_CMD_RnW) ? rdata : *value,
+		  waits);
+
+	bitbang_swd_count_ack(ack);
+	switch (ack) {
+	 case SWD_ACK_OK:
+		if ((cmd & SWD_CMD_RnW) && (reply[1] & 1) != parity_u32(rdata)) {
+			LOG_DEBUG("Wrong parity detected");
+			return ERROR_FAIL;
+		}
+		if (cmd & SWD_CMD_RnW)
+			*value = rdata;
+		if (cmd & SWD_CMD_APnDP)
+			bitbang_exchange(b, true, NULL, 0, ap_delay_clk);
+		return ERROR_OK;
+	 case SWD_ACK_WAIT:
+		LOG_DEBUG("SWD_ACK_WAIT after %u retries", waits);
+		bitbang_bridge_clear_sticky_errors(b);
+		return ack;
+	 case SWD_ACK_FAULT:
+		LOG_DEBUG("SWD_ACK_FAULT");
+		bitbang_bridge_clear_sticky_errors(b);
+		return ack;
+	 default:
+		LOG_DEBUG("No valid acknowledge: ack=%d", ack);
+		return ack;
+	}
+}
+
 static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
 {
 	LOG_DEBUG("bitbang_swd_read_reg");
+	struct bitbang_bridge *b = bitbang_swd_bridge();
 	assert(cmd & SWD_CMD_RnW);
 
-	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skip bitbang_swd_read_reg because queued_retval=%d", queued_retval);
+	if (b == NULL)
+		return;
+
+	if (b->queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skip bitbang_swd_read_reg because queued_retval=%d", b->queued_retval);
+		return;
+	}
+
+	if (b->swd_retry) {
+		uint32_t data;
+		b->queued_retval = bitbang_swd_transaction(b, cmd, &data, ap_delay_clk);
+		if (b->queued_retval == ERROR_OK && value)
+			*value = data;
 		return;
 	}
 
@@ -604,11 +994,11 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 		uint8_t trn_ack_data_parity_trn[DIV_ROUND_UP(4 + 3 + 32 + 1 + 4, 8)];
 
 		cmd |= SWD_CMD_START | (1 << 7);
-		bitbang_exchange(false, &cmd, 0, 8);
+		bitbang_exchange(b, false, &cmd, 0, 8);
 
-		bitbang_interface_swdio_drive(false);
-		bitbang_exchange(true, trn_ack_data_parity_trn, 0, 1 + 3 + 32 + 1 + 1);
-		bitbang_interface_swdio_drive(true);
+		bitbang_interface_swdio_drive(b, false);
+		bitbang_exchange(b, true, trn_ack_data_parity_trn, 0, 1 + 3 + 32 + 1 + 1);
+		bitbang_interface_swdio_drive(b, true);
 
 		int ack = buf_get_u32(trn_ack_data_parity_trn, 1, 3);
 		uint32_t data = buf_get_u32(trn_ack_data_parity_trn, 1 + 3, 32);
@@ -621,29 +1011,31 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 			  (cmd & SWD_CMD_A32) >> 1,
 			  data);
 
+		bitbang_swd_count_ack(ack);
 		switch (ack) {
 		 case SWD_ACK_OK:
 			if (parity != parity_u32(data)) {
 				LOG_DEBUG("Wrong parity detected");
-				queued_retval = ERROR_FAIL;
+				b->queued_retval = ERROR_FAIL;
 				return;
 			}
 			if (value)
 				*value = data;
 			if (cmd & SWD_CMD_APnDP)
-				bitbang_exchange(true, NULL, 0, ap_delay_clk);
+				bitbang_exchange(b, true, NULL, 0, ap_delay_clk);
 			return;
 		 case SWD_ACK_WAIT:
 			LOG_DEBUG("SWD_ACK_WAIT");
+			perf_count(PERF_SWD_WAIT_RETRY, 1);
 			swd_clear_sticky_errors();
 			break;
 		 case SWD_ACK_FAULT:
 			LOG_DEBUG("SWD_ACK_FAULT");
-			queued_retval = ack;
+			b->queued_retval = ack;
 			return;
 		 default:
 			LOG_DEBUG("No valid acknowledge: ack=%d", ack);
-			queued_retval = ack;
+			b->queued_retval = ack;
 			return;
 		}
 	}
@@ -652,10 +1044,19 @@ static void bitbang_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay
 static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
 {
 	LOG_DEBUG("bitbang_swd_write_reg");
+	struct bitbang_bridge *b = bitbang_swd_bridge();
 	assert(!(cmd & SWD_CMD_RnW));
 
-	if (queued_retval != ERROR_OK) {
-		LOG_DEBUG("Skip bitbang_swd_write_reg because queued_retval=%d", queued_retval);
+	if (b == NULL)
+		return;
+
+	if (b->queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skip bitbang_swd_write_reg because queued_retval=%d", b->queued_retval);
+		return;
+	}
+
+	if (b->swd_retry) {
+		b->queued_retval = bitbang_swd_transaction(b, cmd, &value, ap_delay_clk);
 		return;
 	}
 
@@ -665,12 +1066,12 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 		buf_set_u32(trn_ack_data_parity_trn, 1 + 3 + 1 + 32, 1, parity_u32(value));
 
 		cmd |= SWD_CMD_START | (1 << 7);
-		bitbang_exchange(false, &cmd, 0, 8);
+		bitbang_exchange(b, false, &cmd, 0, 8);
 
-		bitbang_interface_swdio_drive(false);
-		bitbang_exchange(true, trn_ack_data_parity_trn, 0, 1 + 3 + 1);
-		bitbang_interface_swdio_drive(true);
-		bitbang_exchange(false, trn_ack_data_parity_trn, 1 + 3 + 1, 32 + 1);
+		bitbang_interface_swdio_drive(b, false);
+		bitbang_exchange(b, true, trn_ack_data_parity_trn, 0, 1 + 3 + 1);
+		bitbang_interface_swdio_drive(b, true);
+		bitbang_exchange(b, false, trn_ack_data_parity_trn, 1 + 3 + 1, 32 + 1);
 
 		int ack = buf_get_u32(trn_ack_data_parity_trn, 1, 3);
 		LOG_DEBUG("%s %s %s reg %X = %08"PRIx32,
@@ -680,22 +1081,24 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 			  (cmd & SWD_CMD_A32) >> 1,
 			  buf_get_u32(trn_ack_data_parity_trn, 1 + 3 + 1, 32));
 
+		bitbang_swd_count_ack(ack);
 		switch (ack) {
 		 case SWD_ACK_OK:
 			if (cmd & SWD_CMD_APnDP)
-				bitbang_exchange(true, NULL, 0, ap_delay_clk);
+				bitbang_exchange(b, true, NULL, 0, ap_delay_clk);
 			return;
 		 case SWD_ACK_WAIT:
 			LOG_DEBUG("SWD_ACK_WAIT");
+			perf_count(PERF_SWD_WAIT_RETRY, 1);
 			swd_clear_sticky_errors();
 			break;
 		 case SWD_ACK_FAULT:
 			LOG_DEBUG("SWD_ACK_FAULT");
-			queued_retval = ack;
+			b->queued_retval = ack;
 			return;
 		 default:
 			LOG_DEBUG("No valid acknowledge: ack=%d", ack);
-			queued_retval = ack;
+			b->queued_retval = ack;
 			return;
 		}
 	}
@@ -704,13 +1107,30 @@ static void bitbang_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay
 static int bitbang_swd_run_queue(void)
 {
 	LOG_DEBUG("bitbang_swd_run_queue");
+	struct bitbang_bridge *b = bitbang_swd_bridge();
+
+	if (b == NULL) {
+		LOG_ERROR("SWD needs a serial bridge");
+		return ERROR_FAIL;
+	}
+
 	/* A transaction must be followed by another transaction or at least 8 idle cycles to
 	 * ensure that data is clocked through the AP. */
-	bitbang_exchange(true, NULL, 0, 8);
+	bitbang_exchange(b, true, NULL, 0, 8);
 
-	int retval = queued_retval;
-	queued_retval = ERROR_OK;
+	int retval = b->queued_retval;
+	b->queued_retval = ERROR_OK;
 	LOG_DEBUG("SWD queue return value: %02x", retval);
+
+	if (b->queued_transactions) {
+		LOG_DEBUG("SWD queue: %u transactions, %u WAIT retries (at most %u in one)",
+			  b->queued_transactions, b->queued_waits,
+			  b->queued_max_waits);
+		b->queued_transactions = 0;
+		b->queued_waits = 0;
+		b->queued_max_waits = 0;
+	}
+
 	return retval;
 }
 
@@ -24,6 +24,32 @@
 
 #include <jtag/swd.h>
 
+/*
+ * State of one serial SWD/JTAG bridge.  Every adapter instance that talks
+ * through a bridge owns one and points its bitbang_interface at it.
+ */
+struct bitbang_bridge {
+	char *port;
+	int baudrate;
+	int fd;
+	/* JTAG shifts of bitbang_execute_queue() go through the bridge */
+	bool jtag;
+	int queued_retval;
+	/* WAIT retries the bridge does on its own, 0 to retry from the host */
+	unsigned int swd_retry;
+	/* SWD transactions and WAIT retries since the last queue run */
+	unsigned int queued_transactions;
+	unsigned int queued_waits;
+	unsigned int queued_max_waits;
+	/* frame and reply buffers, grown to the largest transfer so far */
+	char *tx_buf;
+	size_t tx_size;
+	uint8_t *rx_buf;
+	size_t rx_size;
+};
+
+#define BITBANG_BRIDGE_INIT { .baudrate = 115200, .fd = -1 }
+
 struct bitbang_interface {
 	/* low level callbacks (for bitbang)
 	 */
@@ -33,6 +59,8 @@ struct bitbang_interface {
 	void (*blink)(int on);
 	int (*swdio_read)(void);
 	void (*swdio_drive)(bool on);
+	/* serial bridge carrying SWD (and JTAG without pins), NULL if none */
+	struct bitbang_bridge *bridge;
 };
 
 const struct swd_driver bitbang_swd;
@@ -45,4 +73,20 @@ extern struct bitbang_interface *bitbang_interface;
 void bitbang_switch_to_swd(void);
 int bitbang_swd_switch_seq(enum swd_special_seq seq);
 
+#define BITBANG_BRIDGE_DEFAULT_PORT "/dev/ttyACM0"
+
+/* serial bridge configuration, must be set before the bridge is opened */
+int bitbang_bridge_set_port(struct bitbang_bridge *b, const char *port);
+const char *bitbang_bridge_get_port(struct bitbang_bridge *b);
+int bitbang_bridge_set_baudrate(struct bitbang_bridge *b, int baudrate);
+int bitbang_bridge_get_baudrate(struct bitbang_bridge *b);
+/* let the bridge retry SWD WAIT responses up to retry times, 0 retries on the host */
+int bitbang_bridge_set_swd_retry(struct bitbang_bridge *b, unsigned int retry);
+unsigned int bitbang_bridge_get_swd_retry(struct bitbang_bridge *b);
+
+/* open the bridge; outside SWD mode all JTAG shifts of
+ * bitbang_execute_queue() are routed through it */
+int bitbang_bridge_init(struct bitbang_bridge *b);
+void bitbang_bridge_close(struct bitbang_bridge *b);
+
 #endif /* OPENOCD_JTAG_DRIVERS_BITBANG_H */
@@ -23,6 +23,7 @@
 
 #include <jtag/interface.h>
 #include <jtag/commands.h>
+#include <jtag/swd.h>
 
 #include <termios.h>
 #include <fcntl.h>
@@ -52,6 +53,28 @@ static void buspirate_stableclocks(int num_cycles);
 #define CMD_UART_SPEED    0x07
 #define CMD_JTAG_SPEED    0x08
 
+/* binary mode entry for raw-wire, used for SWD; answers "RAW1" */
+#define CMD_RAW_ENTER     0x05
+
+/* raw-wire mode commands, each byte sent is answered by one byte */
+#define CMD_RAW_READ_BYTE  0x06
+#define CMD_RAW_READ_BIT   0x07
+#define CMD_RAW_CLOCK_TICK 0x09
+#define CMD_RAW_BULK_WRITE 0x10	/* | (bytes - 1), 1 to 16 bytes follow */
+#define CMD_RAW_BULK_CLOCK 0x20	/* | (ticks - 1), 1 to 16 ticks */
+#define CMD_RAW_PERIPH     0x40
+#define CMD_RAW_SPEED      0x60
+#define CMD_RAW_CONFIG     0x80
+
+#define RAW_PERIPH_POWER   0x08
+#define RAW_PERIPH_PULLUP  0x04
+#define RAW_PERIPH_AUX     0x02	/* SRST */
+
+#define RAW_SPEED_400KHZ   0x03
+
+#define RAW_CONFIG_3V3     0x08
+#define RAW_CONFIG_LSB     0x02
+
 /* Not all OSes have this speed defined */
 #if !defined(B1000000)
 #define  B1000000 0010010
@@ -87,6 +110,10 @@ static const cc_t NORMAL_TIMEOUT = 10;
 static int buspirate_fd = -1;
 static int buspirate_pinmode = MODE_JTAG_OD;
 static int buspirate_baudrate = SERIAL_NORMAL;
+static bool buspirate_baudrate_auto;
+static bool buspirate_pipeline = true;
+static bool buspirate_swd_mode;
+static uint8_t buspirate_swd_periph;
 static int buspirate_vreg;
 static int buspirate_pullup;
 static char *buspirate_port;
@@ -101,6 +128,8 @@ static void buspirate_tap_append(int tms, int tdi);
 static void buspirate_tap_append_scan(int length, uint8_t *buffer,
 		struct scan_command *command);
 static void buspirate_tap_make_space(int scan, int bits);
+static int buspirate_tap_send(void);
+static int buspirate_tap_receive(void);
 
 static void buspirate_reset(int trst, int srst);
 
@@ -109,10 +138,22 @@ static void buspirate_jtag_reset(int);
 static void buspirate_jtag_enable(int);
 static unsigned char buspirate_jtag_command(int, char *, int);
 static void buspirate_jtag_set_speed(int, char);
+static int buspirate_jtag_try_speed(int, char);
+static void buspirate_jtag_detect_speed(int);
 static void buspirate_jtag_set_mode(int, char);
 static void buspirate_jtag_set_feature(int, char, char);
 static void buspirate_jtag_get_adcs(int);
 
+/* SWD (raw-wire mode) */
+static int buspirate_swd_init(void);
+static int buspirate_swd_switch_seq(enum swd_special_seq seq);
+static void buspirate_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk);
+static void buspirate_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk);
+static int buspirate_swd_run_queue(void);
+static void buspirate_swd_queue_init(void);
+static int buspirate_swd_command(int fd, uint8_t cmd);
+static void buspirate_swd_set_feature(int fd, char feat, char action);
+
 /* low level HW communication interface */
 static int buspirate_serial_open(char *port);
 static int buspirate_serial_setspeed(int fd, char speed, cc_t timeout);
@@ -128,6 +169,8 @@ static int buspirate_execute_queue(void)
 	int scan_size;
 	enum scan_type type;
 	uint8_t *buffer;
+	int retval = ERROR_OK;
+	int ret;
 
 	while (cmd) {
 		switch (cmd->type) {
@@ -178,8 +221,10 @@ static int buspirate_execute_queue(void)
 			DEBUG_JTAG_IO("reset trst: %i srst %i",
 				cmd->cmd.reset->trst, cmd->cmd.reset->srst);
 
-			/* flush buffers, so we can reset */
-			buspirate_tap_execute();
+			/* flush buffers, so we can reset; errors are kept for the end */
+			ret = buspirate_tap_execute();
+			if (retval == ERROR_OK)
+				retval = ret;
 
 			if (cmd->cmd.reset->trst == 1)
 				tap_set_state(TAP_RESET);
@@ -188,7 +233,9 @@ static int buspirate_execute_queue(void)
 			break;
 		case JTAG_SLEEP:
 			DEBUG_JTAG_IO("sleep %i", cmd->cmd.sleep->us);
-			buspirate_tap_execute();
+			ret = buspirate_tap_execute();
+			if (retval == ERROR_OK)
+				retval = ret;
 			jtag_sleep(cmd->cmd.sleep->us);
 				break;
 		case JTAG_STABLECLOCKS:
@@ -203,7 +250,11 @@ static int buspirate_execute_queue(void)
 		cmd = cmd->next;
 	}
 
-	return buspirate_tap_execute();
+	ret = buspirate_tap_execute();
+	if (retval == ERROR_OK)
+		retval = ret;
+
+	return retval;
 }
 
 
@@ -297,13 +348,23 @@ static int buspirate_init(void)
 
 	buspirate_jtag_enable(buspirate_fd);
 
-	if (buspirate_baudrate != SERIAL_NORMAL)
+	if (buspirate_swd_mode) {
+		/* the raw-wire binary mode has no UART speed command */
+		if (buspirate_baudrate != SERIAL_NORMAL || buspirate_baudrate_auto)
+			LOG_WARNING("Buspirate UART speed is fixed to normal in SWD mode");
+	} else if (buspirate_baudrate_auto)
+		buspirate_jtag_detect_speed(buspirate_fd);
+	else if (buspirate_baudrate != SERIAL_NORMAL)
 		buspirate_jtag_set_speed(buspirate_fd, SERIAL_FAST);
 
 	LOG_INFO("Buspirate Interface ready!");
 
 	buspirate_tap_init();
+	buspirate_swd_queue_init();
 	buspirate_jtag_set_mode(buspirate_fd, buspirate_pinmode);
+	if (buspirate_swd_mode
+			&& buspirate_swd_command(buspirate_fd, CMD_RAW_SPEED | RAW_SPEED_400KHZ) != ERROR_OK)
+		return ERROR_JTAG_INIT_FAILED;
 	buspirate_jtag_set_feature(buspirate_fd, FEATURE_VREG,
 		(buspirate_vreg == 1) ? ACTION_ENABLE : ACTION_DISABLE);
 	buspirate_jtag_set_feature(buspirate_fd, FEATURE_PULLUP,
@@ -318,7 +379,8 @@ static int buspirate_quit(void)
 	LOG_INFO("Shutting down buspirate.");
 	buspirate_jtag_set_mode(buspirate_fd, MODE_HIZ);
 
-	buspirate_jtag_set_speed(buspirate_fd, SERIAL_NORMAL);
+	if (!buspirate_swd_mode)
+		buspirate_jtag_set_speed(buspirate_fd, SERIAL_NORMAL);
 	buspirate_jtag_reset(buspirate_fd);
 
 	buspirate_serial_close(buspirate_fd);
@@ -417,12 +479,31 @@ COMMAND_HANDLER(buspirate_handle_speed_command)
 	if (CMD_ARGC < 1)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
+	buspirate_baudrate_auto = false;
 	if (CMD_ARGV[0][0] == 'n')
 		buspirate_baudrate = SERIAL_NORMAL;
 	else if (CMD_ARGV[0][0] == 'f')
 		buspirate_baudrate = SERIAL_FAST;
+	else if (CMD_ARGV[0][0] == 'a')
+		buspirate_baudrate_auto = true;
 	else
-		LOG_ERROR("usage: buspirate_speed <normal|fast>");
+		LOG_ERROR("usage: buspirate_speed <normal|fast|auto>");
+
+	return ERROR_OK;
+
+}
+
+COMMAND_HANDLER(buspirate_handle_pipeline_command)
+{
+	if (CMD_ARGC < 1)
+		return ERROR_COMMAND_SYNTAX_ERROR;
+
+	if (atoi(CMD_ARGV[0]) == 1)
+		buspirate_pipeline = true;
+	else if (atoi(CMD_ARGV[0]) == 0)
+		buspirate_pipeline = false;
+	else
+		LOG_ERROR("usage: buspirate_pipeline <1|0>");
 
 	return ERROR_OK;
 
@@ -470,10 +551,17 @@ static const struct command_registration buspirate_command_handlers[] = {
 	},
 	{
 		.name = "buspirate_speed",
-		.usage = "<normal|fast>",
+		.usage = "<normal|fast|auto>",
 		.handler = &buspirate_handle_speed_command,
 		.mode = COMMAND_CONFIG,
-		.help = "speed of the interface",
+		.help = "speed of the interface, auto picks the fastest stable one",
+	},
+	{
+		.name = "buspirate_pipeline",
+		.usage = "<1|0>",
+		.handler = &buspirate_handle_pipeline_command,
+		.mode = COMMAND_CONFIG,
+		.help = "keep one JTAG shift in flight while the next is built",
 	},
 	{
 		.name = "buspirate_mode",
@@ -492,10 +580,22 @@ static const struct command_registration buspirate_command_handlers[] = {
 	COMMAND_REGISTRATION_DONE
 };
 
+static const struct swd_driver buspirate_swd = {
+	.init = buspirate_swd_init,
+	.switch_seq = buspirate_swd_switch_seq,
+	.read_reg = buspirate_swd_read_reg,
+	.write_reg = buspirate_swd_write_reg,
+	.run = buspirate_swd_run_queue,
+};
+
+static const char * const buspirate_transports[] = { "jtag", "swd", NULL };
+
 struct jtag_interface buspirate_interface = {
 	.name = "buspirate",
 	.execute_queue = buspirate_execute_queue,
 	.commands = buspirate_command_handlers,
+	.transports = buspirate_transports,
+	.swd = &buspirate_swd,
 	.init = buspirate_init,
 	.quit = buspirate_quit
 };
@@ -649,18 +749,30 @@ static struct pending_scan_result
 tap_pending_scans[BUSPIRATE_MAX_PENDING_SCANS];
 static int tap_pending_scans_num;
 
+/* With buspirate_pipeline, the previous CMD_TAP_SHIFT is only answered
+   while the next one is being built, so the serial round trip overlaps with
+   the queue processing instead of stalling it for every full chain.
+   Only one shift is in flight at a time: the Bus Pirate firmware buffers a
+   single command, and reading the answer before sending the next shift
+   keeps it from being overrun. */
+static struct pending_scan_result
+tap_inflight_scans[BUSPIRATE_MAX_PENDING_SCANS];
+static int tap_inflight_scans_num;
+static int tap_inflight_bytes; /* TDO bytes expected, 0 if nothing in flight */
+static int tap_queued_retval = ERROR_OK;
+
+static const int CMD_TAP_SHIFT_HEADER_LEN = 3;
+
 static void buspirate_tap_init(void)
 {
 	tap_chain_index = 0;
 	tap_pending_scans_num = 0;
 }
 
-static int buspirate_tap_execute(void)
+/* send the chain built so far, its scans now wait in tap_inflight_scans */
+static int buspirate_tap_send(void)
 {
-	static const int CMD_TAP_SHIFT_HEADER_LEN = 3;
-
 	char tmp[4096];
-	uint8_t *in_buf;
 	int i;
 	int fill_index = 0;
 	int ret;
@@ -694,48 +806,108 @@ static int buspirate_tap_execute(void)
 												  tap_chain_index, last_tap_state);
 	}
 
+	memcpy(tap_inflight_scans, tap_pending_scans,
+			tap_pending_scans_num * sizeof(*tap_pending_scans));
+	tap_inflight_scans_num = tap_pending_scans_num;
+	tap_inflight_bytes = bytes_to_send;
+	buspirate_tap_init();
+
 	ret = buspirate_serial_write(buspirate_fd, tmp, CMD_TAP_SHIFT_HEADER_LEN + bytes_to_send*2);
 	if (ret != bytes_to_send*2+CMD_TAP_SHIFT_HEADER_LEN) {
 		LOG_ERROR("error writing :(");
 		return ERROR_JTAG_DEVICE_ERROR;
 	}
 
-	ret = buspirate_serial_read(buspirate_fd, tmp, bytes_to_send + CMD_TAP_SHIFT_HEADER_LEN);
-	if (ret != bytes_to_send + CMD_TAP_SHIFT_HEADER_LEN) {
+	return ERROR_OK;
+}
+
+/* wait for the answer to the shift in flight and hand out its scans */
+static int buspirate_tap_receive(void)
+{
+	char tmp[4096];
+	uint8_t *in_buf;
+	int i;
+	int ret;
+	int retval = ERROR_OK;
+	int bytes = tap_inflight_bytes;
+
+	if (bytes <= 0)
+		return ERROR_OK;
+	tap_inflight_bytes = 0;
+
+	ret = buspirate_serial_read(buspirate_fd, tmp, bytes + CMD_TAP_SHIFT_HEADER_LEN);
+	if (ret != bytes + CMD_TAP_SHIFT_HEADER_LEN) {
 		LOG_ERROR("error reading");
-		return ERROR_FAIL;
+		retval = ERROR_FAIL;
 	}
 	in_buf = (uint8_t *)(&tmp[CMD_TAP_SHIFT_HEADER_LEN]);
 
 	/* parse the scans */
-	for (i = 0; i < tap_pending_scans_num; i++) {
-		uint8_t *buffer = tap_pending_scans[i].buffer;
-		int length = tap_pending_scans[i].length;
-		int first = tap_pending_scans[i].first;
-		struct scan_command *command = tap_pending_scans[i].command;
-
-		/* copy bits from buffer */
-		buf_set_buf(in_buf, first, buffer, 0, length);
-
-		/* return buffer to higher level */
-		if (jtag_read_buffer(buffer, command) != ERROR_OK) {
-			buspirate_tap_init();
-			return ERROR_JTAG_QUEUE_FAILED;
+	for (i = 0; i < tap_inflight_scans_num; i++) {
+		uint8_t *buffer = tap_inflight_scans[i].buffer;
+		int length = tap_inflight_scans[i].length;
+		int first = tap_inflight_scans[i].first;
+		struct scan_command *command = tap_inflight_scans[i].command;
+
+		if (retval == ERROR_OK) {
+			/* copy bits from buffer */
+			buf_set_buf(in_buf, first, buffer, 0, length);
+
+			/* return buffer to higher level */
+			if (jtag_read_buffer(buffer, command) != ERROR_OK)
+				retval = ERROR_JTAG_QUEUE_FAILED;
 		}
 
 		free(buffer);
 	}
-	buspirate_tap_init();
-	return ERROR_OK;
+	tap_inflight_scans_num = 0;
+
+	return retval;
+}
+
+static int buspirate_tap_execute(void)
+{
+	int retval = tap_queued_retval;
+	int ret;
+
+	tap_queued_retval = ERROR_OK;
+
+	ret = buspirate_tap_receive();
+	if (retval == ERROR_OK)
+		retval = ret;
+
+	ret = buspirate_tap_send();
+	if (retval == ERROR_OK)
+		retval = ret;
+
+	ret = buspirate_tap_receive();
+	if (retval == ERROR_OK)
+		retval = ret;
+
+	return retval;
 }
 
 static void buspirate_tap_make_space(int scans, int bits)
 {
 	int have_scans = BUSPIRATE_MAX_PENDING_SCANS - tap_pending_scans_num;
 	int have_bits = BUSPIRATE_BUFFER_SIZE * 8 - tap_chain_index;
+	int ret;
+
+	if ((have_scans >= scans) && (have_bits >= bits))
+		return;
+
+	if (!buspirate_pipeline) {
+		ret = buspirate_tap_execute();
+	} else {
+		/* finish the previous shift, then leave this one in flight */
+		ret = buspirate_tap_receive();
+		int send_ret = buspirate_tap_send();
+		if (ret == ERROR_OK)
+			ret = send_ret;
+	}
 
-	if ((have_scans < scans) || (have_bits < bits))
-		buspirate_tap_execute();
+	if (tap_queued_retval == ERROR_OK)
+		tap_queued_retval = ret;
 }
 
 static void buspirate_tap_append(int tms, int tdi)
@@ -828,12 +1000,13 @@ static void buspirate_jtag_enable(int fd)
 	char tmp[21] = { [0 ... 20] = 0x00 };
 	int done = 0;
 	int cmd_sent = 0;
+	const char *mode_id = buspirate_swd_mode ? "RAW1" : "OCD1";
 
 	LOG_DEBUG("Entering binary mode");
 	buspirate_serial_write(fd, tmp, 20);
 	usleep(10000);
 
-	/* reads 1 to n "BBIO1"s and one "OCD1" */
+	/* reads 1 to n "BBIO1"s and one "OCD1" (or "RAW1" for SWD) */
 	while (!done) {
 		ret = buspirate_serial_read(fd, tmp, 4);
 		if (ret != 4) {
@@ -854,14 +1027,14 @@ static void buspirate_jtag_enable(int fd)
 			}
 			if (cmd_sent == 0) {
 				cmd_sent = 1;
-				tmp[0] = CMD_ENTER_OOCD;
+				tmp[0] = buspirate_swd_mode ? CMD_RAW_ENTER : CMD_ENTER_OOCD;
 				ret = buspirate_serial_write(fd, tmp, 1);
 				if (ret != 1) {
 					LOG_ERROR("error reading");
 					exit(-1);
 				}
 			}
-		} else if (strncmp(tmp, "OCD1", 4) == 0)
+		} else if (strncmp(tmp, mode_id, 4) == 0)
 			done = 1;
 		else {
 			LOG_ERROR("Buspirate did not answer correctly! "
@@ -888,7 +1061,7 @@ static void buspirate_jtag_reset(int fd)
 		LOG_ERROR("Unable to restart buspirate!");
 }
 
-static void buspirate_jtag_set_speed(int fd, char speed)
+static int buspirate_jtag_try_speed(int fd, char speed)
 {
 	int ret;
 	char tmp[2];
@@ -911,20 +1084,92 @@ static void buspirate_jtag_set_speed(int fd, char speed)
 	ret = buspirate_serial_read(fd, tmp, 2);
 	if (ret != 2) {
 		LOG_ERROR("Buspirate did not ack speed change");
-		exit(-1);
+		return ERROR_FAIL;
 	}
 	if ((tmp[0] != CMD_UART_SPEED) || (tmp[1] != speed)) {
 		LOG_ERROR("Buspirate did not reply as expected to the speed change command");
-		exit(-1);
+		return ERROR_FAIL;
 	}
 	LOG_INFO("Buspirate switched to %s mode",
 		(speed == SERIAL_NORMAL) ? "normal" : "FAST");
+	return ERROR_OK;
+}
+
+static void buspirate_jtag_set_speed(int fd, char speed)
+{
+	if (buspirate_jtag_try_speed(fd, speed) != ERROR_OK)
+		exit(-1);
+}
+
+/* Number of back to back ADC reads that must come through intact before
+   the FAST UART speed is trusted. */
+#define BUSPIRATE_SPEED_PROBES 16
+
+/* Sends a burst of CMD_READ_ADCS at once, so the link is loaded in both
+   directions the way long CMD_TAP_SHIFTs load it. */
+static int buspirate_jtag_probe_link(int fd)
+{
+	char tmp[BUSPIRATE_SPEED_PROBES * 10];
+	int i;
+
+	memset(tmp, CMD_READ_ADCS, BUSPIRATE_SPEED_PROBES);
+	if (buspirate_serial_write(fd, tmp, BUSPIRATE_SPEED_PROBES) != BUSPIRATE_SPEED_PROBES)
+		return ERROR_FAIL;
+
+	if (buspirate_serial_read(fd, tmp, sizeof(tmp)) != (int)sizeof(tmp))
+		return ERROR_FAIL;
+
+	for (i = 0; i < BUSPIRATE_SPEED_PROBES; i++) {
+		if (tmp[i * 10] != CMD_READ_ADCS)
+			return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+/* Use the FAST UART speed if the link survives it, else stay at normal. */
+static void buspirate_jtag_detect_speed(int fd)
+{
+	if (buspirate_jtag_try_speed(fd, SERIAL_FAST) == ERROR_OK) {
+		if (buspirate_jtag_probe_link(fd) == ERROR_OK) {
+			buspirate_baudrate = SERIAL_FAST;
+			return;
+		}
+
+		LOG_WARNING("Buspirate link is not stable in FAST mode, falling back to normal");
+		read_and_discard_all_data(fd);
+		if (buspirate_jtag_try_speed(fd, SERIAL_NORMAL) == ERROR_OK) {
+			buspirate_baudrate = SERIAL_NORMAL;
+			return;
+		}
+	}
+
+	/* the adapter drops back to normal speed after a failed handshake */
+	if (-1 == buspirate_serial_setspeed(fd, SERIAL_NORMAL, SHORT_TIMEOUT)
+			|| !read_and_discard_all_data(fd)
+			|| -1 == buspirate_serial_setspeed(fd, SERIAL_NORMAL, NORMAL_TIMEOUT)) {
+		LOG_ERROR("Error configuring the serial port.");
+		exit(-1);
+	}
+	buspirate_baudrate = SERIAL_NORMAL;
+	LOG_INFO("Buspirate stays in normal mode");
 }
 
 
 static void buspirate_jtag_set_mode(int fd, char mode)
 {
 	char tmp[2];
+
+	if (buspirate_swd_mode) {
+		/* 2-wire, LSB first; SWDIO is the MOSI pin */
+		if (mode == MODE_HIZ)
+			buspirate_swd_command(fd, CMD_RAW_PERIPH);
+		else
+			buspirate_swd_command(fd, CMD_RAW_CONFIG | RAW_CONFIG_LSB
+					| (mode == MODE_JTAG ? RAW_CONFIG_3V3 : 0));
+		return;
+	}
+
 	tmp[0] = CMD_PORT_MODE;
 	tmp[1] = mode;
 	buspirate_jtag_command(fd, tmp, 2);
@@ -933,6 +1178,12 @@ static void buspirate_jtag_set_mode(int fd, char mode)
 static void buspirate_jtag_set_feature(int fd, char feat, char action)
 {
 	char tmp[3];
+
+	if (buspirate_swd_mode) {
+		buspirate_swd_set_feature(fd, feat, action);
+		return;
+	}
+
 	tmp[0] = CMD_FEATURE;
 	tmp[1] = feat;   /* what */
 	tmp[2] = action; /* action */
@@ -943,6 +1194,12 @@ static void buspirate_jtag_get_adcs(int fd)
 {
 	uint8_t tmp[10];
 	uint16_t a, b, c, d;
+
+	if (buspirate_swd_mode) {
+		LOG_ERROR("Buspirate ADC reading is not available in SWD mode");
+		return;
+	}
+
 	tmp[0] = CMD_READ_ADCS;
 	buspirate_jtag_command(fd, (char *)tmp, 1);
 	a = tmp[2] << 8 | tmp[3];
@@ -991,6 +1248,288 @@ static unsigned char buspirate_jtag_command(int fd,
 	return 0;
 }
 
+/*************** swd lowlevel functions ********************/
+
+/* In raw-wire mode every command byte, including the data bytes of a bulk
+   write, is answered by exactly one byte once it has been clocked out.  SWD
+   transactions are therefore queued as one byte stream, sent with a single
+   write and answered by a single read of the same length, instead of one
+   round trip per transaction.  AP accesses after a WAIT or FAULT still get
+   their full data phase, which is what the ORUNDETECT bit set by the DAP
+   code expects. */
+
+#define BUSPIRATE_SWD_BUFFER_SIZE   2048
+#define BUSPIRATE_SWD_MAX_PENDING   128
+
+/* request + trn + ack, then trn + 4 data bytes + parity/idle byte */
+#define BUSPIRATE_SWD_WRITE_LEN     13
+/* request + trn + ack, then 4 data bytes + parity + trn + 8 idle cycles */
+#define BUSPIRATE_SWD_READ_LEN      14
+
+static uint8_t swd_cmd_buf[BUSPIRATE_SWD_BUFFER_SIZE];
+static int swd_cmd_len;
+static int swd_queued_retval = ERROR_OK;
+
+struct pending_swd_result {
+	int offset;      /* of the request in swd_cmd_buf */
+	uint32_t *dst;   /* NULL for writes */
+};
+
+static struct pending_swd_result swd_pending[BUSPIRATE_SWD_MAX_PENDING];
+static int swd_pending_num;
+
+static void buspirate_swd_queue_init(void)
+{
+	swd_cmd_len = 0;
+	swd_pending_num = 0;
+}
+
+/* send a single raw-wire setup command and check its 0x01 answer */
+static int buspirate_swd_command(int fd, uint8_t cmd)
+{
+	char tmp = cmd;
+
+	if (buspirate_serial_write(fd, &tmp, 1) != 1)
+		return ERROR_FAIL;
+	if (buspirate_serial_read(fd, &tmp, 1) != 1 || tmp != 0x01) {
+		LOG_ERROR("Buspirate did not accept raw-wire command 0x%02x", cmd);
+		return ERROR_FAIL;
+	}
+
+	return ERROR_OK;
+}
+
+static void buspirate_swd_set_feature(int fd, char feat, char action)
+{
+	uint8_t bit;
+
+	switch (feat) {
+	case FEATURE_VREG:
+		bit = RAW_PERIPH_POWER;
+		break;
+	case FEATURE_PULLUP:
+		bit = RAW_PERIPH_PULLUP;
+		break;
+	case FEATURE_SRST:
+		bit = RAW_PERIPH_AUX;
+		break;
+	case FEATURE_TRST:
+		/* no TRST in SWD */
+		return;
+	default:
+		LOG_ERROR("Buspirate feature %d not available in SWD mode", feat);
+		return;
+	}
+
+	if (action == ACTION_ENABLE)
+		buspirate_swd_periph |= bit;
+	else
+		buspirate_swd_periph &= ~bit;
+
+	buspirate_swd_command(fd, CMD_RAW_PERIPH | buspirate_swd_periph);
+}
+
+static void buspirate_swd_queue_byte(uint8_t byte)
+{
+	swd_cmd_buf[swd_cmd_len++] = byte;
+}
+
+/* queue a bulk write of up to 16 bytes, LSB first on the wire */
+static void buspirate_swd_queue_bulk(const uint8_t *data, int len)
+{
+	buspirate_swd_queue_byte(CMD_RAW_BULK_WRITE | (len - 1));
+	memcpy(swd_cmd_buf + swd_cmd_len, data, len);
+	swd_cmd_len += len;
+}
+
+static void buspirate_swd_queue_idle(uint32_t clocks)
+{
+	while (clocks) {
+		uint32_t n = MIN(clocks, 16);
+		buspirate_swd_queue_byte(CMD_RAW_BULK_CLOCK | (n - 1));
+		clocks -= n;
+	}
+}
+
+static int buspirate_swd_init(void)
+{
+	LOG_DEBUG("Buspirate SWD mode enabled");
+	buspirate_swd_mode = true;
+
+	return ERROR_OK;
+}
+
+static int buspirate_swd_switch_seq(enum swd_special_seq seq)
+{
+	const uint8_t *s;
+	unsigned int s_len;
+	uint8_t tmp[16];
+
+	switch (seq) {
+	case LINE_RESET:
+		LOG_DEBUG("SWD line reset");
+		s = swd_seq_line_reset;
+		s_len = swd_seq_line_reset_len;
+		break;
+	case JTAG_TO_SWD:
+		LOG_DEBUG("JTAG-to-SWD");
+		s = swd_seq_jtag_to_swd;
+		s_len = swd_seq_jtag_to_swd_len;
+		break;
+	case SWD_TO_JTAG:
+		LOG_DEBUG("SWD-to-JTAG");
+		s = swd_seq_swd_to_jtag;
+		s_len = swd_seq_swd_to_jtag_len;
+		break;
+	default:
+		LOG_ERROR("Sequence %d not supported", seq);
+		return ERROR_FAIL;
+	}
+
+	/* bulk writes are whole bytes: pad the last one by repeating the final
+	   bit, which leaves the line in the state the sequence ends in */
+	unsigned int bytes = DIV_ROUND_UP(s_len, 8);
+	if (swd_cmd_len + bytes + DIV_ROUND_UP(bytes, 16) > BUSPIRATE_SWD_BUFFER_SIZE)
+		swd_queued_retval = buspirate_swd_run_queue();
+
+	for (unsigned int i = 0; i < bytes; i += 16) {
+		unsigned int n = MIN(bytes - i, 16u);
+		memcpy(tmp, s + i, n);
+		if (i + n == bytes && s_len % 8) {
+			uint8_t last = (s[bytes - 1] >> (s_len % 8 - 1)) & 1;
+			uint8_t pad = 0xff << (s_len % 8);
+			tmp[n - 1] = (tmp[n - 1] & ~pad) | (last ? pad : 0);
+		}
+		buspirate_swd_queue_bulk(tmp, n);
+	}
+
+	return ERROR_OK;
+}
+
+static void buspirate_swd_queue_cmd(uint8_t cmd, uint32_t *dst, uint32_t data, uint32_t ap_delay_clk)
+{
+	uint32_t idle = (cmd & SWD_CMD_APnDP) ? ap_delay_clk : 0;
+	int len = MAX(BUSPIRATE_SWD_READ_LEN, BUSPIRATE_SWD_WRITE_LEN) + DIV_ROUND_UP(idle, 16);
+
+	if (swd_cmd_len + len > BUSPIRATE_SWD_BUFFER_SIZE
+			|| swd_pending_num == BUSPIRATE_SWD_MAX_PENDING) {
+		/* Not enough room in the queue. Run the queue. */
+		swd_queued_retval = buspirate_swd_run_queue();
+	}
+
+	if (swd_queued_retval != ERROR_OK)
+		return;
+
+	cmd |= SWD_CMD_START | SWD_CMD_PARK;
+
+	swd_pending[swd_pending_num].offset = swd_cmd_len;
+	swd_pending[swd_pending_num].dst = dst;
+	swd_pending_num++;
+
+	buspirate_swd_queue_bulk(&cmd, 1);
+
+	/* turnaround and the three ack bits, the target drives the line */
+	for (int i = 0; i < 4; i++)
+		buspirate_swd_queue_byte(CMD_RAW_READ_BIT);
+
+	if (cmd & SWD_CMD_RnW) {
+		for (int i = 0; i < 4; i++)
+			buspirate_swd_queue_byte(CMD_RAW_READ_BYTE);
+		buspirate_swd_queue_byte(CMD_RAW_READ_BIT);	/* parity */
+		buspirate_swd_queue_byte(CMD_RAW_CLOCK_TICK);	/* turnaround */
+		uint8_t zero = 0;
+		buspirate_swd_queue_bulk(&zero, 1);		/* idle, line driven low */
+	} else {
+		uint8_t buf[5];
+
+		buspirate_swd_queue_byte(CMD_RAW_READ_BIT);	/* turnaround */
+		buf_set_u32(buf, 0, 32, data);
+		/* the seven bits after the parity bit are idle cycles */
+		buf[4] = parity_u32(data);
+		buspirate_swd_queue_bulk(buf, 5);
+	}
+
+	/* Insert idle cycles after AP accesses to avoid WAIT. */
+	buspirate_swd_queue_idle(idle);
+}
+
+static void buspirate_swd_read_reg(uint8_t cmd, uint32_t *value, uint32_t ap_delay_clk)
+{
+	assert(cmd & SWD_CMD_RnW);
+	buspirate_swd_queue_cmd(cmd, value, 0, ap_delay_clk);
+}
+
+static void buspirate_swd_write_reg(uint8_t cmd, uint32_t value, uint32_t ap_delay_clk)
+{
+	assert(!(cmd & SWD_CMD_RnW));
+	buspirate_swd_queue_cmd(cmd, NULL, value, ap_delay_clk);
+}
+
+static int buspirate_swd_run_queue(void)
+{
+	static uint8_t reply[BUSPIRATE_SWD_BUFFER_SIZE];
+	int ret;
+
+	LOG_DEBUG("Executing %d queued transactions, %d bytes", swd_pending_num, swd_cmd_len);
+
+	if (swd_queued_retval != ERROR_OK) {
+		LOG_DEBUG("Skipping due to previous errors: %d", swd_queued_retval);
+		goto skip;
+	}
+
+	if (swd_cmd_len == 0)
+		goto skip;
+
+	/* A transaction must be followed by another transaction or at least 8 idle
+	   cycles to ensure that data is clocked through the AP; reads and writes
+	   already end with them. */
+
+	ret = buspirate_serial_write(buspirate_fd, (char *)swd_cmd_buf, swd_cmd_len);
+	if (ret != swd_cmd_len) {
+		swd_queued_retval = ERROR_JTAG_DEVICE_ERROR;
+		goto skip;
+	}
+
+	ret = buspirate_serial_read(buspirate_fd, (char *)reply, swd_cmd_len);
+	if (ret != swd_cmd_len) {
+		swd_queued_retval = ERROR_FAIL;
+		goto skip;
+	}
+
+	for (int i = 0; i < swd_pending_num; i++) {
+		/* the bulk write answers 0x01 and one byte, then trn and ack bits */
+		const uint8_t *r = reply + swd_pending[i].offset + 3;
+		int ack = (r[0] & 1) | (r[1] & 1) << 1 | (r[2] & 1) << 2;
+
+		if (ack != SWD_ACK_OK) {
+			LOG_DEBUG("SWD ack not OK: %d %s", ack,
+				  ack == SWD_ACK_WAIT ? "WAIT" : ack == SWD_ACK_FAULT ? "FAULT" : "JUNK");
+			swd_queued_retval = ack == SWD_ACK_WAIT ? ERROR_WAIT : ERROR_FAIL;
+			goto skip;
+		}
+
+		if (swd_pending[i].dst) {
+			uint32_t data = le_to_h_u32(r + 3);
+			int parity = r[7] & 1;
+
+			if (parity != parity_u32(data)) {
+				LOG_ERROR("SWD: Read data parity mismatch.");
+				swd_queued_retval = ERROR_FAIL;
+				goto skip;
+			}
+
+			*swd_pending[i].dst = data;
+		}
+	}
+
+skip:
+	buspirate_swd_queue_init();
+	ret = swd_queued_retval;
+	swd_queued_retval = ERROR_OK;
+
+	return ret;
+}
+
 /* low level serial port */
 /* TODO add support for WIN32 and others ! */
 static int buspirate_serial_open(char *port)
@@ -35,6 +35,7 @@
 #include <jtag/commands.h>
 #include <jtag/minidriver.h>
 #include <helper/command.h>
+#include <helper/perf.h>
 
 struct jtag_callback_entry {
 	struct jtag_callback_entry *next;
@@ -120,6 +121,8 @@ int interface_jtag_add_ir_scan(struct jtag_tap *active,
 	/* paranoia: jtag_tap_count_enabled() and jtag_tap_next_enabled() not in sync */
 	assert(field == out_fields + num_taps);
 
+	perf_count(PERF_JTAG_SCAN_BITS, jtag_scan_size(scan));
+
 	return ERROR_OK;
 }
 
@@ -188,6 +191,8 @@ int interface_jtag_add_dr_scan(struct jtag_tap *active, int in_num_fields,
 
 	assert(field == out_fields + scan->num_fields); /* no superfluous input fields permitted */
 
+	perf_count(PERF_JTAG_SCAN_BITS, jtag_scan_size(scan));
+
 	return ERROR_OK;
 }
 
@@ -212,6 +217,8 @@ static int jtag_add_plain_scan(int num_bits, const uint8_t *out_bits,
 	out_fields->out_value = buf_cpy(out_bits, cmd_queue_alloc(DIV_ROUND_UP(num_bits, 8)), num_bits);
 	out_fields->in_value = in_bits;
 
+	perf_count(PERF_JTAG_SCAN_BITS, num_bits);
+
 	return ERROR_OK;
 }
 
@@ -0,0 +1,110 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <helper/log.h>
+#include "gpio_chardev.h"
+
+#ifdef HAVE_LINUX_GPIO_H
+
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+
+int gpio_chardev_open(const char *chip)
+{
+	int fd = open(chip, O_RDWR | O_CLOEXEC);
+	if (fd < 0)
+		LOG_ERROR("Couldn't open %s: %s", chip, strerror(errno));
+	return fd;
+}
+
+int gpio_chardev_request(int chip_fd, const unsigned int *offsets, unsigned int num_lines,
+		bool output, const uint8_t *values, const char *label)
+{
+	struct gpiohandle_request req;
+
+	if (num_lines > GPIOHANDLES_MAX)
+		return -1;
+
+	memset(&req, 0, sizeof(req));
+	for (unsigned int i = 0; i < num_lines; i++) {
+		req.lineoffsets[i] = offsets[i];
+		if (output)
+			req.default_values[i] = values[i];
+	}
+	req.lines = num_lines;
+	req.flags = output ? GPIOHANDLE_REQUEST_OUTPUT : GPIOHANDLE_REQUEST_INPUT;
+	strncpy(req.consumer_label, label, sizeof(req.consumer_label) - 1);
+
+	if (ioctl(chip_fd, GPIO_GET_LINEHANDLE_IOCTL, &req) < 0) {
+		LOG_ERROR("Couldn't request gpio line %u%s: %s", offsets[0],
+				num_lines > 1 ? " and others" : "", strerror(errno));
+		return -1;
+	}
+
+	return req.fd;
+}
+
+int gpio_chardev_set(int handle_fd, const uint8_t *values, unsigned int num_lines)
+{
+	struct gpiohandle_data data;
+
+	memset(&data, 0, sizeof(data));
+	memcpy(data.values, values, num_lines);
+	if (ioctl(handle_fd, GPIOHANDLE_SET_LINE_VALUES_IOCTL, &data) < 0)
+		return ERROR_FAIL;
+
+	return ERROR_OK;
+}
+
+int gpio_chardev_get(int handle_fd, uint8_t *values, unsigned int num_lines)
+{
+	struct gpiohandle_data data;
+
+	if (ioctl(handle_fd, GPIOHANDLE_GET_LINE_VALUES_IOCTL, &data) < 0)
+		return ERROR_FAIL;
+
+	memcpy(values, data.values, num_lines);
+	return ERROR_OK;
+}
+
+#else
+
+int gpio_chardev_open(const char *chip)
+{
+	LOG_ERROR("GPIO character devices are not supported by this build");
+	return -1;
+}
+
+int gpio_chardev_request(int chip_fd, const unsigned int *offsets, unsigned int num_lines,
+		bool output, const uint8_t *values, const char *label)
+{
+	return -1;
+}
+
+int gpio_chardev_set(int handle_fd, const uint8_t *values, unsigned int num_lines)
+{
+	return ERROR_FAIL;
+}
+
+int gpio_chardev_get(int handle_fd, uint8_t *values, unsigned int num_lines)
+{
+	return ERROR_FAIL;
+}
+
+#endif
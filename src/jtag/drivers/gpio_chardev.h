@@ -0,0 +1,46 @@
+/***************************************************************************
+ *   This program is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   This program is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with this program.  If not, see <http://www.gnu.org/licenses/>. *
+ ***************************************************************************/
+
+#ifndef OPENOCD_JTAG_DRIVERS_GPIO_CHARDEV_H
+#define OPENOCD_JTAG_DRIVERS_GPIO_CHARDEV_H
+
+/**
+ * @file
+ * GPIO access through the Linux GPIO character device (/dev/gpiochipN).
+ *
+ * Several lines of one chip are requested together as one handle, and all
+ * of them are set or read with a single ioctl.  Unlike /dev/mem mapping
+ * this needs no root privileges, only access to the chip device, and works
+ * with any GPIO controller that has a kernel driver.
+ */
+
+/** @returns the file descriptor of the chip, or -1 on failure. */
+int gpio_chardev_open(const char *chip);
+
+/**
+ * Request @a num_lines lines of @a chip_fd as one handle.  Outputs start
+ * at @a values.
+ * @returns the file descriptor of the handle, or -1 on failure.
+ */
+int gpio_chardev_request(int chip_fd, const unsigned int *offsets, unsigned int num_lines,
+		bool output, const uint8_t *values, const char *label);
+
+/** Set all @a num_lines output lines of @a handle_fd at once. */
+int gpio_chardev_set(int handle_fd, const uint8_t *values, unsigned int num_lines);
+
+/** Read all @a num_lines lines of @a handle_fd at once. */
+int gpio_chardev_get(int handle_fd, uint8_t *values, unsigned int num_lines);
+
+#endif /* OPENOCD_JTAG_DRIVERS_GPIO_CHARDEV_H */
@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 #include "log.h"
+#include <helper/perf.h>
 #include "libusb0_common.h"
 
 static bool jtag_libusb_match(struct jtag_libusb_device *dev,
@@ -125,13 +126,23 @@ int jtag_libusb_control_transfer(jtag_libusb_device_handle *dev, uint8_t request
 int jtag_libusb_bulk_write(jtag_libusb_device_handle *dev, int ep, char *bytes,
 		int size, int timeout)
 {
-	return usb_bulk_write(dev, ep, bytes, size, timeout);
+	int transferred = usb_bulk_write(dev, ep, bytes, size, timeout);
+
+	perf_count(PERF_USB_TRANSFERS, 1);
+	if (transferred > 0)
+		perf_count(PERF_USB_BYTES, transferred);
+	return transferred;
 }
 
 int jtag_libusb_bulk_read(jtag_libusb_device_handle *dev, int ep, char *bytes,
 		int size, int timeout)
 {
-	return usb_bulk_read(dev, ep, bytes, size, timeout);
+	int transferred = usb_bulk_read(dev, ep, bytes, size, timeout);
+
+	perf_count(PERF_USB_TRANSFERS, 1);
+	if (transferred > 0)
+		perf_count(PERF_USB_BYTES, transferred);
+	return transferred;
 }
 
 int jtag_libusb_set_configuration(jtag_libusb_device_handle *devh,
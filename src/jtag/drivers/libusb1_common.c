@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 #include "log.h"
+#include <helper/perf.h>
 #include "libusb1_common.h"
 
 static struct libusb_context *jtag_libusb_context; /**< Libusb context **/
@@ -143,6 +144,9 @@ int jtag_libusb_bulk_write(jtag_libusb_device_handle *dev, int ep, char *bytes,
 
 	libusb_bulk_transfer(dev, ep, (unsigned char *)bytes, size,
 			     &transferred, timeout);
+
+	perf_count(PERF_USB_TRANSFERS, 1);
+	perf_count(PERF_USB_BYTES, transferred);
 	return transferred;
 }
 
@@ -153,6 +157,9 @@ int jtag_libusb_bulk_read(jtag_libusb_device_handle *dev, int ep, char *bytes,
 
 	libusb_bulk_transfer(dev, ep, (unsigned char *)bytes, size,
 			     &transferred, timeout);
+
+	perf_count(PERF_USB_TRANSFERS, 1);
+	perf_count(PERF_USB_BYTES, transferred);
 	return transferred;
 }
 
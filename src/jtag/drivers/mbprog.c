@@ -20,29 +20,23 @@
 
 /**
  * @file
- * This driver implements a bitbang jtag interface using gpio lines via
- * sysfs.
- * The aim of this driver implementation is use system GPIOs but avoid the
- * need for a additional kernel driver.
- * (Note memory mapped IO is another option, however it doesn't mix well with
- * the kernel gpiolib driver - which makes sense I guess.)
+ * This driver implements a bitbang jtag interface using gpio lines of a
+ * Linux GPIO character device (see mbprog_gpiochip, default
+ * /dev/gpiochip0), so no additional kernel driver is needed.
  *
  * A gpio is required for tck, tms, tdi and tdo. One or both of srst and trst
  * must be also be specified. The required jtag gpios are specified via the
  * mbprog_jtag_nums command or the relevant mbprog_XXX_num commang.
  * The srst and trst gpios are set via the mbprog_srst_num and
- * mbprog_trst_num respectively. GPIO numbering follows the kernel
- * convention of starting from 0.
+ * mbprog_trst_num respectively. GPIO numbers are line offsets on the chip.
  *
- * The gpios should not be in use by another entity, and must not be requested
- * by a kernel driver without also being exported by it (otherwise they can't
- * be exported by sysfs).
+ * The lines must not be requested by another consumer.  All outputs are
+ * requested as one line handle and their levels are cached, so a bitbang
+ * write costs at most one ioctl; a TDO read is one ioctl on an input handle.
  *
- * The sysfs gpio interface can only manipulate one gpio at a time, so the
- * bitbang write handler remembers the last state for tck, tms, tdi to avoid
- * superfluous writes.
- * For speed the sysfs "value" entry is opened at init and held open.
- * This results in considerable gains over open-write-close (45s vs 900s)
+ * Without tck, tms, tdi and tdo gpios JTAG goes through the serial bridge
+ * that also carries SWD (see mbprog_port), which shifts whole scans per
+ * command instead of toggling gpios bit by bit.
  *
  * Further work could address:
  *  -srst and trst open drain/ push pull
@@ -54,6 +48,7 @@
 
 #include <jtag/interface.h>
 #include "bitbang.h"
+#include "gpio_chardev.h"
 
 /*
  * Helper func to determine if gpio number valid
@@ -65,216 +60,86 @@ static int is_gpio_valid(int gpio)
 	return gpio >= 0 && gpio < 1000;
 }
 
-/*
- * Helper func to open, write to and close a file
- * name and valstr must be null terminated.
- *
- * Returns negative on failure.
- */
-static int open_write_close(const char *name, const char *valstr)
-{
-	int ret;
-	int fd = open(name, O_WRONLY);
-	if (fd < 0)
-		return fd;
-
-	ret = write(fd, valstr, strlen(valstr));
-	close(fd);
-
-	return ret;
-}
-
-/*
- * Helper func to unexport gpio from sysfs
- */
-/* static void unexport_mbprog(int gpio) */
-/* { */
-/* 	if (!is_gpio_valid(gpio)) */
-/* 		return; */
-/* 	return; */
-/* } */
-
-/*
- * Exports and sets up direction for gpio.
- * If the gpio is an output, it is initialized according to init_high,
- * otherwise it is ignored.
- *
- * If the gpio is already exported we just show a warning and continue; if
- * openocd happened to crash (or was killed by user) then the gpios will not
- * have been cleaned up.
- */
-static int setup_mbprog(int gpio, int is_output, int init_high)
-{
-//	char buf[40];
-//	char gpiostr[4];
-	int ret;
-
-	if (!is_gpio_valid(gpio))
-		return ERROR_OK;
-	return ret;
-}
-
-/* gpio numbers for each gpio. Negative values are invalid */
+/* gpio numbers for each gpio, line offsets on gpiochip. Negative values are invalid */
 static int tck_gpio = -1;
 static int tms_gpio = -1;
 static int tdi_gpio = -1;
 static int tdo_gpio = -1;
 static int trst_gpio = -1;
 static int srst_gpio = -1;
-static int swclk_gpio = -1;
-static int swdio_gpio = -1;
 
-/*
- * file descriptors for /sys/class/gpio/gpioXX/value
- * Set up during init.
- */
-static int tck_fd = -1;
-static int tms_fd = -1;
-static int tdi_fd = -1;
-static int tdo_fd = -1;
-static int trst_fd = -1;
-static int srst_fd = -1;
-static int swclk_fd = -1;
-static int swdio_fd = -1;
-
-static int last_swclk;
-static int last_swdio;
-static bool last_stored;
-static bool swdio_input;
-
-static void mbprog_swdio_drive(bool is_output)
-{
-	char buf[40];
-	int ret;
-
-	snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%d/direction", swdio_gpio);
-	ret = open_write_close(buf, is_output ? "high" : "in");
-	if (ret < 0) {
-		LOG_ERROR("Couldn't set direction for gpio %d", swdio_gpio);
-		perror("mbprog: ");
-	}
+#define MBPROG_DEFAULT_GPIOCHIP "/dev/gpiochip0"
 
-	last_stored = false;
-	swdio_input = !is_output;
-}
+enum {
+	CHIP_TCK,
+	CHIP_TMS,
+	CHIP_TDI,
+	CHIP_TRST,
+	CHIP_SRST,
+	CHIP_NUM_OUTPUTS
+};
 
-static int mbprog_swdio_read(void)
-{
-	char buf[1];
+static char *gpiochip;
+static int chip_fd = -1;
+static int chip_out_fd = -1;
+static int chip_tdo_fd = -1;
+static unsigned int chip_out_num;
+/* index into chip_out_values of each output, -1 if not used */
+static int chip_out_index[CHIP_NUM_OUTPUTS];
+static uint8_t chip_out_values[CHIP_NUM_OUTPUTS];
 
-	/* important to seek to signal sysfs of new read */
-	lseek(swdio_fd, 0, SEEK_SET);
-	int ret = read(swdio_fd, &buf, sizeof(buf));
+/* serial bridge carrying SWD, and JTAG when no JTAG gpios are given */
+static struct bitbang_bridge mbprog_bridge = BITBANG_BRIDGE_INIT;
 
-	if (ret < 0) {
-		LOG_WARNING("reading swdio failed");
-		return 0;
-	}
-
-	return buf[0] != '0';
+static const char *mbprog_gpiochip(void)
+{
+	return gpiochip ? gpiochip : MBPROG_DEFAULT_GPIOCHIP;
 }
 
-static void mbprog_swdio_write(int swclk, int swdio)
+/* returns true if the cached level of the output changed */
+static bool chip_set_output(int line, int value)
 {
-	const char one[] = "1";
-	const char zero[] = "0";
-
-	size_t bytes_written;
+	int i = chip_out_index[line];
 
-	if (!swdio_input) {
-		if (!last_stored || (swdio != last_swdio)) {
-			bytes_written = write(swdio_fd, swdio ? &one : &zero, 1);
-			if (bytes_written != 1)
-				LOG_WARNING("writing swdio failed");
-		}
-	}
-
-	/* write swclk last */
-	if (!last_stored || (swclk != last_swclk)) {
-		bytes_written = write(swclk_fd, swclk ? &one : &zero, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing swclk failed");
-	}
+	if (chip_out_fd < 0 || i < 0 || chip_out_values[i] == value)
+		return false;
+	chip_out_values[i] = value;
+	return true;
+}
 
-	last_swdio = swdio;
-	last_swclk = swclk;
-	last_stored = true;
+static void chip_update_outputs(void)
+{
+	if (gpio_chardev_set(chip_out_fd, chip_out_values, chip_out_num) != ERROR_OK)
+		LOG_WARNING("setting gpio lines failed");
 }
 
 /*
  * Bitbang interface read of TDO
- *
- * The sysfs value will read back either '0' or '1'. The trick here is to call
- * lseek to bypass buffering in the sysfs kernel driver.
  */
 static int mbprog_read(void)
 {
-	char buf[1];
+	uint8_t value = 0;
 
-	/* important to seek to signal sysfs of new read */
-	lseek(tdo_fd, 0, SEEK_SET);
-	int ret = read(tdo_fd, &buf, sizeof(buf));
-
-	if (ret < 0) {
+	if (gpio_chardev_get(chip_tdo_fd, &value, 1) != ERROR_OK)
 		LOG_WARNING("reading tdo failed");
-		return 0;
-	}
 
-	return buf[0] != '0';
+	return value;
 }
 
 /*
  * Bitbang interface write of TCK, TMS, TDI
  *
- * Seeing as this is the only function where the outputs are changed,
- * we can cache the old value to avoid needlessly writing it.
+ * All outputs are one line handle, so whatever changed is set in a single
+ * ioctl; nothing is done if the cached levels are already right.
  */
 static void mbprog_write(int tck, int tms, int tdi)
 {
-	if (swd_mode) {
-		mbprog_swdio_write(tck, tdi);
-		return;
-	}
-
-	const char one[] = "1";
-	const char zero[] = "0";
-
-	static int last_tck;
-	static int last_tms;
-	static int last_tdi;
-
-	static int first_time;
-	size_t bytes_written;
-
-	if (!first_time) {
-		last_tck = !tck;
-		last_tms = !tms;
-		last_tdi = !tdi;
-		first_time = 1;
-	}
-
-	if (tdi != last_tdi) {
-		bytes_written = write(tdi_fd, tdi ? &one : &zero, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing tdi failed");
-	}
-
-	if (tms != last_tms) {
-		bytes_written = write(tms_fd, tms ? &one : &zero, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing tms failed");
-	}
+	bool changed = chip_set_output(CHIP_TDI, tdi);
+	changed |= chip_set_output(CHIP_TMS, tms);
+	changed |= chip_set_output(CHIP_TCK, tck);
 
-	/* write clk last */
-	if (tck != last_tck) {
-		bytes_written = write(tck_fd, tck ? &one : &zero, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing tck failed");
-	}
-
-	last_tdi = tdi;
-	last_tms = tms;
-	last_tck = tck;
+	if (changed)
+		chip_update_outputs();
 }
 
 /*
@@ -285,23 +150,13 @@ static void mbprog_write(int tck, int tms, int tdi)
 static void mbprog_reset(int trst, int srst)
 {
 	LOG_DEBUG("mbprog_reset");
-	const char one[] = "1";
-	const char zero[] = "0";
-	size_t bytes_written;
 
 	/* assume active low */
-	if (srst_fd >= 0) {
-		bytes_written = write(srst_fd, srst ? &zero : &one, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing srst failed");
-	}
+	bool changed = chip_set_output(CHIP_SRST, !srst);
+	changed |= chip_set_output(CHIP_TRST, !trst);
 
-	/* assume active low */
-	if (trst_fd >= 0) {
-		bytes_written = write(trst_fd, trst ? &zero : &one, 1);
-		if (bytes_written != 1)
-			LOG_WARNING("writing trst failed");
-	}
+	if (changed)
+		chip_update_outputs();
 }
 
 COMMAND_HANDLER(mbprog_handle_jtag_gpionums)
@@ -376,37 +231,71 @@ COMMAND_HANDLER(mbprog_handle_jtag_gpionum_trst)
 	return ERROR_OK;
 }
 
+/* SWD always goes through the serial bridge, old configs may still name pins */
 COMMAND_HANDLER(mbprog_handle_swd_gpionums)
 {
-	if (CMD_ARGC == 2) {
-		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], swclk_gpio);
-		COMMAND_PARSE_NUMBER(int, CMD_ARGV[1], swdio_gpio);
+	LOG_WARNING("%s is ignored, SWD goes through the serial bridge (see mbprog_port)",
+			CMD_NAME);
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(mbprog_handle_gpiochip)
+{
+	if (CMD_ARGC == 1) {
+		free(gpiochip);
+		gpiochip = strdup(CMD_ARGV[0]);
 	} else if (CMD_ARGC != 0) {
 		return ERROR_COMMAND_SYNTAX_ERROR;
 	}
 
-	command_print(CMD_CTX,
-			"Mbprog nums: swclk = %d, swdio = %d",
-			swclk_gpio, swdio_gpio);
+	command_print(CMD_CTX, "Mbprog gpiochip: %s", mbprog_gpiochip());
+	return ERROR_OK;
+}
+
+COMMAND_HANDLER(mbprog_handle_port)
+{
+	if (CMD_ARGC == 1) {
+		int retval = bitbang_bridge_set_port(&mbprog_bridge, CMD_ARGV[0]);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
 
+	command_print(CMD_CTX, "Mbprog port: %s", bitbang_bridge_get_port(&mbprog_bridge));
 	return ERROR_OK;
 }
 
-COMMAND_HANDLER(mbprog_handle_swd_gpionum_swclk)
+COMMAND_HANDLER(mbprog_handle_baudrate)
 {
-	if (CMD_ARGC == 1)
-		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], swclk_gpio);
+	if (CMD_ARGC == 1) {
+		int baudrate;
+		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], baudrate);
+		int retval = bitbang_bridge_set_baudrate(&mbprog_bridge, baudrate);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
 
-	command_print(CMD_CTX, "Mbprog num: swclk = %d", swclk_gpio);
+	command_print(CMD_CTX, "Mbprog baudrate: %d", bitbang_bridge_get_baudrate(&mbprog_bridge));
 	return ERROR_OK;
 }
 
-COMMAND_HANDLER(mbprog_handle_swd_gpionum_swdio)
+COMMAND_HANDLER(mbprog_handle_swd_retry)
 {
-	if (CMD_ARGC == 1)
-		COMMAND_PARSE_NUMBER(int, CMD_ARGV[0], swdio_gpio);
+	if (CMD_ARGC == 1) {
+		unsigned int retry;
+		COMMAND_PARSE_NUMBER(uint, CMD_ARGV[0], retry);
+		int retval = bitbang_bridge_set_swd_retry(&mbprog_bridge, retry);
+		if (retval != ERROR_OK)
+			return retval;
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
 
-	command_print(CMD_CTX, "Mbprog num: swdio = %d", swdio_gpio);
+	command_print(CMD_CTX, "Mbprog SWD WAIT retries in the bridge: %u",
+			bitbang_bridge_get_swd_retry(&mbprog_bridge));
 	return ERROR_OK;
 }
 
@@ -458,20 +347,52 @@ static const struct command_registration mbprog_command_handlers[] = {
 		.name = "mbprog_swd_nums",
 		.handler = &mbprog_handle_swd_gpionums,
 		.mode = COMMAND_CONFIG,
-		.help = "gpio numbers for swclk, swdio. (in that order)",
+		.help = "ignored, SWD goes through the serial bridge.",
 		.usage = "(swclk swdio)* ",
 	},
 	{
 		.name = "mbprog_swclk_num",
-		.handler = &mbprog_handle_swd_gpionum_swclk,
+		.handler = &mbprog_handle_swd_gpionums,
 		.mode = COMMAND_CONFIG,
-		.help = "gpio number for swclk.",
+		.help = "ignored, SWD goes through the serial bridge.",
 	},
 	{
 		.name = "mbprog_swdio_num",
-		.handler = &mbprog_handle_swd_gpionum_swdio,
+		.handler = &mbprog_handle_swd_gpionums,
+		.mode = COMMAND_CONFIG,
+		.help = "ignored, SWD goes through the serial bridge.",
+	},
+	{
+		.name = "mbprog_gpiochip",
+		.handler = &mbprog_handle_gpiochip,
+		.mode = COMMAND_CONFIG,
+		.help = "GPIO character device holding the JTAG lines "
+			"(default " MBPROG_DEFAULT_GPIOCHIP ").",
+		.usage = "[device]",
+	},
+	{
+		.name = "mbprog_port",
+		.handler = &mbprog_handle_port,
+		.mode = COMMAND_CONFIG,
+		.help = "serial device of the SWD/JTAG bridge, so that several "
+			"probes can be served by separate instances "
+			"(default " BITBANG_BRIDGE_DEFAULT_PORT ").",
+		.usage = "[device]",
+	},
+	{
+		.name = "mbprog_baudrate",
+		.handler = &mbprog_handle_baudrate,
 		.mode = COMMAND_CONFIG,
-		.help = "gpio number for swdio.",
+		.help = "baudrate of the SWD/JTAG bridge serial link (default 115200).",
+		.usage = "[baudrate]",
+	},
+	{
+		.name = "mbprog_swd_retry",
+		.handler = &mbprog_handle_swd_retry,
+		.mode = COMMAND_ANY,
+		.help = "number of SWD WAIT responses the bridge retries on its own "
+			"before reporting them (default 0, retry from the host).",
+		.usage = "[count]",
 	},
 	COMMAND_REGISTRATION_DONE
 };
@@ -496,30 +417,65 @@ static struct bitbang_interface mbprog_bitbang = {
 	.read = mbprog_read,
 	.write = mbprog_write,
 	.reset = mbprog_reset,
-	.swdio_read = mbprog_swdio_read,
-	.swdio_drive = mbprog_swdio_drive,
-	.blink = 0
+	.blink = 0,
+	.bridge = &mbprog_bridge,
 };
 
-/* helper func to close and cleanup files only if they were valid/ used */
-static void cleanup_fd(int fd, int gpio)
+static void cleanup_chip(void)
 {
-	if (gpio >= 0) {
-		if (fd >= 0)
-			close(fd);
-
-//		unexport_mbprog(gpio);
-	}
+	if (chip_tdo_fd >= 0)
+		close(chip_tdo_fd);
+	if (chip_out_fd >= 0)
+		close(chip_out_fd);
+	if (chip_fd >= 0)
+		close(chip_fd);
+	chip_tdo_fd = chip_out_fd = chip_fd = -1;
 }
 
-static void cleanup_all_fds(void)
+/*
+ * Request TDO as an input, and TDI, TCK, TMS, TRST, SRST as one output
+ * handle.  Drive TDI and TCK low, and TMS/TRST/SRST high.
+ */
+static int setup_chip(void)
 {
-	cleanup_fd(tck_fd, tck_gpio);
-	cleanup_fd(tms_fd, tms_gpio);
-	cleanup_fd(tdi_fd, tdi_gpio);
-	cleanup_fd(tdo_fd, tdo_gpio);
-	cleanup_fd(trst_fd, trst_gpio);
-	cleanup_fd(srst_fd, srst_gpio);
+	const struct {
+		int gpio;
+		uint8_t value;
+	} outputs[CHIP_NUM_OUTPUTS] = {
+		[CHIP_TCK] = { tck_gpio, 0 },
+		[CHIP_TMS] = { tms_gpio, 1 },
+		[CHIP_TDI] = { tdi_gpio, 0 },
+		[CHIP_TRST] = { trst_gpio, 1 },
+		[CHIP_SRST] = { srst_gpio, 1 },
+	};
+	unsigned int offsets[CHIP_NUM_OUTPUTS];
+	unsigned int offset = tdo_gpio;
+
+	chip_fd = gpio_chardev_open(mbprog_gpiochip());
+	if (chip_fd < 0)
+		return ERROR_FAIL;
+
+	chip_out_num = 0;
+	for (int i = 0; i < CHIP_NUM_OUTPUTS; i++) {
+		chip_out_index[i] = -1;
+		if (!is_gpio_valid(outputs[i].gpio))
+			continue;
+		chip_out_index[i] = chip_out_num;
+		offsets[chip_out_num] = outputs[i].gpio;
+		chip_out_values[chip_out_num] = outputs[i].value;
+		chip_out_num++;
+	}
+
+	chip_out_fd = gpio_chardev_request(chip_fd, offsets, chip_out_num, true,
+			chip_out_values, "openocd");
+	if (chip_out_fd < 0)
+		return ERROR_FAIL;
+
+	chip_tdo_fd = gpio_chardev_request(chip_fd, &offset, 1, false, NULL, "openocd tdo");
+	if (chip_tdo_fd < 0)
+		return ERROR_FAIL;
+
+	return ERROR_OK;
 }
 
 static bool mbprog_jtag_mode_possible(void)
@@ -535,110 +491,52 @@ static bool mbprog_jtag_mode_possible(void)
 	return 1;
 }
 
-static bool mbprog_swd_mode_possible(void)
-{
-	if (!is_gpio_valid(swclk_gpio))
-		return 0;
-	if (!is_gpio_valid(swdio_gpio))
-		return 0;
-	return 1;
-}
-
 static int mbprog_init(void)
 {
 	bitbang_interface = &mbprog_bitbang;
 
 	LOG_INFO("Mbprog JTAG/SWD bitbang driver");
 
-	if (mbprog_jtag_mode_possible()) {
-		if (mbprog_swd_mode_possible())
-			LOG_INFO("JTAG and SWD modes enabled");
-		else
-			LOG_INFO("JTAG only mode enabled (specify swclk and swdio gpio to add SWD mode)");
+	bool jtag_bridge = false;
+
+	if (swd_mode) {
+		LOG_INFO("SWD through the serial bridge");
+		if (bitbang_bridge_init(&mbprog_bridge) != ERROR_OK)
+			return ERROR_JTAG_INIT_FAILED;
+	} else if (!mbprog_jtag_mode_possible()) {
+		LOG_INFO("JTAG through the serial bridge");
+		if (bitbang_bridge_init(&mbprog_bridge) != ERROR_OK)
+			return ERROR_JTAG_INIT_FAILED;
+		jtag_bridge = true;
+	} else {
+		LOG_INFO("JTAG through gpios");
 		if (!is_gpio_valid(trst_gpio) && !is_gpio_valid(srst_gpio)) {
 			LOG_ERROR("Require at least one of trst or srst gpios to be specified");
 			return ERROR_JTAG_INIT_FAILED;
 		}
-	} else if (mbprog_swd_mode_possible()) {
-		LOG_INFO("SWD only mode enabled (specify tck, tms, tdi and tdo gpios to add JTAG mode)");
-	} else {
-		LOG_ERROR("Require tck, tms, tdi and tdo gpios for JTAG mode and/or swclk and swdio gpio for SWD mode");
-		return ERROR_JTAG_INIT_FAILED;
-	}
-
-
-	/*
-	 * Configure TDO as an input, and TDI, TCK, TMS, TRST, SRST
-	 * as outputs.  Drive TDI and TCK low, and TMS/TRST/SRST high.
-	 * For SWD, SWCLK and SWDIO are configures as output high.
-	 */
-	if (tck_gpio >= 0) {
-		tck_fd = setup_mbprog(tck_gpio, 1, 0);
-		if (tck_fd < 0)
-			goto out_error;
-	}
-
-	if (tms_gpio >= 0) {
-		tms_fd = setup_mbprog(tms_gpio, 1, 1);
-		if (tms_fd < 0)
-			goto out_error;
-	}
-
-	if (tdi_gpio >= 0) {
-		tdi_fd = setup_mbprog(tdi_gpio, 1, 0);
-		if (tdi_fd < 0)
+		LOG_INFO("Using lines of %s", mbprog_gpiochip());
+		if (setup_chip() != ERROR_OK)
 			goto out_error;
 	}
 
-	if (tdo_gpio >= 0) {
-		tdo_fd = setup_mbprog(tdo_gpio, 0, 0);
-		if (tdo_fd < 0)
-			goto out_error;
-	}
-
-	/* assume active low*/
-	if (trst_gpio >= 0) {
-		trst_fd = setup_mbprog(trst_gpio, 1, 1);
-		if (trst_fd < 0)
-			goto out_error;
-	}
-
-	/* assume active low*/
-	if (srst_gpio >= 0) {
-		srst_fd = setup_mbprog(srst_gpio, 1, 1);
-		if (srst_fd < 0)
-			goto out_error;
-	}
-
-	if (swclk_gpio >= 0) {
-		swclk_fd = setup_mbprog(swclk_gpio, 1, 0);
-		if (swclk_fd < 0)
-			goto out_error;
-	}
-
-	if (swdio_gpio >= 0) {
-		swdio_fd = setup_mbprog(swdio_gpio, 1, 0);
-		if (swdio_fd < 0)
-			goto out_error;
-	}
-
-	if (mbprog_swd_mode_possible()) {
-		if (swd_mode)
-			bitbang_swd_switch_seq(JTAG_TO_SWD);
-		else
-			bitbang_swd_switch_seq(SWD_TO_JTAG);
-	}
+	if (swd_mode)
+		bitbang_swd_switch_seq(JTAG_TO_SWD);
+	else if (jtag_bridge)
+		bitbang_swd_switch_seq(SWD_TO_JTAG);
 
 	return ERROR_OK;
 
 out_error:
-	cleanup_all_fds();
+	cleanup_chip();
 	return ERROR_JTAG_INIT_FAILED;
 }
 
 static int mbprog_quit(void)
 {
-	cleanup_all_fds();
+	cleanup_chip();
+	bitbang_bridge_close(&mbprog_bridge);
+	free(gpiochip);
+	gpiochip = NULL;
 	return ERROR_OK;
 }
 
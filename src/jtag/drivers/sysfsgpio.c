@@ -54,6 +54,7 @@
 
 #include <jtag/interface.h>
 #include "bitbang.h"
+#include "gpio_chardev.h"
 
 /*
  * Helper func to determine if gpio number valid
@@ -179,11 +180,69 @@ static int last_swdio;
 static bool last_stored;
 static bool swdio_input;
 
+/*
+ * With sysfsgpio_gpiochip the gpio numbers are line offsets on that GPIO
+ * character device instead.  All outputs except SWDIO are requested as one
+ * handle, so every bitbang write is a single ioctl.  TDO and SWDIO, which
+ * changes direction, have handles of their own.
+ */
+enum {
+	CHIP_TCK,
+	CHIP_TMS,
+	CHIP_TDI,
+	CHIP_TRST,
+	CHIP_SRST,
+	CHIP_SWCLK,
+	CHIP_NUM_OUTPUTS
+};
+
+static char *gpiochip;
+static int chip_fd = -1;
+static int chip_out_fd = -1;
+static int chip_tdo_fd = -1;
+static int chip_swdio_fd = -1;
+static unsigned int chip_out_num;
+/* index into chip_out_values of each output, -1 if not used */
+static int chip_out_index[CHIP_NUM_OUTPUTS];
+static uint8_t chip_out_values[CHIP_NUM_OUTPUTS];
+
+static void chip_set_output(int line, int value)
+{
+	if (chip_out_index[line] >= 0)
+		chip_out_values[chip_out_index[line]] = value;
+}
+
+static void chip_update_outputs(void)
+{
+	if (gpio_chardev_set(chip_out_fd, chip_out_values, chip_out_num) != ERROR_OK)
+		LOG_WARNING("setting gpio lines failed");
+}
+
+static int chip_request_swdio(bool is_output)
+{
+	unsigned int offset = swdio_gpio;
+	uint8_t value = 1;
+
+	if (chip_swdio_fd >= 0)
+		close(chip_swdio_fd);
+	chip_swdio_fd = gpio_chardev_request(chip_fd, &offset, 1, is_output, &value,
+			"openocd swdio");
+	return chip_swdio_fd < 0 ? ERROR_FAIL : ERROR_OK;
+}
+
 static void sysfsgpio_swdio_drive(bool is_output)
 {
 	char buf[40];
 	int ret;
 
+	if (gpiochip) {
+		if (chip_request_swdio(is_output) != ERROR_OK)
+			LOG_ERROR("Couldn't set direction for gpio %d", swdio_gpio);
+		last_stored = false;
+		swdio_input = !is_output;
+		return;
+	}
+
 	snprintf(buf, sizeof(buf), "/sys/class/gpio/gpio%d/direction", swdio_gpio);
 	ret = open_write_close(buf, is_output ? "high" : "in");
 	if (ret < 0) {
@@ -199,6 +258,13 @@ static int sysfsgpio_swdio_read(void)
 {
 	char buf[1];
 
+	if (gpiochip) {
+		uint8_t value = 0;
+		if (gpio_chardev_get(chip_swdio_fd, &value, 1) != ERROR_OK)
+			LOG_WARNING("reading swdio failed");
+		return value;
+	}
+
 	/* important to seek to signal sysfs of new read */
 	lseek(swdio_fd, 0, SEEK_SET);
 	int ret = read(swdio_fd, &buf, sizeof(buf));
@@ -218,6 +284,22 @@ static void sysfsgpio_swdio_write(int swclk, int swdio)
 
 	size_t bytes_written;
 
+	if (gpiochip) {
+		if (!swdio_input && (!last_stored || (swdio != last_swdio))) {
+			uint8_t value = swdio;
+			if (gpio_chardev_set(chip_swdio_fd, &value, 1) != ERROR_OK)
+				LOG_WARNING("writing swdio failed");
+		}
+		if (!last_stored || (swclk != last_swclk)) {
+			chip_set_output(CHIP_SWCLK, swclk);
+			chip_update_outputs();
+		}
+		last_swdio = swdio;
+		last_swclk = swclk;
+		last_stored = true;
+		return;
+	}
+
 	if (!swdio_input) {
 		if (!last_stored || (swdio != last_swdio)) {
 			bytes_written = write(swdio_fd, swdio ? &one : &zero, 1);
@@ -248,6 +330,13 @@ static int sysfsgpio_read(void)
 {
 	char buf[1];
 
+	if (gpiochip) {
+		uint8_t value = 0;
+		if (gpio_chardev_get(chip_tdo_fd, &value, 1) != ERROR_OK)
+			LOG_WARNING("reading tdo failed");
+		return value;
+	}
+
 	/* important to seek to signal sysfs of new read */
 	lseek(tdo_fd, 0, SEEK_SET);
 	int ret = read(tdo_fd, &buf, sizeof(buf));
@@ -290,6 +379,20 @@ static void sysfsgpio_write(int tck, int tms, int tdi)
 		first_time = 1;
 	}
 
+	/* all three lines change in one ioctl */
+	if (gpiochip) {
+		if (tdi != last_tdi || tms != last_tms || tck != last_tck) {
+			chip_set_output(CHIP_TDI, tdi);
+			chip_set_output(CHIP_TMS, tms);
+			chip_set_output(CHIP_TCK, tck);
+			chip_update_outputs();
+		}
+		last_tdi = tdi;
+		last_tms = tms;
+		last_tck = tck;
+		return;
+	}
+
 	if (tdi != last_tdi) {
 		bytes_written = write(tdi_fd, tdi ? &one : &zero, 1);
 		if (bytes_written != 1)
@@ -326,6 +429,14 @@ static void sysfsgpio_reset(int trst, int srst)
 	const char zero[] = "0";
 	size_t bytes_written;
 
+	/* assume active low */
+	if (gpiochip) {
+		chip_set_output(CHIP_SRST, !srst);
+		chip_set_output(CHIP_TRST, !trst);
+		chip_update_outputs();
+		return;
+	}
+
 	/* assume active low */
 	if (srst_fd >= 0) {
 		bytes_written = write(srst_fd, srst ? &zero : &one, 1);
@@ -447,6 +558,19 @@ COMMAND_HANDLER(sysfsgpio_handle_swd_gpionum_swdio)
 	return ERROR_OK;
 }
 
+COMMAND_HANDLER(sysfsgpio_handle_gpiochip)
+{
+	if (CMD_ARGC == 1) {
+		free(gpiochip);
+		gpiochip = strdup(CMD_ARGV[0]);
+	} else if (CMD_ARGC != 0) {
+		return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	command_print(CMD_CTX, "SysfsGPIO gpiochip: %s", gpiochip ? gpiochip : "none (sysfs)");
+	return ERROR_OK;
+}
+
 static const struct command_registration sysfsgpio_command_handlers[] = {
 	{
 		.name = "sysfsgpio_jtag_nums",
@@ -510,6 +634,14 @@ static const struct command_registration sysfsgpio_command_handlers[] = {
 		.mode = COMMAND_CONFIG,
 		.help = "gpio number for swdio.",
 	},
+	{
+		.name = "sysfsgpio_gpiochip",
+		.handler = &sysfsgpio_handle_gpiochip,
+		.mode = COMMAND_CONFIG,
+		.help = "use the lines of a GPIO character device (e.g. /dev/gpiochip0) "
+			"instead of sysfs; gpio numbers are then line offsets on it.",
+		.usage = "[device]",
+	},
 	COMMAND_REGISTRATION_DONE
 };
 
@@ -549,8 +681,80 @@ static void cleanup_fd(int fd, int gpio)
 	}
 }
 
+static void cleanup_chip(void)
+{
+	if (chip_swdio_fd >= 0)
+		close(chip_swdio_fd);
+	if (chip_tdo_fd >= 0)
+		close(chip_tdo_fd);
+	if (chip_out_fd >= 0)
+		close(chip_out_fd);
+	if (chip_fd >= 0)
+		close(chip_fd);
+	chip_swdio_fd = chip_tdo_fd = chip_out_fd = chip_fd = -1;
+}
+
+/*
+ * Same initial levels as the sysfs setup: TDI, TCK and SWCLK low, TMS,
+ * TRST and SRST high, SWDIO output high.
+ */
+static int setup_chip(void)
+{
+	const struct {
+		int gpio;
+		uint8_t value;
+	} outputs[CHIP_NUM_OUTPUTS] = {
+		[CHIP_TCK] = { tck_gpio, 0 },
+		[CHIP_TMS] = { tms_gpio, 1 },
+		[CHIP_TDI] = { tdi_gpio, 0 },
+		[CHIP_TRST] = { trst_gpio, 1 },
+		[CHIP_SRST] = { srst_gpio, 1 },
+		[CHIP_SWCLK] = { swclk_gpio, 0 },
+	};
+	unsigned int offsets[CHIP_NUM_OUTPUTS];
+
+	chip_fd = gpio_chardev_open(gpiochip);
+	if (chip_fd < 0)
+		return ERROR_FAIL;
+
+	chip_out_num = 0;
+	for (int i = 0; i < CHIP_NUM_OUTPUTS; i++) {
+		chip_out_index[i] = -1;
+		if (!is_gpio_valid(outputs[i].gpio))
+			continue;
+		chip_out_index[i] = chip_out_num;
+		offsets[chip_out_num] = outputs[i].gpio;
+		chip_out_values[chip_out_num] = outputs[i].value;
+		chip_out_num++;
+	}
+
+	if (chip_out_num) {
+		chip_out_fd = gpio_chardev_request(chip_fd, offsets, chip_out_num, true,
+				chip_out_values, "openocd");
+		if (chip_out_fd < 0)
+			return ERROR_FAIL;
+	}
+
+	if (is_gpio_valid(tdo_gpio)) {
+		unsigned int offset = tdo_gpio;
+		chip_tdo_fd = gpio_chardev_request(chip_fd, &offset, 1, false, NULL, "openocd tdo");
+		if (chip_tdo_fd < 0)
+			return ERROR_FAIL;
+	}
+
+	if (is_gpio_valid(swdio_gpio))
+		return chip_request_swdio(true);
+
+	return ERROR_OK;
+}
+
 static void cleanup_all_fds(void)
 {
+	if (gpiochip) {
+		cleanup_chip();
+		return;
+	}
+
 	cleanup_fd(tck_fd, tck_gpio);
 	cleanup_fd(tms_fd, tms_gpio);
 	cleanup_fd(tdi_fd, tdi_gpio);
@@ -604,6 +808,13 @@ static int sysfsgpio_init(void)
 	}
 
 
+	if (gpiochip) {
+		LOG_INFO("Using lines of %s", gpiochip);
+		if (setup_chip() != ERROR_OK)
+			goto out_error;
+		goto out_switch;
+	}
+
 	/*
 	 * Configure TDO as an input, and TDI, TCK, TMS, TRST, SRST
 	 * as outputs.  Drive TDI and TCK low, and TMS/TRST/SRST high.
@@ -659,6 +870,7 @@ static int sysfsgpio_init(void)
 			goto out_error;
 	}
 
+out_switch:
 	if (sysfsgpio_swd_mode_possible()) {
 		if (swd_mode)
 			bitbang_swd_switch_seq(JTAG_TO_SWD);
@@ -32,6 +32,7 @@
 #include <transport/transport.h>
 #include <helper/ioutil.h>
 #include <helper/util.h>
+#include <helper/perf.h>
 #include <helper/configuration.h>
 #include <flash/nor/core.h>
 #include <flash/nand/core.h>
@@ -245,6 +246,7 @@ struct command_context *setup_command_handler(Jim_Interp *interp)
 		&server_register_commands,
 		&gdb_register_commands,
 		&log_register_commands,
+		&perf_register_commands,
 		&transport_register_commands,
 		&interface_register_commands,
 		&target_register_commands,
@@ -349,6 +351,8 @@ int openocd_main(int argc, char *argv[])
 
 	adapter_quit();
 
+	perf_quit();
+
 	if (ERROR_FAIL == ret)
 		return EXIT_FAILURE;
 	else if (ERROR_OK != ret)
@@ -48,6 +48,7 @@
 #include <jtag/jtag.h>
 #include "rtos/rtos.h"
 #include "target/smp.h"
+#include <helper/perf.h>
 
 /**
  * @file
@@ -2766,6 +2767,37 @@ static void gdb_sig_halted(struct connection *connection)
 	gdb_put_packet(connection, sig_reply, 3);
 }
 
+/* map a packet to the perf histogram tracking its service latency */
+static enum perf_histogram gdb_packet_perf_histogram(char type)
+{
+	switch (type) {
+		case 'q':
+		case 'Q':
+			return PERF_HIST_GDB_QUERY;
+		case 'g':
+		case 'p':
+			return PERF_HIST_GDB_REG_READ;
+		case 'G':
+		case 'P':
+			return PERF_HIST_GDB_REG_WRITE;
+		case 'm':
+			return PERF_HIST_GDB_MEM_READ;
+		case 'M':
+		case 'X':
+			return PERF_HIST_GDB_MEM_WRITE;
+		case 'z':
+		case 'Z':
+			return PERF_HIST_GDB_BREAKPOINT;
+		case 'c':
+		case 's':
+			return PERF_HIST_GDB_RUN_CONTROL;
+		case 'v':
+			return PERF_HIST_GDB_V;
+		default:
+			return PERF_HIST_GDB_OTHER;
+	}
+}
+
 static int gdb_input_inner(struct connection *connection)
 {
 	/* Do not allocate this on the stack */
@@ -2813,6 +2845,7 @@ static int gdb_input_inner(struct connection *connection)
 		}
 
 		if (packet_size > 0) {
+			int64_t start = perf_now();
 			retval = ERROR_OK;
 			switch (packet[0]) {
 				case 'T':	/* Is thread alive? */
@@ -2991,6 +3024,8 @@ static int gdb_input_inner(struct connection *connection)
 					break;
 			}
 
+			perf_record(gdb_packet_perf_histogram(packet[0]), start);
+
 			/* if a packet handler returned an error, exit input loop */
 			if (retval != ERROR_OK)
 				return retval;
@@ -3015,7 +3050,9 @@ static int gdb_input_inner(struct connection *connection)
 
 static int gdb_input(struct connection *connection)
 {
+	int64_t start = perf_now();
 	int retval = gdb_input_inner(connection);
+	perf_record(PERF_HIST_GDB_INPUT, start);
 	struct gdb_connection *gdb_con = connection->priv;
 	if (retval == ERROR_SERVER_REMOTE_CLOSED)
 		return retval;
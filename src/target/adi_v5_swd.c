@@ -47,6 +47,7 @@
 #include "arm.h"
 #include "arm_adi_v5.h"
 #include <helper/time_support.h>
+#include <helper/perf.h>
 
 #include <transport/transport.h>
 #include <jtag/interface.h>
@@ -85,7 +86,10 @@ static int swd_run_inner(struct adiv5_dap *dap)
 	const struct swd_driver *swd = jtag_interface->swd;
 	int retval;
 
+	perf_count(PERF_SWD_RUN, 1);
+	int64_t start = perf_now();
 	retval = swd->run();
+	perf_record(PERF_HIST_SWD_RUN, start);
 
 	if (retval != ERROR_OK) {
 		/* fault response */
@@ -92,6 +92,23 @@ enum arm_state {
 
 #define ARM_COMMON_MAGIC 0x0A450A45
 
+/** Number of opcodes kept by arm_simulate_step(), must be a power of two. */
+#define ARM_SIM_CACHE_SIZE 64
+
+/**
+ * Opcodes fetched by the instruction simulator while single stepping,
+ * indexed by address.  Entries covering memory the debugger writes are
+ * dropped, and the whole cache is flushed when the core ran freely.
+ */
+struct arm_sim_cache {
+	bool registered;
+	struct {
+		uint32_t address;
+		uint32_t opcode;
+		uint8_t size;	/* 0 = unused, 2 = Thumb, 4 = ARM */
+	} entry[ARM_SIM_CACHE_SIZE];
+};
+
 /**
  * Represents a generic ARM core, with standard application registers.
  *
@@ -199,6 +216,9 @@ struct arm {
 	 * used to make requests to the target.
 	 */
 	struct adiv5_dap *dap;
+
+	/** Opcode cache for arm_simulate_step(). */
+	struct arm_sim_cache sim_cache;
 };
 
 /** Convert target handle to generic ARM target state handle. */
@@ -260,6 +280,8 @@ int armv4_5_run_algorithm_inner(struct target *target,
 
 int arm_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+int arm_checksum_memory_regions(struct target *target,
+		struct target_checksum_region *regions, unsigned int num_regions);
 int arm_blank_check_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *blank, uint8_t erased_value);
 
@@ -1046,6 +1046,8 @@ static int arm11_write_memory(struct target *target,
 	target_addr_t address, uint32_t size,
 	uint32_t count, const uint8_t *buffer)
 {
+	arm_sim_cache_invalidate(target_to_arm(target), address, size * count);
+
 	/* pointer increment matters only for multi-unit writes ...
 	 * not e.g. to a "reset the chip" controller.
 	 */
@@ -1131,6 +1133,11 @@ static int arm11_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+static void arm11_deinit_target(struct target *target)
+{
+	arm_sim_cache_release(target_to_arm(target));
+}
+
 /* talk to the target and set things up */
 static int arm11_examine(struct target *target)
 {
@@ -1368,6 +1375,7 @@ struct target_type arm11_target = {
 	.write_memory = arm11_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.add_breakpoint = arm11_add_breakpoint,
@@ -1379,4 +1387,5 @@ struct target_type arm11_target = {
 	.target_create = arm11_target_create,
 	.init_target = arm11_init_target,
 	.examine = arm11_examine,
+	.deinit_target = arm11_deinit_target,
 };
@@ -570,6 +570,7 @@ struct target_type arm720t_target = {
 	.virt2phys = arm720_virt2phys,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -583,5 +584,6 @@ struct target_type arm720t_target = {
 	.target_create = arm720t_target_create,
 	.init_target = arm720t_init_target,
 	.examine = arm7_9_examine,
+	.deinit_target = arm7_9_deinit_target,
 	.check_reset = arm7_9_check_reset,
 };
@@ -2298,6 +2298,8 @@ int arm7_9_write_memory(struct target *target,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	arm_sim_cache_invalidate(arm, address, size * count);
+
 	/* load the base register with the address of the first word */
 	reg[0] = address;
 	arm7_9->write_core_regs(target, 0x1, reg);
@@ -2488,6 +2490,8 @@ int arm7_9_write_memory_opt(struct target *target,
 	int retval;
 
 	if (size == 4 && count > 32 && arm7_9->bulk_write_memory) {
+		arm_sim_cache_invalidate(&arm7_9->arm, address, size * count);
+
 		/* Attempt to do a bulk write */
 		retval = arm7_9->bulk_write_memory(target, address, count, buffer);
 
@@ -2647,6 +2651,198 @@ int arm7_9_bulk_write_memory(struct target *target,
 	return retval;
 }
 
+int arm7_9_read_memory_opt(struct target *target,
+	target_addr_t address,
+	uint32_t size,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	int retval;
+
+	if (size == 4 && count > 32 && arm7_9->bulk_read_memory) {
+		/* Attempt to do a bulk read */
+		retval = arm7_9->bulk_read_memory(target, address, count, buffer);
+
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+	}
+
+	return arm7_9_read_memory(target, address, size, count, buffer);
+}
+
+/* words read in one queue after each DCC handshake */
+#define DCC_UPLOAD_BATCH 128
+
+/* passed to the completion as arch_info, so arm_algo must come first */
+struct arm7_9_dcc_upload {
+	struct arm_algorithm arm_algo;
+	uint32_t count;
+	uint8_t *buffer;
+	/* set when the target fell behind and the data can't be trusted */
+	bool missed;
+};
+
+static int arm7_9_dcc_upload_completion(struct target *target,
+	uint32_t exit_point,
+	int timeout_ms,
+	void *arch_info)
+{
+	int retval = ERROR_OK;
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	struct reg *dcc_control = &arm7_9->eice_cache->reg_list[EICE_COMMS_CTRL];
+	struct arm7_9_dcc_upload *upload = arch_info;
+	uint32_t data[DCC_UPLOAD_BATCH];
+	uint32_t count = upload->count;
+	uint8_t *buffer = upload->buffer;
+
+	retval = target_wait_state(target, TARGET_DEBUG_RUNNING, 500);
+	if (retval != ERROR_OK)
+		return retval;
+
+	while (count > 0) {
+		uint32_t n = MIN(count, DCC_UPLOAD_BATCH);
+
+		/* wait for the first word of the batch */
+		int64_t then = timeval_ms();
+		for (;;) {
+			retval = embeddedice_read_reg(dcc_control);
+			if (retval == ERROR_OK)
+				retval = jtag_execute_queue();
+			if (retval != ERROR_OK)
+				return retval;
+			if (buf_get_u32(dcc_control->value, 1, 1) == 1)
+				break;
+			if (timeval_ms() > then + timeout_ms) {
+				LOG_ERROR("timeout waiting for DCC data");
+				return ERROR_TARGET_TIMEOUT;
+			}
+		}
+
+		/* W is checked again ahead of every word, a core slower than
+		 * the JTAG clock must not hand out stale words */
+		retval = embeddedice_receive_checked(&arm7_9->jtag_info, data, n,
+				&upload->missed);
+		if (retval != ERROR_OK)
+			return retval;
+		if (upload->missed) {
+			LOG_DEBUG("target fell behind the DCC reads");
+			break;
+		}
+
+		target_buffer_set_u32_array(target, buffer, n, data);
+		buffer += n * 4;
+		count -= n;
+	}
+
+	/* halt in any case, so that the algorithm context gets restored */
+	retval = target_halt(target);
+	if (retval != ERROR_OK)
+		return retval;
+	return target_wait_state(target, TARGET_HALTED, 500);
+}
+
+static const uint32_t dcc_upload_code[] = {
+	/* r0 == input, points to memory buffer
+	 * r1 == input, number of words
+	 * r2, r3 == scratch
+	 */
+
+	/* load next word from memory */
+	0xe4902004,	/* l: ldr r2, [r0], #4        */
+
+	/* spin until the debugger has read the previous word (c0 W bit) */
+	0xee103e10,	/* w: mrc p14, #0, r3, c0, c0 */
+	0xe3130002,	/*    tst r3, #2              */
+	0x1afffffc,	/*    bne w                   */
+
+	/* write word to DCC (c1) */
+	0xee012e10,	/*    mcr p14, #0, r2, c1, c0 */
+
+	/* repeat until done */
+	0xe2511001,	/*    subs r1, r1, #1         */
+	0x1afffff8,	/*    bne l                   */
+	0xeafffffe	/* d: b   d                   */
+};
+
+int arm7_9_bulk_read_memory(struct target *target,
+	target_addr_t address,
+	uint32_t count,
+	uint8_t *buffer)
+{
+	int retval;
+	struct arm7_9_common *arm7_9 = target_to_arm7_9(target);
+	const uint32_t code_size = ARRAY_SIZE(dcc_upload_code) * 4;
+
+	if (address % 4 != 0)
+		return ERROR_TARGET_UNALIGNED_ACCESS;
+
+	if (!arm7_9->dcc_downloads)
+		return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+
+	/* regrab previously allocated working_area, or allocate a new one */
+	if (!arm7_9->dcc_upload_working_area) {
+		uint8_t dcc_code_buf[ARRAY_SIZE(dcc_upload_code) * 4];
+
+		/* make sure we have a working area */
+		if (target_alloc_working_area(target, code_size,
+				&arm7_9->dcc_upload_working_area) != ERROR_OK) {
+			LOG_INFO("no working area available, falling back to memory reads");
+			return ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+		}
+
+		/* copy target instructions to target endianness */
+		target_buffer_set_u32_array(target, dcc_code_buf,
+				ARRAY_SIZE(dcc_upload_code), dcc_upload_code);
+
+		retval = arm7_9_write_memory_no_opt(target,
+				arm7_9->dcc_upload_working_area->address, 4,
+				ARRAY_SIZE(dcc_upload_code), dcc_code_buf);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	struct arm7_9_dcc_upload upload;
+	struct reg_param reg_params[2];
+
+	upload.arm_algo.common_magic = ARM_COMMON_MAGIC;
+	upload.arm_algo.core_mode = ARM_MODE_SVC;
+	upload.arm_algo.core_state = ARM_STATE_ARM;
+	upload.count = count;
+	upload.buffer = buffer;
+	upload.missed = false;
+
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[1], "r1", 32, PARAM_IN_OUT);
+
+	buf_set_u32(reg_params[0].value, 0, 32, address);
+	buf_set_u32(reg_params[1].value, 0, 32, count);
+
+	retval = armv4_5_run_algorithm_inner(target, 0, NULL, 2, reg_params,
+			arm7_9->dcc_upload_working_area->address,
+			arm7_9->dcc_upload_working_area->address + code_size - 4,
+			20*1000, &upload, arm7_9_dcc_upload_completion);
+
+	/* the caller falls back to plain memory reads */
+	if (retval == ERROR_OK && upload.missed) {
+		retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+	} else if (retval == ERROR_OK) {
+		uint32_t endaddress = buf_get_u32(reg_params[0].value, 0, 32);
+		if (endaddress != (address + count*4)) {
+			LOG_ERROR(
+				"DCC read failed, expected end address 0x%08" TARGET_PRIxADDR " got 0x%0" PRIx32 "",
+				(address + count*4),
+				endaddress);
+			retval = ERROR_FAIL;
+		}
+	}
+
+	destroy_reg_param(&reg_params[0]);
+	destroy_reg_param(&reg_params[1]);
+
+	return retval;
+}
+
 /**
  * Perform per-target setup that requires JTAG access.
  */
@@ -2682,6 +2878,14 @@ int arm7_9_examine(struct target *target)
 	return retval;
 }
 
+/**
+ * Release what the core still holds on to when the target goes away.
+ */
+void arm7_9_deinit_target(struct target *target)
+{
+	arm_sim_cache_release(target_to_arm(target));
+}
+
 
 int arm7_9_check_reset(struct target *target)
 {
@@ -2795,7 +2999,7 @@ COMMAND_HANDLER(handle_arm7_9_dcc_downloads_command)
 		COMMAND_PARSE_ENABLE(CMD_ARGV[0], arm7_9->dcc_downloads);
 
 	command_print(CMD_CTX,
-		"dcc downloads are %s",
+		"dcc downloads and uploads are %s",
 		(arm7_9->dcc_downloads) ? "enabled" : "disabled");
 
 	return ERROR_OK;
@@ -2884,7 +3088,7 @@ static const struct command_registration arm7_9_any_command_handlers[] = {
 		.handler = handle_arm7_9_dcc_downloads_command,
 		.mode = COMMAND_ANY,
 		.usage = "['enable'|'disable']",
-		.help = "use DCC downloads for larger memory writes",
+		.help = "use DCC transfers for larger memory writes and reads",
 	},
 	COMMAND_REGISTRATION_DONE
 };
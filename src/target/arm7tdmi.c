@@ -655,6 +655,7 @@ int arm7tdmi_init_arch_info(struct target *target,
 
 	arm7_9->write_memory = arm7_9_write_memory;
 	arm7_9->bulk_write_memory = arm7_9_bulk_write_memory;
+	arm7_9->bulk_read_memory = arm7_9_bulk_read_memory;
 
 	arm7_9->post_debug_entry = NULL;
 
@@ -701,10 +702,11 @@ struct target_type arm7tdmi_target = {
 
 	.get_gdb_reg_list = arm_get_gdb_reg_list,
 
-	.read_memory = arm7_9_read_memory,
+	.read_memory = arm7_9_read_memory_opt,
 	.write_memory = arm7_9_write_memory_opt,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -718,5 +720,6 @@ struct target_type arm7tdmi_target = {
 	.target_create  = arm7tdmi_target_create,
 	.init_target = arm7tdmi_init_target,
 	.examine = arm7_9_examine,
+	.deinit_target = arm7_9_deinit_target,
 	.check_reset = arm7_9_check_reset,
 };
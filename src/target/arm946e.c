@@ -764,6 +764,7 @@ struct target_type arm946e_target = {
 	.write_memory = arm946e_write_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -780,5 +781,6 @@ struct target_type arm946e_target = {
 	.target_create = arm946e_target_create,
 	.init_target = arm9tdmi_init_target,
 	.examine = arm7_9_examine,
+	.deinit_target = arm7_9_deinit_target,
 	.check_reset = arm7_9_check_reset,
 };
@@ -30,6 +30,7 @@
  */
 
 #include <helper/list.h>
+#include <helper/perf.h>
 #include "arm_jtag.h"
 
 /* three-bit ACK values for SWD access (sent LSB first) */
@@ -393,7 +394,11 @@ static inline int dap_queue_ap_abort(struct adiv5_dap *dap, uint8_t *ack)
 static inline int dap_run(struct adiv5_dap *dap)
 {
 	assert(dap->ops != NULL);
-	return dap->ops->run(dap);
+	perf_count(PERF_DAP_RUN, 1);
+	int64_t start = perf_now();
+	int retval = dap->ops->run(dap);
+	perf_record(PERF_HIST_DAP_RUN, start);
+	return retval;
 }
 
 static inline int dap_sync(struct adiv5_dap *dap)
@@ -27,6 +27,7 @@
 #include "armv4_5.h"
 #include "arm_disassembler.h"
 #include "arm_simulator.h"
+#include "breakpoints.h"
 #include <helper/binarybuffer.h>
 #include "register.h"
 #include <helper/log.h>
@@ -232,6 +233,116 @@ static int thumb_pass_branch_condition(uint32_t cpsr, uint16_t opcode)
 	return pass_condition(cpsr, (opcode & 0x0f00) << 20);
 }
 
+/* forget all cached opcodes */
+void arm_sim_cache_flush(struct arm *arm)
+{
+	for (int i = 0; i < ARM_SIM_CACHE_SIZE; i++)
+		arm->sim_cache.entry[i].size = 0;
+}
+
+/* drop the cached opcodes overlapping [address, address + size) */
+void arm_sim_cache_invalidate(struct arm *arm, uint32_t address, uint32_t size)
+{
+	for (int i = 0; i < ARM_SIM_CACHE_SIZE; i++) {
+		uint32_t start = arm->sim_cache.entry[i].address;
+		uint32_t end = start + arm->sim_cache.entry[i].size;
+
+		if (arm->sim_cache.entry[i].size && start < address + size && address < end)
+			arm->sim_cache.entry[i].size = 0;
+	}
+}
+
+static int arm_sim_cache_event(struct target *target,
+	enum target_event event, void *priv)
+{
+	struct arm *arm = priv;
+
+	if (target != arm->target)
+		return ERROR_OK;
+
+	switch (event) {
+		case TARGET_EVENT_HALTED:
+			/* a single step only ran the instruction we decoded */
+			if (target->debug_reason == DBG_REASON_SINGLESTEP)
+				break;
+			/* fall through */
+		case TARGET_EVENT_DEBUG_HALTED:
+		case TARGET_EVENT_GDB_FLASH_ERASE_END:
+		case TARGET_EVENT_GDB_FLASH_WRITE_END:
+			arm_sim_cache_flush(arm);
+			break;
+		default:
+			break;
+	}
+
+	return ERROR_OK;
+}
+
+/* drop the event callback registered by the first cached fetch */
+void arm_sim_cache_release(struct arm *arm)
+{
+	if (!arm->sim_cache.registered)
+		return;
+
+	target_unregister_event_callback(arm_sim_cache_event, arm);
+	arm->sim_cache.registered = false;
+}
+
+/* true if a software breakpoint currently patches [address, address + size) */
+static bool arm_sim_soft_breakpoint(struct target *target,
+	uint32_t address, uint32_t size)
+{
+	for (struct breakpoint *bp = target->breakpoints; bp; bp = bp->next) {
+		if (bp->type == BKPT_SOFT && bp->set
+				&& bp->address < address + size
+				&& address < bp->address + bp->length)
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Fetch the opcode at address, from the cache if possible.  Opcodes under
+ * software breakpoints aren't cached, as memory then holds the breakpoint
+ * instruction rather than the code the breakpoint was set on.
+ */
+static int arm_sim_fetch(struct target *target, uint32_t address,
+	uint32_t size, uint32_t *opcode)
+{
+	struct arm *arm = target_to_arm(target);
+	struct arm_sim_cache *cache = &arm->sim_cache;
+	unsigned i = (address >> 1) & (ARM_SIM_CACHE_SIZE - 1);
+	int retval;
+
+	if (cache->entry[i].size == size && cache->entry[i].address == address) {
+		*opcode = cache->entry[i].opcode;
+		return ERROR_OK;
+	}
+
+	if (size == 4) {
+		retval = target_read_u32(target, address, opcode);
+	} else {
+		uint16_t value;
+		retval = target_read_u16(target, address, &value);
+		*opcode = value;
+	}
+	if (retval != ERROR_OK)
+		return retval;
+
+	if (arm_sim_soft_breakpoint(target, address, size))
+		return ERROR_OK;
+
+	if (!cache->registered) {
+		target_register_event_callback(arm_sim_cache_event, arm);
+		cache->registered = true;
+	}
+	cache->entry[i].address = address;
+	cache->entry[i].opcode = *opcode;
+	cache->entry[i].size = size;
+
+	return ERROR_OK;
+}
+
 /* simulate a single step (if possible)
  * if the dry_run_pc argument is provided, no state is changed,
  * but the new pc is stored in the variable pointed at by the argument
@@ -248,7 +359,7 @@ static int arm_simulate_step_core(struct target *target,
 		uint32_t opcode;
 
 		/* get current instruction, and identify it */
-		retval = target_read_u32(target, current_pc, &opcode);
+		retval = arm_sim_fetch(target, current_pc, 4, &opcode);
 		if (retval != ERROR_OK)
 			return retval;
 		retval = arm_evaluate_opcode(opcode, current_pc, &instruction);
@@ -266,9 +377,9 @@ static int arm_simulate_step_core(struct target *target,
 			return ERROR_OK;
 		}
 	} else {
-		uint16_t opcode;
+		uint32_t opcode;
 
-		retval = target_read_u16(target, current_pc, &opcode);
+		retval = arm_sim_fetch(target, current_pc, 2, &opcode);
 		if (retval != ERROR_OK)
 			return retval;
 		retval = thumb_evaluate_opcode(opcode, current_pc, &instruction);
@@ -291,7 +402,7 @@ static int arm_simulate_step_core(struct target *target,
 		/* Deal with 32-bit BL/BLX */
 		if ((opcode & 0xf800) == 0xf000) {
 			uint32_t high = instruction.info.b_bl_bx_blx.target_address;
-			retval = target_read_u16(target, current_pc+2, &opcode);
+			retval = arm_sim_fetch(target, current_pc+2, 2, &opcode);
 			if (retval != ERROR_OK)
 				return retval;
 			retval = thumb_evaluate_opcode(opcode, current_pc, &instruction);
@@ -535,13 +646,25 @@ static int arm_simulate_step_core(struct target *target,
 				break;
 		}
 
-		for (i = 0; i < 16; i++) {
-			if (instruction.info.load_store_multiple.register_list & (1 << i)) {
-				if ((!dry_run_pc) || (i == 15))
-					target_read_u32(target, Rn, &load_values[i]);
-				Rn += 4;
+		/* fetch all the loaded words with one memory access; a dry run
+		 * only needs the new PC */
+		if (!dry_run_pc && bits_set) {
+			uint8_t buf[16 * 4];
+			int n = 0;
+
+			retval = target_read_memory(target, Rn, 4, bits_set, buf);
+			if (retval != ERROR_OK)
+				return retval;
+			for (i = 0; i < 16; i++) {
+				if (instruction.info.load_store_multiple.register_list & (1 << i))
+					load_values[i] = target_buffer_get_u32(target, buf + 4 * n++);
 			}
+		} else if (instruction.info.load_store_multiple.register_list & 0x8000) {
+			retval = target_read_u32(target, Rn + (bits_set - 1) * 4, &load_values[15]);
+			if (retval != ERROR_OK)
+				return retval;
 		}
+		Rn += bits_set * 4;
 
 		if (dry_run_pc) {
 			if (instruction.info.load_store_multiple.register_list & 0x8000) {
@@ -36,4 +36,9 @@ struct arm_sim_interface {
 /* armv4_5 version */
 int arm_simulate_step(struct target *target, uint32_t *dry_run_pc);
 
+struct arm;
+void arm_sim_cache_invalidate(struct arm *arm, uint32_t address, uint32_t size);
+void arm_sim_cache_flush(struct arm *arm);
+void arm_sim_cache_release(struct arm *arm);
+
 #endif /* OPENOCD_TARGET_ARM_SIMULATOR_H */
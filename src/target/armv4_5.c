@@ -1495,16 +1495,20 @@ int armv4_5_run_algorithm(struct target *target,
 }
 
 /**
- * Runs ARM code in the target to calculate a CRC32 checksum.
- *
+ * Runs ARM code in the target to calculate the CRC32 checksums of a list
+ * of regions; the code is uploaded once and run as few times as the
+ * working area allows.
  */
-int arm_checksum_memory(struct target *target,
-	target_addr_t address, uint32_t count, uint32_t *checksum)
+int arm_checksum_memory_regions(struct target *target,
+	struct target_checksum_region *regions, unsigned int num_regions)
 {
 	struct working_area *crc_algorithm;
+	struct working_area *region_list = NULL;
 	struct arm_algorithm arm_algo;
 	struct arm *arm = target_to_arm(target);
 	struct reg_param reg_params[2];
+	unsigned int list_len = num_regions;
+	uint8_t *list;
 	int retval;
 	uint32_t i;
 	uint32_t exit_var = 0;
@@ -1515,56 +1519,121 @@ int arm_checksum_memory(struct target *target,
 
 	assert(sizeof(arm_crc_code_le) % 4 == 0);
 
+	if (num_regions == 0)
+		return ERROR_OK;
+
 	retval = target_alloc_working_area(target,
 			sizeof(arm_crc_code_le), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* convert code into a buffer in target endianness */
-	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++) {
-		retval = target_write_u32(target,
-				crc_algorithm->address + i * sizeof(uint32_t),
+	/* convert code into a buffer in target endianness and upload it in
+	 * one transfer */
+	uint8_t arm_crc_code[sizeof(arm_crc_code_le)];
+	for (i = 0; i < ARRAY_SIZE(arm_crc_code_le) / 4; i++)
+		target_buffer_set_u32(target, &arm_crc_code[i * 4],
 				le_to_h_u32(&arm_crc_code_le[i * 4]));
-		if (retval != ERROR_OK)
+
+	retval = target_write_buffer(target, crc_algorithm->address,
+			sizeof(arm_crc_code), arm_crc_code);
+	if (retval != ERROR_OK)
+		goto cleanup;
+
+	/* an (address, count) pair per region, as many as fit */
+	while (target_alloc_working_area_try(target, list_len * 8, &region_list) != ERROR_OK) {
+		list_len /= 2;
+		if (list_len == 0) {
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
 			goto cleanup;
+		}
+	}
+
+	list = malloc(list_len * 8);
+	if (list == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup;
 	}
 
 	arm_algo.common_magic = ARM_COMMON_MAGIC;
 	arm_algo.core_mode = ARM_MODE_SVC;
 	arm_algo.core_state = ARM_STATE_ARM;
 
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
 
-	buf_set_u32(reg_params[0].value, 0, 32, address);
-	buf_set_u32(reg_params[1].value, 0, 32, count);
-
-	/* 20 second timeout/megabyte */
-	int timeout = 20000 * (1 + (count / (1024 * 1024)));
-
 	/* armv4 must exit using a hardware breakpoint */
 	if (arm->is_armv4)
 		exit_var = crc_algorithm->address + sizeof(arm_crc_code_le) - 8;
 
-	retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
-			crc_algorithm->address,
-			exit_var,
-			timeout, &arm_algo);
+	for (unsigned int r = 0; r < num_regions; r += list_len) {
+		unsigned int n = MIN(num_regions - r, list_len);
+		uint32_t total = 0;
 
-	if (retval == ERROR_OK)
-		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
-	else
-		LOG_ERROR("error executing ARM crc algorithm");
+		for (unsigned int j = 0; j < n; j++) {
+			target_buffer_set_u32(target, list + j * 8, regions[r + j].address);
+			target_buffer_set_u32(target, list + j * 8 + 4, regions[r + j].size);
+			total += regions[r + j].size;
+		}
+
+		retval = target_write_buffer(target, region_list->address, n * 8, list);
+		if (retval != ERROR_OK)
+			break;
+
+		buf_set_u32(reg_params[0].value, 0, 32, region_list->address);
+		buf_set_u32(reg_params[1].value, 0, 32, n);
+
+		/* 20 second timeout/megabyte */
+		int timeout = 20000 * (1 + (total / (1024 * 1024)));
+
+		retval = target_run_algorithm(target, 0, NULL, 2, reg_params,
+				crc_algorithm->address,
+				exit_var,
+				timeout, &arm_algo);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing ARM crc algorithm");
+			break;
+		}
+
+		/* each checksum is left in place of its address */
+		retval = target_read_buffer(target, region_list->address, n * 8, list);
+		if (retval != ERROR_OK)
+			break;
+
+		for (unsigned int j = 0; j < n; j++)
+			regions[r + j].checksum = target_buffer_get_u32(target, list + j * 8);
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
+	free(list);
 
 cleanup:
+	if (region_list)
+		target_free_working_area(target, region_list);
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/**
+ * Runs ARM code in the target to calculate a CRC32 checksum.
+ *
+ */
+int arm_checksum_memory(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct target_checksum_region region = {
+		.address = address,
+		.size = count,
+	};
+
+	int retval = arm_checksum_memory_regions(target, &region, 1);
+	if (retval == ERROR_OK)
+		*checksum = region.checksum;
+
+	return retval;
+}
+
 /**
  * Runs ARM code in the target to check whether a memory block holds
  * all ones.  NOR flash which has been erased, and thus may be written,
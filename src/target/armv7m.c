@@ -680,19 +680,26 @@ int armv7m_init_arch_info(struct target *target, struct armv7m_common *armv7m)
 	return arm_init_arch_info(target, arm);
 }
 
-/** Generates a CRC32 checksum of a memory region. */
-int armv7m_checksum_memory(struct target *target,
-	target_addr_t address, uint32_t count, uint32_t *checksum)
+/** Generates the CRC32 checksums of a list of memory regions, with one
+ * algorithm upload and as few runs as the working area allows. */
+int armv7m_checksum_memory_regions(struct target *target,
+	struct target_checksum_region *regions, unsigned int num_regions)
 {
 	struct working_area *crc_algorithm;
+	struct working_area *region_list = NULL;
 	struct armv7m_algorithm armv7m_info;
 	struct reg_param reg_params[2];
+	unsigned int list_len = num_regions;
+	uint8_t *list;
 	int retval;
 
 	static const uint8_t cortex_m_crc_code[] = {
 #include "../../contrib/loaders/checksum/armv7m_crc.inc"
 	};
 
+	if (num_regions == 0)
+		return ERROR_OK;
+
 	retval = target_alloc_working_area(target, sizeof(cortex_m_crc_code), &crc_algorithm);
 	if (retval != ERROR_OK)
 		return retval;
@@ -702,35 +709,91 @@ int armv7m_checksum_memory(struct target *target,
 	if (retval != ERROR_OK)
 		goto cleanup;
 
+	/* an (address, count) pair per region, as many as fit */
+	while (target_alloc_working_area_try(target, list_len * 8, &region_list) != ERROR_OK) {
+		list_len /= 2;
+		if (list_len == 0) {
+			retval = ERROR_TARGET_RESOURCE_NOT_AVAILABLE;
+			goto cleanup;
+		}
+	}
+
+	list = malloc(list_len * 8);
+	if (list == NULL) {
+		retval = ERROR_FAIL;
+		goto cleanup;
+	}
+
 	armv7m_info.common_magic = ARMV7M_COMMON_MAGIC;
 	armv7m_info.core_mode = ARM_MODE_THREAD;
 
-	init_reg_param(&reg_params[0], "r0", 32, PARAM_IN_OUT);
+	init_reg_param(&reg_params[0], "r0", 32, PARAM_OUT);
 	init_reg_param(&reg_params[1], "r1", 32, PARAM_OUT);
 
-	buf_set_u32(reg_params[0].value, 0, 32, address);
-	buf_set_u32(reg_params[1].value, 0, 32, count);
+	for (unsigned int i = 0; i < num_regions; i += list_len) {
+		unsigned int n = MIN(num_regions - i, list_len);
+		uint32_t total = 0;
 
-	int timeout = 20000 * (1 + (count / (1024 * 1024)));
+		for (unsigned int j = 0; j < n; j++) {
+			target_buffer_set_u32(target, list + j * 8, regions[i + j].address);
+			target_buffer_set_u32(target, list + j * 8 + 4, regions[i + j].size);
+			total += regions[i + j].size;
+		}
 
-	retval = target_run_algorithm(target, 0, NULL, 2, reg_params, crc_algorithm->address,
-			crc_algorithm->address + (sizeof(cortex_m_crc_code) - 6),
-			timeout, &armv7m_info);
+		retval = target_write_buffer(target, region_list->address, n * 8, list);
+		if (retval != ERROR_OK)
+			break;
 
-	if (retval == ERROR_OK)
-		*checksum = buf_get_u32(reg_params[0].value, 0, 32);
-	else
-		LOG_ERROR("error executing cortex_m crc algorithm");
+		buf_set_u32(reg_params[0].value, 0, 32, region_list->address);
+		buf_set_u32(reg_params[1].value, 0, 32, n);
+
+		int timeout = 20000 * (1 + (total / (1024 * 1024)));
+
+		retval = target_run_algorithm(target, 0, NULL, 2, reg_params, crc_algorithm->address,
+				crc_algorithm->address + (sizeof(cortex_m_crc_code) - 6),
+				timeout, &armv7m_info);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("error executing cortex_m crc algorithm");
+			break;
+		}
+
+		/* the algorithm leaves each checksum in place of its address */
+		retval = target_read_buffer(target, region_list->address, n * 8, list);
+		if (retval != ERROR_OK)
+			break;
+
+		for (unsigned int j = 0; j < n; j++)
+			regions[i + j].checksum = target_buffer_get_u32(target, list + j * 8);
+	}
 
 	destroy_reg_param(&reg_params[0]);
 	destroy_reg_param(&reg_params[1]);
+	free(list);
 
 cleanup:
+	if (region_list)
+		target_free_working_area(target, region_list);
 	target_free_working_area(target, crc_algorithm);
 
 	return retval;
 }
 
+/** Generates a CRC32 checksum of a memory region. */
+int armv7m_checksum_memory(struct target *target,
+	target_addr_t address, uint32_t count, uint32_t *checksum)
+{
+	struct target_checksum_region region = {
+		.address = address,
+		.size = count,
+	};
+
+	int retval = armv7m_checksum_memory_regions(target, &region, 1);
+	if (retval == ERROR_OK)
+		*checksum = region.checksum;
+
+	return retval;
+}
+
 /** Checks whether a memory region is erased. */
 int armv7m_blank_check_memory(struct target *target,
 	target_addr_t address, uint32_t count, uint32_t *blank, uint8_t erased_value)
@@ -224,6 +224,8 @@ int armv7m_restore_context(struct target *target);
 
 int armv7m_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *checksum);
+int armv7m_checksum_memory_regions(struct target *target,
+		struct target_checksum_region *regions, unsigned int num_regions);
 int armv7m_blank_check_memory(struct target *target,
 		target_addr_t address, uint32_t count, uint32_t *blank, uint8_t erased_value);
 
@@ -322,6 +322,8 @@ enum watchpoint_condition {
 #define INSTR_JUMP      0x0AF080
 /* Effective Addressing Mode Encoding */
 #define EAME_R0         0x10
+/* (r0)+ */
+#define EAME_R0_POSTINC 0x18
 /* instrcution encoder */
 /* movep
  * s - peripheral space X/Y (X=0,Y=1)
@@ -331,6 +333,16 @@ enum watchpoint_condition {
  */
 #define INSTR_MOVEP_REG_HIO(s, w, d, p) (0x084000 | \
 	((s & 1) << 16) | ((w & 1) << 15) | ((d & 0x3f) << 8) | (p & 0x3f))
+/* movep
+ * s - peripheral space X/Y (X=0,Y=1)
+ * m - memory space of the effective address X/Y/P (X=0,Y=1,P=2)
+ * w - write/read
+ * ea - effective address mode
+ * p - IO short address
+ */
+#define INSTR_MOVEP_MEM_HIO(s, m, w, ea, p) (0x084000 | \
+	((s & 1) << 16) | ((w & 1) << 15) | ((ea & 0x3f) << 8) | \
+	((m) == MEM_P ? 0x40 : 0x80 | ((m & 1) << 6)) | (p & 0x3f))
 
 /* the gdb register list is send in this order */
 static const uint8_t gdb_reg_list_idx[] = {
@@ -1499,6 +1511,29 @@ static int dsp563xx_get_default_memory(void)
 	return MEM_P;
 }
 
+/* Memory transfers are queued in blocks of this many words. Each block
+ * is flushed with a single queue execution that also reads back OSCR, to
+ * check the core is still in debug mode. */
+#define DSP563XX_MEM_BLOCK	256
+
+static int dsp563xx_mem_block_end(struct target *target)
+{
+	int err;
+	uint32_t once_status = 0;
+
+	err = dsp563xx_once_reg_read(target->tap, 1, DSP563XX_ONCE_OSCR, &once_status);
+	if (err != ERROR_OK)
+		return err;
+
+	if ((once_status & DSP563XX_ONCE_OSCR_DEBUG_M) != DSP563XX_ONCE_OSCR_DEBUG_M) {
+		LOG_ERROR("core left debug mode during memory access, OSCR 0x%06" PRIx32,
+				once_status & 0x00ffffff);
+		return ERROR_TARGET_FAILURE;
+	}
+
+	return ERROR_OK;
+}
+
 static int dsp563xx_read_memory_core(struct target *target,
 	int mem_type,
 	uint32_t address,
@@ -1526,14 +1561,12 @@ static int dsp563xx_read_memory_core(struct target *target,
 
 	switch (mem_type) {
 		case MEM_X:
-			/* TODO: mark effected queued registers */
-			move_cmd = 0x61d800;
-			break;
 		case MEM_Y:
-			move_cmd = 0x69d800;
-			break;
 		case MEM_P:
-			move_cmd = 0x07d891;
+			/* TODO: mark effected queued registers */
+			/* movep x/y/p:(r0)+,x:OGDBR moves each word straight
+			 * to the debug register */
+			move_cmd = INSTR_MOVEP_MEM_HIO(MEM_X, mem_type, 1, EAME_R0_POSTINC, 0xfffffc);
 			break;
 		default:
 			return ERROR_COMMAND_SYNTAX_ERROR;
@@ -1542,27 +1575,19 @@ static int dsp563xx_read_memory_core(struct target *target,
 	/* we use r0 to store temporary data */
 	if (!dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R0].valid)
 		dsp563xx->read_core_reg(target, DSP563XX_REG_IDX_R0);
-	/* we use r1 to store temporary data */
-	if (!dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R1].valid)
-		dsp563xx->read_core_reg(target, DSP563XX_REG_IDX_R1);
 
 	/* r0 is no longer valid on target */
 	dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R0].dirty = 1;
-	/* r1 is no longer valid on target */
-	dsp563xx->core_cache->reg_list[DSP563XX_REG_IDX_R1].dirty = 1;
 
 	x = count;
 	b = buffer;
 
-	err = dsp563xx_once_execute_dw_ir(target->tap, 1, 0x60F400, address);
+	err = dsp563xx_once_execute_dw_ir(target->tap, 0, 0x60F400, address);
 	if (err != ERROR_OK)
 		return err;
 
 	for (i = 0; i < x; i++) {
 		err = dsp563xx_once_execute_sw_ir(target->tap, 0, move_cmd);
-		if (err != ERROR_OK)
-			return err;
-		err = dsp563xx_once_execute_sw_ir(target->tap, 0, 0x08D13C);
 		if (err != ERROR_OK)
 			return err;
 		err = dsp563xx_once_reg_read(target->tap, 0,
@@ -1570,12 +1595,13 @@ static int dsp563xx_read_memory_core(struct target *target,
 		if (err != ERROR_OK)
 			return err;
 		b += 4;
-	}
 
-	/* flush the jtag queue */
-	err = jtag_execute_queue();
-	if (err != ERROR_OK)
-		return err;
+		if ((i + 1) % DSP563XX_MEM_BLOCK == 0 || i + 1 == x) {
+			err = dsp563xx_mem_block_end(target);
+			if (err != ERROR_OK)
+				return err;
+		}
+	}
 
 	/* walk over the buffer and fix target endianness */
 	b = buffer;
@@ -1736,7 +1762,7 @@ static int dsp563xx_write_memory_core(struct target *target,
 	x = count;
 	b = buffer;
 
-	err = dsp563xx_once_execute_dw_ir(target->tap, 1, 0x60F400, address);
+	err = dsp563xx_once_execute_dw_ir(target->tap, 0, 0x60F400, address);
 	if (err != ERROR_OK)
 		return err;
 
@@ -1754,12 +1780,13 @@ static int dsp563xx_write_memory_core(struct target *target,
 		if (err != ERROR_OK)
 			return err;
 		b += 4;
-	}
 
-	/* flush the jtag queue */
-	err = jtag_execute_queue();
-	if (err != ERROR_OK)
-		return err;
+		if ((i + 1) % DSP563XX_MEM_BLOCK == 0 || i + 1 == x) {
+			err = dsp563xx_mem_block_end(target);
+			if (err != ERROR_OK)
+				return err;
+		}
+	}
 
 	return ERROR_OK;
 }
@@ -451,6 +451,89 @@ int embeddedice_receive(struct arm_jtag *jtag_info, uint32_t *data, uint32_t siz
 	return jtag_execute_queue();
 }
 
+/**
+ * Receive a block of size 32-bit words from the DCC, reading the control
+ * register ahead of every word.  Unlike embeddedice_receive() this doesn't
+ * assume the target keeps up with the JTAG clock: *missed is set when the
+ * W bit was clear before any of the words, the data is then unusable and
+ * the target side of the DCC is out of step with the host.
+ */
+int embeddedice_receive_checked(struct arm_jtag *jtag_info, uint32_t *data,
+		uint32_t size, bool *missed)
+{
+	struct scan_field ctrl_fields[4];
+	struct scan_field data_fields[3];
+	uint8_t ctrl_addr[1] = { eice_regs[EICE_COMMS_CTRL].addr };
+	uint8_t data_addr[1] = { eice_regs[EICE_COMMS_DATA].addr };
+	uint8_t rw_out[1] = { 0 };
+	uint8_t *ctrl;
+	int retval;
+
+	*missed = false;
+
+	/* the low control register bits captured ahead of each word */
+	ctrl = calloc(size, 1);
+	if (ctrl == NULL)
+		return ERROR_FAIL;
+
+	retval = arm_jtag_scann(jtag_info, 0x2, TAP_IDLE);
+	if (retval == ERROR_OK)
+		retval = arm_jtag_set_instr(jtag_info->tap, jtag_info->intest_instr, NULL, TAP_IDLE);
+	if (retval != ERROR_OK) {
+		free(ctrl);
+		return retval;
+	}
+
+	/* capture R and W, skip the rest, address the data register */
+	ctrl_fields[0].num_bits = 2;
+	ctrl_fields[0].out_value = NULL;
+	ctrl_fields[1].num_bits = 30;
+	ctrl_fields[1].out_value = NULL;
+	ctrl_fields[1].in_value = NULL;
+	ctrl_fields[2].num_bits = 5;
+	ctrl_fields[2].out_value = data_addr;
+	ctrl_fields[2].in_value = NULL;
+	ctrl_fields[3].num_bits = 1;
+	ctrl_fields[3].out_value = rw_out;
+	ctrl_fields[3].in_value = NULL;
+
+	/* capture the data word, address the control register again */
+	data_fields[0].num_bits = 32;
+	data_fields[0].out_value = NULL;
+	data_fields[1].num_bits = 5;
+	data_fields[1].out_value = ctrl_addr;
+	data_fields[1].in_value = NULL;
+	data_fields[2].num_bits = 1;
+	data_fields[2].out_value = rw_out;
+	data_fields[2].in_value = NULL;
+
+	/* address the control register for the first word */
+	data_fields[0].in_value = NULL;
+	jtag_add_dr_scan(jtag_info->tap, 3, data_fields, TAP_IDLE);
+
+	for (uint32_t i = 0; i < size; i++) {
+		ctrl_fields[0].in_value = &ctrl[i];
+		jtag_add_dr_scan(jtag_info->tap, 4, ctrl_fields, TAP_IDLE);
+
+		data_fields[0].in_value = (uint8_t *)&data[i];
+		jtag_add_dr_scan(jtag_info->tap, 3, data_fields, TAP_IDLE);
+		jtag_add_callback(arm_le_to_h_u32, (jtag_callback_data_t)&data[i]);
+	}
+
+	retval = jtag_execute_queue();
+	if (retval == ERROR_OK) {
+		for (uint32_t i = 0; i < size; i++) {
+			if (!(ctrl[i] & (1 << EICE_COMM_CTRL_WBIT))) {
+				*missed = true;
+				break;
+			}
+		}
+	}
+
+	free(ctrl);
+	return retval;
+}
+
 /**
  * Queue a read for an EmbeddedICE register into the register cache,
  * not checking the value read.
@@ -205,9 +205,7 @@ static int etb_read_ram(struct etb *etb, uint32_t *data, int num_frames)
 		jtag_add_callback(etb_getbuf, (jtag_callback_data_t)(data + i));
 	}
 
-	jtag_execute_queue();
-
-	return ERROR_OK;
+	return jtag_execute_queue();
 }
 
 static int etb_read_reg_w_check(struct reg *reg,
@@ -516,17 +514,60 @@ static trace_status_t etb_status(struct etm_context *etm_ctx)
 	return retval;
 }
 
+static void etb_unpack(struct etmv1_trace_data *trace_data,
+	uint8_t pipestat, uint32_t packet, int sync)
+{
+	trace_data->pipestat = pipestat;
+	trace_data->packet = packet;
+	trace_data->flags = 0;
+	if (sync)
+		trace_data->flags |= ETMV1_TRACESYNC_CYCLE;
+	if (trace_data->pipestat == STAT_TR) {
+		trace_data->pipestat = trace_data->packet & 0x7;
+		trace_data->flags |= ETMV1_TRIGGER_CYCLE;
+	}
+}
+
+/* unpack one ETB frame, returns the number of trace words it held */
+static int etb_unpack_frame(struct etm_context *etm_ctx, uint32_t frame,
+	struct etmv1_trace_data *trace_data)
+{
+	if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT) {
+		etb_unpack(&trace_data[0], frame & 0x7, (frame & 0x78) >> 3,
+			(frame & 0x80) >> 7);
+		etb_unpack(&trace_data[1], (frame & 0x100) >> 8, (frame & 0x7800) >> 11,
+			(frame & 0x8000) >> 15);
+		etb_unpack(&trace_data[2], (frame & 0x10000) >> 16, (frame & 0x780000) >> 19,
+			(frame & 0x800000) >> 23);
+		return 3;
+	} else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT) {
+		etb_unpack(&trace_data[0], frame & 0x7, (frame & 0x7f8) >> 3,
+			(frame & 0x800) >> 11);
+		etb_unpack(&trace_data[1], (frame & 0x7000) >> 12, (frame & 0x7f8000) >> 15,
+			(frame & 0x800000) >> 23);
+		return 2;
+	} else {
+		etb_unpack(&trace_data[0], frame & 0x7, (frame & 0x7fff8) >> 3,
+			(frame & 0x80000) >> 19);
+		return 1;
+	}
+}
+
 static int etb_read_trace(struct etm_context *etm_ctx)
 {
 	struct etb *etb = etm_ctx->capture_driver_priv;
 	int first_frame = 0;
 	int num_frames = etb->ram_depth;
-	uint32_t *trace_data = NULL;
+	uint32_t *frames;
+	int words_per_frame;
+	int retval;
 	int i, j;
 
 	etb_read_reg(&etb->reg_cache->reg_list[ETB_STATUS]);
 	etb_read_reg(&etb->reg_cache->reg_list[ETB_RAM_WRITE_POINTER]);
-	jtag_execute_queue();
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* check if we overflowed, and adjust first frame of the trace accordingly
 	 * if we didn't overflow, read only up to the frame that would be written next,
@@ -543,105 +584,47 @@ static int etb_read_trace(struct etm_context *etm_ctx)
 
 	etb_write_reg(&etb->reg_cache->reg_list[ETB_RAM_READ_POINTER], first_frame);
 
-	/* read data into temporary array for unpacking */
-	trace_data = malloc(sizeof(uint32_t) * num_frames);
-	etb_read_ram(etb, trace_data, num_frames);
-
 	if (etm_ctx->trace_depth > 0)
 		free(etm_ctx->trace_data);
+	etm_ctx->trace_data = NULL;
+	etm_ctx->trace_depth = 0;
 
 	if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT)
-		etm_ctx->trace_depth = num_frames * 3;
+		words_per_frame = 3;
 	else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT)
-		etm_ctx->trace_depth = num_frames * 2;
+		words_per_frame = 2;
 	else
-		etm_ctx->trace_depth = num_frames;
-
-	etm_ctx->trace_data = malloc(sizeof(struct etmv1_trace_data) * etm_ctx->trace_depth);
-
-	for (i = 0, j = 0; i < num_frames; i++) {
-		if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_4BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x78) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80) >> 7)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x100) >> 8;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7800) >> 11;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x8000) >> 15)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 2 */
-			etm_ctx->trace_data[j + 2].pipestat = (trace_data[i] & 0x10000) >> 16;
-			etm_ctx->trace_data[j + 2].packet = (trace_data[i] & 0x780000) >> 19;
-			etm_ctx->trace_data[j + 2].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 2].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				2].pipestat = etm_ctx->trace_data[j + 2].packet & 0x7;
-				etm_ctx->trace_data[j + 2].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 3;
-		} else if ((etm_ctx->control & ETM_PORT_WIDTH_MASK) == ETM_PORT_8BIT) {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7f8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x800) >> 11)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			/* trace word j + 1 */
-			etm_ctx->trace_data[j + 1].pipestat = (trace_data[i] & 0x7000) >> 12;
-			etm_ctx->trace_data[j + 1].packet = (trace_data[i] & 0x7f8000) >> 15;
-			etm_ctx->trace_data[j + 1].flags = 0;
-			if ((trace_data[i] & 0x800000) >> 23)
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j + 1].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j +
-				1].pipestat = etm_ctx->trace_data[j + 1].packet & 0x7;
-				etm_ctx->trace_data[j + 1].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 2;
-		} else {
-			/* trace word j */
-			etm_ctx->trace_data[j].pipestat = trace_data[i] & 0x7;
-			etm_ctx->trace_data[j].packet = (trace_data[i] & 0x7fff8) >> 3;
-			etm_ctx->trace_data[j].flags = 0;
-			if ((trace_data[i] & 0x80000) >> 19)
-				etm_ctx->trace_data[j].flags |= ETMV1_TRACESYNC_CYCLE;
-			if (etm_ctx->trace_data[j].pipestat == STAT_TR) {
-				etm_ctx->trace_data[j].pipestat = etm_ctx->trace_data[j].packet &
-					0x7;
-				etm_ctx->trace_data[j].flags |= ETMV1_TRIGGER_CYCLE;
-			}
-
-			j += 1;
-		}
+		words_per_frame = 1;
+
+	if (num_frames == 0)
+		return ERROR_OK;
+
+	/* the read pointer auto-increments: one address write and one queue
+	 * flush for the whole RAM */
+	frames = malloc(sizeof(uint32_t) * num_frames);
+	if (frames == NULL) {
+		LOG_ERROR("unable to allocate ETB frame buffer");
+		return ERROR_FAIL;
+	}
+
+	retval = etb_read_ram(etb, frames, num_frames);
+	if (retval != ERROR_OK) {
+		free(frames);
+		return retval;
 	}
 
-	free(trace_data);
+	etm_ctx->trace_data = malloc(sizeof(struct etmv1_trace_data) * num_frames * words_per_frame);
+	if (etm_ctx->trace_data == NULL) {
+		LOG_ERROR("unable to allocate trace buffer");
+		free(frames);
+		return ERROR_FAIL;
+	}
+
+	for (i = 0, j = 0; i < num_frames; i++)
+		j += etb_unpack_frame(etm_ctx, frames[i], &etm_ctx->trace_data[j]);
+	etm_ctx->trace_depth = j;
+
+	free(frames);
 
 	return ERROR_OK;
 }
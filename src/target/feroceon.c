@@ -716,6 +716,7 @@ struct target_type feroceon_target = {
 	.write_memory = arm7_9_write_memory_opt,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -729,6 +730,7 @@ struct target_type feroceon_target = {
 	.target_create = feroceon_target_create,
 	.init_target = feroceon_init_target,
 	.examine = feroceon_examine,
+	.deinit_target = arm7_9_deinit_target,
 };
 
 struct target_type dragonite_target = {
@@ -753,6 +755,7 @@ struct target_type dragonite_target = {
 	.write_memory = arm7_9_write_memory_opt,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -766,4 +769,5 @@ struct target_type dragonite_target = {
 	.target_create = dragonite_target_create,
 	.init_target = feroceon_init_target,
 	.examine = feroceon_examine,
+	.deinit_target = arm7_9_deinit_target,
 };
@@ -804,6 +804,7 @@ struct target_type hla_target = {
 	.read_memory = adapter_read_memory,
 	.write_memory = adapter_write_memory,
 	.checksum_memory = armv7m_checksum_memory,
+	.checksum_memory_regions = armv7m_checksum_memory_regions,
 	.blank_check_memory = armv7m_blank_check_memory,
 
 	.run_algorithm = armv7m_run_algorithm,
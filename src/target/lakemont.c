@@ -58,6 +58,7 @@ static int read_all_core_hw_regs(struct target *t);
 static int write_all_core_hw_regs(struct target *t);
 static int read_hw_reg(struct target *t,
 			int reg, uint32_t *regval, uint8_t cache);
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *regval);
 static int write_hw_reg(struct target *t,
 			int reg, uint32_t regval, uint8_t cache);
 static struct reg_cache *lakemont_build_reg_cache
@@ -65,6 +66,7 @@ static struct reg_cache *lakemont_build_reg_cache
 static int submit_reg_pir(struct target *t, int num);
 static int submit_instruction_pir(struct target *t, int num);
 static int submit_pir(struct target *t, uint64_t op);
+static int queue_tapstatus(struct target *t, uint8_t *tapstatus);
 static int lakemont_get_core_reg(struct reg *reg);
 static int lakemont_set_core_reg(struct reg *reg, uint8_t *buf);
 
@@ -433,12 +435,30 @@ struct reg_cache *lakemont_build_reg_cache(struct target *t)
 
 static uint32_t get_tapstatus(struct target *t)
 {
-	scan.out[0] = TAPSTATUS;
-	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t tapstatus[TS_SIZE / 8];
+	int flush = x86_32->flush;
+	x86_32->flush = 0;
+	int err = queue_tapstatus(t, tapstatus);
+	x86_32->flush = flush;
+	if (err != ERROR_OK)
 		return 0;
-	if (drscan(t, NULL, scan.out, TS_SIZE) != ERROR_OK)
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return 0;
-	return buf_get_u32(scan.out, 0, 32);
+	}
+	return buf_get_u32(tapstatus, 0, 32);
+}
+
+/* queue a TAPSTATUS read into tapstatus, valid after the next queue flush */
+static int queue_tapstatus(struct target *t, uint8_t *tapstatus)
+{
+	scan.out[0] = TAPSTATUS;
+	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		return ERROR_FAIL;
+	if (drscan(t, NULL, tapstatus, TS_SIZE) != ERROR_OK)
+		return ERROR_FAIL;
+	return ERROR_OK;
 }
 
 static int enter_probemode(struct target *t)
@@ -600,31 +620,60 @@ static int do_resume(struct target *t)
 	return target_call_event_callbacks(t, TARGET_EVENT_RESUMED);
 }
 
+/*
+ * queue the reads of all registers and flush once, the values are only
+ * extracted into the reg cache after the whole batch has been scanned
+ */
 static int read_all_core_hw_regs(struct target *t)
 {
-	int err;
-	uint32_t regval;
+	int err = ERROR_OK;
 	unsigned i;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t values[ARRAY_SIZE(regs)][PDR_SIZE / 8];
+
+	x86_32->flush = 0; /* dont flush scans till we have a batch */
 	for (i = 0; i < (x86_32->cache->num_regs); i++) {
 		if (NOT_AVAIL_REG == regs[i].pm_idx)
 			continue;
-		err = read_hw_reg(t, regs[i].id, &regval, 1);
+		err = queue_read_hw_reg(t, regs[i].id, values[i]);
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error saving reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
-			return err;
+			break;
 		}
 	}
+	x86_32->flush = 1;
+	if (err != ERROR_OK)
+		return err;
+
+	err = jtag_execute_queue();
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return err;
+	}
+
+	for (i = 0; i < (x86_32->cache->num_regs); i++) {
+		if (NOT_AVAIL_REG == regs[i].pm_idx)
+			continue;
+		struct reg *reg = &x86_32->cache->reg_list[regs[i].id];
+		uint32_t regval = buf_get_u32(values[i], 0, 32);
+		buf_set_u32(reg->value, 0, 32, regval);
+		reg->valid = 1;
+		reg->dirty = 0;
+		LOG_DEBUG("reg=%s, op=0x%016" PRIx64 ", val=0x%08" PRIx32,
+				reg->name, regs[i].op, regval);
+	}
 	LOG_DEBUG("read_all_core_hw_regs read %u registers ok", i);
 	return ERROR_OK;
 }
 
 static int write_all_core_hw_regs(struct target *t)
 {
-	int err;
+	int err = ERROR_OK;
 	unsigned i;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+
+	x86_32->flush = 0; /* dont flush scans till we have a batch */
 	for (i = 0; i < (x86_32->cache->num_regs); i++) {
 		if (NOT_AVAIL_REG == regs[i].pm_idx)
 			continue;
@@ -632,35 +681,65 @@ static int write_all_core_hw_regs(struct target *t)
 		if (err != ERROR_OK) {
 			LOG_ERROR("%s error restoring reg %s",
 					__func__, x86_32->cache->reg_list[i].name);
-			return err;
+			break;
 		}
 	}
+	x86_32->flush = 1;
+	if (err != ERROR_OK)
+		return err;
+
+	err = jtag_execute_queue();
+	if (err != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
+		return err;
+	}
 	LOG_DEBUG("write_all_core_hw_regs wrote %u registers ok", i);
 	return ERROR_OK;
 }
 
-/* read reg from lakemont core shadow ram, update reg cache if needed */
-static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+/*
+ * queue the scans reading reg from lakemont core shadow ram into regval
+ * (PDR_SIZE bits), the value is only valid after the next queue flush
+ */
+static int queue_read_hw_reg(struct target *t, int reg, uint8_t *regval)
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
-	struct lakemont_core_reg *arch_info;
-	arch_info = x86_32->cache->reg_list[reg].arch_info;
-	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	int flush = x86_32->flush;
+	int err = ERROR_FAIL;
+
+	x86_32->flush = 0;
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto out;
 	if (submit_instruction_pir(t, SRAM2PDR) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto out;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
+		goto out;
+	if (drscan(t, NULL, regval, PDR_SIZE) != ERROR_OK)
+		goto out;
+	jtag_add_sleep(DELAY_SUBMITPIR);
+	err = ERROR_OK;
+out:
+	x86_32->flush = flush;
+	return err;
+}
+
+/* read reg from lakemont core shadow ram, update reg cache if needed */
+static int read_hw_reg(struct target *t, int reg, uint32_t *regval, uint8_t cache)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	struct lakemont_core_reg *arch_info;
+	arch_info = x86_32->cache->reg_list[reg].arch_info;
+	uint8_t pdr[PDR_SIZE / 8];
+	if (queue_read_hw_reg(t, reg, pdr) != ERROR_OK)
 		return ERROR_FAIL;
-	if (drscan(t, NULL, scan.out, PDR_SIZE) != ERROR_OK)
+	if (jtag_execute_queue() != ERROR_OK) {
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return ERROR_FAIL;
-
-	jtag_add_sleep(DELAY_SUBMITPIR);
-	*regval = buf_get_u32(scan.out, 0, 32);
+	}
+	*regval = buf_get_u32(pdr, 0, 32);
 	if (cache) {
 		buf_set_u32(x86_32->cache->reg_list[reg].value, 0, 32, *regval);
 		x86_32->cache->reg_list[reg].valid = 1;
@@ -689,17 +768,19 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 			arch_info->op,
 			regval);
 
-	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	/* only the last scan flushes, and only if the caller isn't batching */
+	int flush = x86_32->flush;
+	x86_32->flush = 0;
 	if (submit_reg_pir(t, reg) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	if (submit_instruction_pir(t, SRAMACCESS) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	scan.out[0] = RDWRPDR;
 	if (irscan(t, scan.out, NULL, LMT_IRLEN) != ERROR_OK)
-		return ERROR_FAIL;
+		goto fail;
 	if (drscan(t, reg_buf, scan.out, PDR_SIZE) != ERROR_OK)
-		return ERROR_FAIL;
-	x86_32->flush = 1;
+		goto fail;
+	x86_32->flush = flush;
 	if (submit_instruction_pir(t, PDR2SRAM) != ERROR_OK)
 		return ERROR_FAIL;
 
@@ -709,6 +790,10 @@ static int write_hw_reg(struct target *t, int reg, uint32_t regval, uint8_t cach
 		x86_32->cache->reg_list[reg].valid = 0;
 	}
 	return ERROR_OK;
+
+fail:
+	x86_32->flush = flush;
+	return ERROR_FAIL;
 }
 
 static bool is_paging_enabled(struct target *t)
@@ -759,9 +844,8 @@ static bool sw_bpts_supported(struct target *t)
 		return false;
 }
 
-static int transaction_status(struct target *t)
+static int check_transaction_status(struct target *t, uint32_t tapstatus)
 {
-	uint32_t tapstatus = get_tapstatus(t);
 	if ((TS_EN_PM_BIT | TS_PRDY_BIT) & tapstatus) {
 		LOG_ERROR("%s transaction error tapstatus = 0x%08" PRIx32
 				, __func__, tapstatus);
@@ -771,6 +855,11 @@ static int transaction_status(struct target *t)
 	}
 }
 
+static int transaction_status(struct target *t)
+{
+	return check_transaction_status(t, get_tapstatus(t));
+}
+
 static int submit_instruction(struct target *t, int num)
 {
 	int err = submit_instruction_pir(t, num);
@@ -842,6 +931,9 @@ int lakemont_init_arch_info(struct target *t, struct x86_32_common *x86_32)
 	x86_32->submit_instruction = submit_instruction;
 	x86_32->transaction_status = transaction_status;
 	x86_32->read_hw_reg = read_hw_reg;
+	x86_32->queue_read_hw_reg = queue_read_hw_reg;
+	x86_32->queue_tapstatus = queue_tapstatus;
+	x86_32->check_transaction_status = check_transaction_status;
 	x86_32->write_hw_reg = write_hw_reg;
 	x86_32->sw_bpts_supported = sw_bpts_supported;
 	x86_32->get_num_user_regs = get_num_user_regs;
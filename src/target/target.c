@@ -42,6 +42,7 @@
 #endif
 
 #include <helper/time_support.h>
+#include <helper/perf.h>
 #include <jtag/jtag.h>
 #include <flash/nor/core.h>
 
@@ -798,12 +799,14 @@ int target_run_algorithm(struct target *target,
 		goto done;
 	}
 
+	int64_t start = perf_now();
 	target->running_alg = true;
 	retval = target->type->run_algorithm(target,
 			num_mem_params, mem_params,
 			num_reg_params, reg_param,
 			entry_point, exit_point, timeout_ms, arch_info);
 	target->running_alg = false;
+	perf_record(PERF_HIST_RUN_ALGORITHM, start);
 
 done:
 	return retval;
@@ -1572,7 +1575,9 @@ static int target_timer_callback_periodic_restart(
 static int target_call_timer_callback(struct target_timer_callback *cb,
 		struct timeval *now)
 {
+	int64_t start = perf_now();
 	cb->callback(cb->priv);
+	perf_record(PERF_HIST_TIMER_CALLBACK, start);
 
 	if (cb->periodic)
 		return target_timer_callback_periodic_restart(cb, now);
@@ -2066,6 +2071,7 @@ int target_write_buffer(struct target *target, target_addr_t address, uint32_t s
 		return ERROR_FAIL;
 	}
 
+	perf_count(PERF_TARGET_WRITE_BYTES, size);
 	return target->type->write_buffer(target, address, size, buffer);
 }
 
@@ -2128,6 +2134,7 @@ int target_read_buffer(struct target *target, target_addr_t address, uint32_t si
 		return ERROR_FAIL;
 	}
 
+	perf_count(PERF_TARGET_READ_BYTES, size);
 	return target->type->read_buffer(target, address, size, buffer);
 }
 
@@ -2204,6 +2211,33 @@ int target_checksum_memory(struct target *target, target_addr_t address, uint32_
 	return retval;
 }
 
+int target_checksum_memory_regions(struct target *target,
+		struct target_checksum_region *regions, unsigned int num_regions)
+{
+	int retval;
+
+	if (!target_was_examined(target)) {
+		LOG_ERROR("Target not examined yet");
+		return ERROR_FAIL;
+	}
+
+	if (target->type->checksum_memory_regions) {
+		retval = target->type->checksum_memory_regions(target, regions, num_regions);
+		if (retval == ERROR_OK)
+			return ERROR_OK;
+		LOG_DEBUG("checksumming the regions one by one");
+	}
+
+	for (unsigned int i = 0; i < num_regions; i++) {
+		retval = target_checksum_memory(target, regions[i].address,
+				regions[i].size, &regions[i].checksum);
+		if (retval != ERROR_OK)
+			return retval;
+	}
+
+	return ERROR_OK;
+}
+
 int target_blank_check_memory(struct target *target, target_addr_t address, uint32_t size, uint32_t* blank,
 	uint8_t erased_value)
 {
@@ -3352,6 +3386,109 @@ COMMAND_HANDLER(handle_load_image_command)
 
 }
 
+enum dump_image_format {
+	DUMP_IMAGE_BIN,
+	DUMP_IMAGE_IHEX,
+};
+
+/* amount of target memory read per target_read_buffer() call */
+#define DUMP_IMAGE_CHUNK	0x10000
+/* blank blocks of this size are left out of sparse binary dumps */
+#define DUMP_IMAGE_SPARSE_BLOCK	0x1000
+#define DUMP_IMAGE_IHEX_RECORD	16
+
+static bool dump_image_is_blank(const uint8_t *buffer, uint32_t size, bool ff_is_blank)
+{
+	if (buffer[0] != 0x00 && !(ff_is_blank && buffer[0] == 0xff))
+		return false;
+	for (uint32_t i = 1; i < size; i++)
+		if (buffer[i] != buffer[0])
+			return false;
+	return true;
+}
+
+static int dump_image_write_ihex_record(struct fileio *fileio, uint8_t type,
+		uint16_t address, const uint8_t *data, uint8_t len)
+{
+	char line[1 + 2 * (4 + 255 + 1) + 2];
+	uint8_t sum = len + (address >> 8) + (address & 0xff) + type;
+	int n;
+	size_t size_written;
+
+	n = sprintf(line, ":%02X%04X%02X", len, address, type);
+	for (uint8_t i = 0; i < len; i++) {
+		n += sprintf(line + n, "%02X", data[i]);
+		sum += data[i];
+	}
+	n += sprintf(line + n, "%02X\n", (uint8_t)-sum);
+
+	return fileio_write(fileio, n, line, &size_written);
+}
+
+/* Writes @a size bytes at @a address as Intel hex data records, emitting
+ * an extended linear address record whenever the upper 16 bits change. */
+static int dump_image_write_ihex(struct fileio *fileio, uint32_t address,
+		const uint8_t *buffer, uint32_t size, bool sparse, uint32_t *upper)
+{
+	int retval = ERROR_OK;
+
+	while (size > 0) {
+		uint32_t len = MIN(size, DUMP_IMAGE_IHEX_RECORD);
+		len = MIN(len, 0x10000 - (address & 0xffff));
+
+		if (!(sparse && dump_image_is_blank(buffer, len, true))) {
+			if ((address >> 16) != *upper) {
+				uint8_t ela[2];
+				*upper = address >> 16;
+				h_u16_to_be(ela, *upper);
+				retval = dump_image_write_ihex_record(fileio, 0x04, 0, ela, 2);
+				if (retval != ERROR_OK)
+					return retval;
+			}
+			retval = dump_image_write_ihex_record(fileio, 0x00,
+					address & 0xffff, buffer, len);
+			if (retval != ERROR_OK)
+				return retval;
+		}
+
+		address += len;
+		buffer += len;
+		size -= len;
+	}
+
+	return retval;
+}
+
+/* Writes a binary chunk at file offset @a offset.  In sparse mode blocks of
+ * zeros are seeked over, which leaves holes on filesystems supporting them. */
+static int dump_image_write_bin(struct fileio *fileio, size_t offset,
+		const uint8_t *buffer, uint32_t size, bool sparse, bool *hole)
+{
+	size_t size_written;
+	int retval;
+
+	if (!sparse)
+		return fileio_write(fileio, size, buffer, &size_written);
+
+	while (size > 0) {
+		uint32_t len = MIN(size, DUMP_IMAGE_SPARSE_BLOCK);
+
+		*hole = dump_image_is_blank(buffer, len, false);
+		if (*hole)
+			retval = fileio_seek(fileio, offset + len);
+		else
+			retval = fileio_write(fileio, len, buffer, &size_written);
+		if (retval != ERROR_OK)
+			return retval;
+
+		offset += len;
+		buffer += len;
+		size -= len;
+	}
+
+	return ERROR_OK;
+}
+
 COMMAND_HANDLER(handle_dump_image_command)
 {
 	struct fileio *fileio;
@@ -3360,19 +3497,38 @@ COMMAND_HANDLER(handle_dump_image_command)
 	target_addr_t address, size;
 	struct duration bench;
 	struct target *target = get_current_target(CMD_CTX);
+	enum dump_image_format format = DUMP_IMAGE_BIN;
+	bool sparse = false;
 
-	if (CMD_ARGC != 3)
+	if (CMD_ARGC < 3 || CMD_ARGC > 5)
 		return ERROR_COMMAND_SYNTAX_ERROR;
 
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[1], address);
 	COMMAND_PARSE_ADDRESS(CMD_ARGV[2], size);
 
-	uint32_t buf_size = (size > 4096) ? 4096 : size;
+	for (unsigned i = 3; i < CMD_ARGC; i++) {
+		if (strcmp(CMD_ARGV[i], "bin") == 0)
+			format = DUMP_IMAGE_BIN;
+		else if (strcmp(CMD_ARGV[i], "ihex") == 0)
+			format = DUMP_IMAGE_IHEX;
+		else if (strcmp(CMD_ARGV[i], "sparse") == 0)
+			sparse = true;
+		else
+			return ERROR_COMMAND_SYNTAX_ERROR;
+	}
+
+	if (format == DUMP_IMAGE_IHEX && (uint64_t)address + size > 0x100000000ULL) {
+		command_print(CMD_CTX, "ihex dumps are limited to a 32-bit address range");
+		return ERROR_COMMAND_ARGUMENT_INVALID;
+	}
+
+	uint32_t buf_size = (size > DUMP_IMAGE_CHUNK) ? DUMP_IMAGE_CHUNK : size;
 	buffer = malloc(buf_size);
 	if (!buffer)
 		return ERROR_FAIL;
 
-	retval = fileio_open(&fileio, CMD_ARGV[0], FILEIO_WRITE, FILEIO_BINARY);
+	retval = fileio_open(&fileio, CMD_ARGV[0], FILEIO_WRITE,
+			(format == DUMP_IMAGE_IHEX) ? FILEIO_TEXT : FILEIO_BINARY);
 	if (retval != ERROR_OK) {
 		free(buffer);
 		return retval;
@@ -3380,31 +3536,48 @@ COMMAND_HANDLER(handle_dump_image_command)
 
 	duration_start(&bench);
 
+	size_t dumped = 0;
+	uint32_t ihex_upper = 0;
+	bool hole = false;
 	while (size > 0) {
-		size_t size_written;
 		uint32_t this_run_size = (size > buf_size) ? buf_size : size;
 		retval = target_read_buffer(target, address, this_run_size, buffer);
 		if (retval != ERROR_OK)
 			break;
 
-		retval = fileio_write(fileio, this_run_size, buffer, &size_written);
+		if (format == DUMP_IMAGE_IHEX)
+			retval = dump_image_write_ihex(fileio, address, buffer,
+					this_run_size, sparse, &ihex_upper);
+		else
+			retval = dump_image_write_bin(fileio, dumped, buffer,
+					this_run_size, sparse, &hole);
 		if (retval != ERROR_OK)
 			break;
 
 		size -= this_run_size;
 		address += this_run_size;
+		dumped += this_run_size;
+		keep_alive();
+	}
+
+	if (retval == ERROR_OK && format == DUMP_IMAGE_IHEX)
+		retval = dump_image_write_ihex_record(fileio, 0x01, 0, NULL, 0);
+
+	/* a trailing hole doesn't extend the file, write its last byte */
+	if (retval == ERROR_OK && hole) {
+		const uint8_t zero = 0;
+		size_t size_written;
+		retval = fileio_seek(fileio, dumped - 1);
+		if (retval == ERROR_OK)
+			retval = fileio_write(fileio, 1, &zero, &size_written);
 	}
 
 	free(buffer);
 
 	if ((ERROR_OK == retval) && (duration_measure(&bench) == ERROR_OK)) {
-		size_t filesize;
-		retval = fileio_size(fileio, &filesize);
-		if (retval != ERROR_OK)
-			return retval;
 		command_print(CMD_CTX,
-				"dumped %zu bytes in %fs (%0.3f KiB/s)", filesize,
-				duration_elapsed(&bench), duration_kbps(&bench, filesize));
+				"dumped %zu bytes in %fs (%0.3f KiB/s)", dumped,
+				duration_elapsed(&bench), duration_kbps(&bench, dumped));
 	}
 
 	retvaltemp = fileio_close(fileio);
@@ -3420,15 +3593,140 @@ enum verify_mode {
 	IMAGE_CHECKSUM_ONLY = 2
 };
 
+#define VERIFY_IMAGE_MAX_DIFFS	128
+/* mismatching regions are narrowed down with checksums of this size */
+#define VERIFY_IMAGE_CHUNK	0x4000
+
+/* Binary compare of a region whose checksum did not match.  Large regions
+ * are checksummed chunk by chunk first, all chunks in one go, so only
+ * mismatching chunks are read back. */
+static int verify_image_compare(struct command_context *cmd_ctx, struct target *target,
+		target_addr_t address, const uint8_t *buffer, uint32_t size, int *diffs)
+{
+	uint32_t num_chunks = DIV_ROUND_UP(size, VERIFY_IMAGE_CHUNK);
+	struct target_checksum_region *chunks = NULL;
+	uint32_t this_size = MIN(size, VERIFY_IMAGE_CHUNK);
+	uint8_t *data;
+	int retval = ERROR_OK;
+
+	data = malloc(this_size);
+	if (data == NULL)
+		return ERROR_FAIL;
+
+	if (num_chunks > 1) {
+		chunks = calloc(num_chunks, sizeof(*chunks));
+		if (chunks == NULL) {
+			free(data);
+			return ERROR_FAIL;
+		}
+		for (uint32_t c = 0; c < num_chunks; c++) {
+			chunks[c].address = address + c * VERIFY_IMAGE_CHUNK;
+			chunks[c].size = MIN(size - c * VERIFY_IMAGE_CHUNK, VERIFY_IMAGE_CHUNK);
+		}
+		retval = target_checksum_memory_regions(target, chunks, num_chunks);
+		if (retval != ERROR_OK)
+			goto out;
+	}
+
+	for (uint32_t offset = 0, c = 0; offset < size; offset += this_size, c++) {
+		this_size = MIN(size - offset, VERIFY_IMAGE_CHUNK);
+
+		if (chunks) {
+			uint32_t checksum;
+
+			retval = image_calculate_checksum((uint8_t *)buffer + offset, this_size, &checksum);
+			if (retval != ERROR_OK)
+				break;
+			if (checksum == chunks[c].checksum)
+				continue;
+		}
+
+		/* Can we use 32bit word accesses? */
+		int access_size = 1;
+		int count = this_size;
+		if ((count % 4) == 0) {
+			access_size *= 4;
+			count /= 4;
+		}
+		retval = target_read_memory(target, address + offset, access_size, count, data);
+		if (retval != ERROR_OK)
+			break;
+
+		for (uint32_t t = 0; t < this_size; t++) {
+			if (data[t] != buffer[offset + t]) {
+				command_print(cmd_ctx,
+							  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
+							  *diffs,
+							  (unsigned)(address + offset + t),
+							  data[t],
+							  buffer[offset + t]);
+				if (++*diffs >= VERIFY_IMAGE_MAX_DIFFS)
+					break;
+			}
+		}
+		if (*diffs >= VERIFY_IMAGE_MAX_DIFFS)
+			break;
+		keep_alive();
+	}
+
+out:
+	free(chunks);
+	free(data);
+
+	return retval;
+}
+
+/* read @a sections image sections starting at @a first into a new buffer */
+static int verify_image_read(struct command_context *cmd_ctx, struct image *image,
+		int first, int sections, uint32_t size, uint8_t **buffer, size_t *buf_cnt)
+{
+	int retval = ERROR_OK;
+
+	*buffer = malloc(size);
+	if (*buffer == NULL) {
+		command_print(cmd_ctx,
+				"error allocating buffer for section (%d bytes)",
+				(int)size);
+		return ERROR_FAIL;
+	}
+
+	*buf_cnt = 0;
+	for (int j = first; j < first + sections; j++) {
+		size_t section_cnt;
+		retval = image_read_section(image, j, 0x0, image->sections[j].size,
+				*buffer + *buf_cnt, &section_cnt);
+		if (retval != ERROR_OK)
+			break;
+		*buf_cnt += section_cnt;
+	}
+
+	if (retval != ERROR_OK) {
+		free(*buffer);
+		*buffer = NULL;
+	}
+
+	return retval;
+}
+
+/* the image sections behind one checksummed region */
+struct verify_image_region {
+	int first;
+	int sections;
+	uint32_t checksum;
+};
+
 static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode verify)
 {
 	uint8_t *buffer;
 	size_t buf_cnt;
 	uint32_t image_size;
 	int i;
+	int sections;
 	int retval;
-	uint32_t checksum = 0;
-	uint32_t mem_checksum = 0;
+	struct target_checksum_region *regions = NULL;
+	struct verify_image_region *info = NULL;
+	int num_regions = 0;
+	int diffs = 0;
 
 	struct image image;
 
@@ -3461,81 +3759,45 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 	if (retval != ERROR_OK)
 		return retval;
 
+	regions = calloc(image.num_sections, sizeof(*regions));
+	info = calloc(image.num_sections, sizeof(*info));
+	if (image.num_sections && (regions == NULL || info == NULL)) {
+		LOG_ERROR("Out of memory");
+		retval = ERROR_FAIL;
+		goto done;
+	}
+
 	image_size = 0x0;
-	int diffs = 0;
-	retval = ERROR_OK;
-	for (i = 0; i < image.num_sections; i++) {
-		buffer = malloc(image.sections[i].size);
-		if (buffer == NULL) {
-			command_print(CMD_CTX,
-					"error allocating buffer for section (%d bytes)",
-					(int)(image.sections[i].size));
-			break;
+	for (i = 0; i < image.num_sections; i += sections) {
+		target_addr_t address = image.sections[i].base_address;
+		uint32_t region_size = image.sections[i].size;
+
+		/* verify contiguous sections as one region */
+		sections = 1;
+		while (verify >= IMAGE_VERIFY && i + sections < image.num_sections
+				&& image.sections[i + sections].base_address == address + region_size
+				&& region_size + image.sections[i + sections].size > region_size) {
+			region_size += image.sections[i + sections].size;
+			sections++;
 		}
-		retval = image_read_section(&image, i, 0x0, image.sections[i].size, buffer, &buf_cnt);
-		if (retval != ERROR_OK) {
-			free(buffer);
+
+		retval = verify_image_read(CMD_CTX, &image, i, sections, region_size,
+				&buffer, &buf_cnt);
+		if (retval != ERROR_OK)
 			break;
-		}
 
 		if (verify >= IMAGE_VERIFY) {
-			/* calculate checksum of image */
-			retval = image_calculate_checksum(buffer, buf_cnt, &checksum);
+			/* calculate checksum of image, the target's comes below */
+			retval = image_calculate_checksum(buffer, buf_cnt, &info[num_regions].checksum);
 			if (retval != ERROR_OK) {
 				free(buffer);
 				break;
 			}
-
-			retval = target_checksum_memory(target, image.sections[i].base_address, buf_cnt, &mem_checksum);
-			if (retval != ERROR_OK) {
-				free(buffer);
-				break;
-			}
-			if ((checksum != mem_checksum) && (verify == IMAGE_CHECKSUM_ONLY)) {
-				LOG_ERROR("checksum mismatch");
-				free(buffer);
-				retval = ERROR_FAIL;
-				goto done;
-			}
-			if (checksum != mem_checksum) {
-				/* failed crc checksum, fall back to a binary compare */
-				uint8_t *data;
-
-				if (diffs == 0)
-					LOG_ERROR("checksum mismatch - attempting binary compare");
-
-				data = malloc(buf_cnt);
-
-				/* Can we use 32bit word accesses? */
-				int size = 1;
-				int count = buf_cnt;
-				if ((count % 4) == 0) {
-					size *= 4;
-					count /= 4;
-				}
-				retval = target_read_memory(target, image.sections[i].base_address, size, count, data);
-				if (retval == ERROR_OK) {
-					uint32_t t;
-					for (t = 0; t < buf_cnt; t++) {
-						if (data[t] != buffer[t]) {
-							command_print(CMD_CTX,
-										  "diff %d address 0x%08x. Was 0x%02x instead of 0x%02x",
-										  diffs,
-										  (unsigned)(t + image.sections[i].base_address),
-										  data[t],
-										  buffer[t]);
-							if (diffs++ >= 127) {
-								command_print(CMD_CTX, "More than 128 errors, the rest are not printed.");
-								free(data);
-								free(buffer);
-								goto done;
-							}
-						}
-						keep_alive();
-					}
-				}
-				free(data);
-			}
+			info[num_regions].first = i;
+			info[num_regions].sections = sections;
+			regions[num_regions].address = address;
+			regions[num_regions].size = buf_cnt;
+			num_regions++;
 		} else {
 			command_print(CMD_CTX, "address " TARGET_ADDR_FMT " length 0x%08zx",
 						  image.sections[i].base_address,
@@ -3545,6 +3807,39 @@ static COMMAND_HELPER(handle_verify_image_command_internal, enum verify_mode ver
 		free(buffer);
 		image_size += buf_cnt;
 	}
+
+	/* checksum all regions with one upload (and, where the target
+	 * supports it, one run) of the CRC algorithm */
+	if (retval == ERROR_OK && num_regions > 0)
+		retval = target_checksum_memory_regions(target, regions, num_regions);
+
+	for (int r = 0; retval == ERROR_OK && r < num_regions; r++) {
+		if (regions[r].checksum == info[r].checksum)
+			continue;
+
+		if (verify == IMAGE_CHECKSUM_ONLY) {
+			LOG_ERROR("checksum mismatch");
+			retval = ERROR_FAIL;
+			goto done;
+		}
+
+		/* failed crc checksum, fall back to a binary compare */
+		if (diffs == 0)
+			LOG_ERROR("checksum mismatch - attempting binary compare");
+
+		retval = verify_image_read(CMD_CTX, &image, info[r].first, info[r].sections,
+				regions[r].size, &buffer, &buf_cnt);
+		if (retval != ERROR_OK)
+			break;
+
+		retval = verify_image_compare(CMD_CTX, target, regions[r].address,
+				buffer, buf_cnt, &diffs);
+		free(buffer);
+		if (diffs >= VERIFY_IMAGE_MAX_DIFFS) {
+			command_print(CMD_CTX, "More than 128 errors, the rest are not printed.");
+			goto done;
+		}
+	}
 	if (diffs > 0)
 		command_print(CMD_CTX, "No more differences found.");
 done:
@@ -3556,6 +3851,8 @@ done:
 				duration_elapsed(&bench), duration_kbps(&bench, image_size));
 	}
 
+	free(regions);
+	free(info);
 	image_close(&image);
 
 	return retval;
@@ -6367,7 +6664,7 @@ static const struct command_registration target_exec_command_handlers[] = {
 		.name = "dump_image",
 		.handler = handle_dump_image_command,
 		.mode = COMMAND_EXEC,
-		.usage = "filename address size",
+		.usage = "filename address size [bin|ihex] [sparse]",
 	},
 	{
 		.name = "verify_image_checksum",
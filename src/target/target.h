@@ -101,6 +101,13 @@ struct working_area {
 	struct working_area *next;
 };
 
+/** A memory region and its CRC32, see target_checksum_memory_regions(). */
+struct target_checksum_region {
+	target_addr_t address;
+	uint32_t size;
+	uint32_t checksum;
+};
+
 struct gdb_service {
 	struct target *target;
 	/*  field for smp display  */
@@ -587,6 +594,13 @@ int target_read_buffer(struct target *target,
 		target_addr_t address, uint32_t size, uint8_t *buffer);
 int target_checksum_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *crc);
+/**
+ * Fill in the checksum of each of @a num_regions regions.  Targets with a
+ * checksum_memory_regions method do this with one algorithm run, others
+ * checksum the regions one by one.
+ */
+int target_checksum_memory_regions(struct target *target,
+		struct target_checksum_region *regions, unsigned int num_regions);
 int target_blank_check_memory(struct target *target,
 		target_addr_t address, uint32_t size, uint32_t *blank, uint8_t erased_value);
 int target_wait_state(struct target *target, enum target_state state, int ms);
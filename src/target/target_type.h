@@ -28,6 +28,7 @@
 #include <jim-nvp.h>
 
 struct target;
+struct target_checksum_region;
 
 /**
  * This holds methods shared between all instances of a given target
@@ -130,6 +131,10 @@ struct target_type {
 
 	int (*checksum_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *checksum);
+	/* optional, checksum several regions at once; on failure every region
+	 * goes through checksum_memory */
+	int (*checksum_memory_regions)(struct target *target,
+			struct target_checksum_region *regions, unsigned int num_regions);
 	int (*blank_check_memory)(struct target *target, target_addr_t address,
 			uint32_t count, uint32_t *blank, uint8_t erased_value);
 
@@ -45,9 +45,9 @@ static int set_debug_regs(struct target *t, uint32_t address,
 			uint8_t bp_num, uint8_t bp_type, uint8_t bp_length);
 static int unset_debug_regs(struct target *t, uint8_t bp_num);
 static int read_mem(struct target *t, uint32_t size,
-			uint32_t addr, uint8_t *buf);
+			uint32_t addr, uint32_t count, uint8_t *buf);
 static int write_mem(struct target *t, uint32_t size,
-			uint32_t addr, const uint8_t *buf);
+			uint32_t addr, uint32_t count, const uint8_t *buf);
 static int calcaddr_physfromlin(struct target *t, target_addr_t addr,
 			target_addr_t *physaddr);
 static int read_phys_mem(struct target *t, uint32_t phys_address,
@@ -194,21 +194,13 @@ static int read_phys_mem(struct target *t, uint32_t phys_address,
 		pg_disabled = true;
 	}
 
-	for (uint32_t i = 0; i < count; i++) {
-		switch (size) {
-		case BYTE:
-			retval = read_mem(t, size, phys_address + i, buffer + i);
-			break;
-		case WORD:
-			retval = read_mem(t, size, phys_address + i * 2, buffer + i * 2);
-			break;
-		case DWORD:
-			retval = read_mem(t, size, phys_address + i * 4, buffer + i * 4);
-			break;
-		default:
-			LOG_ERROR("%s invalid read size", __func__);
-			break;
-		}
+	if (size != BYTE && size != WORD && size != DWORD) {
+		LOG_ERROR("%s invalid read size", __func__);
+		retval = ERROR_FAIL;
+	}
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i += MEM_BATCH) {
+		uint32_t n = MIN(count - i, MEM_BATCH);
+		retval = read_mem(t, size, phys_address + i * size, n, buffer + i * size);
 	}
 	/* restore CR0.PG bit if needed (regardless of retval) */
 	if (pg_disabled) {
@@ -300,21 +292,13 @@ static int write_phys_mem(struct target *t, uint32_t phys_address,
 		}
 		pg_disabled = true;
 	}
-	for (uint32_t i = 0; i < count; i++) {
-		switch (size) {
-		case BYTE:
-			retval = write_mem(t, size, phys_address + i, buffer + i);
-			break;
-		case WORD:
-			retval = write_mem(t, size, phys_address + i * 2, buffer + i * 2);
-			break;
-		case DWORD:
-			retval = write_mem(t, size, phys_address + i * 4, buffer + i * 4);
-			break;
-		default:
-			LOG_DEBUG("invalid read size");
-			break;
-		}
+	if (size != BYTE && size != WORD && size != DWORD) {
+		LOG_ERROR("%s invalid write size", __func__);
+		retval = ERROR_FAIL;
+	}
+	for (uint32_t i = 0; i < count && retval == ERROR_OK; i += MEM_BATCH) {
+		uint32_t n = MIN(count - i, MEM_BATCH);
+		retval = write_mem(t, size, phys_address + i * size, n, buffer + i * size);
 	}
 	/* restore CR0.PG bit if needed (regardless of retval) */
 	if (pg_disabled) {
@@ -327,121 +311,153 @@ static int write_phys_mem(struct target *t, uint32_t phys_address,
 	return retval;
 }
 
-static int read_mem(struct target *t, uint32_t size,
-			uint32_t addr, uint8_t *buf)
+/*
+ * Flush the batched probemode scans and check the transaction status
+ * captured for each of the count accesses, in order.
+ */
+static int mem_batch_status(struct target *t, uint32_t count,
+			uint8_t tapstatus[][4])
 {
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
-
-	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
-	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
-	int retval = x86_32->write_hw_reg(t, EAX, addr, 0);
+	int retval = jtag_execute_queue();
 	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error write EAX", __func__);
+		LOG_ERROR("%s failed to execute queue", __func__);
 		return retval;
 	}
+	for (uint32_t i = 0; i < count; i++) {
+		retval = x86_32->check_transaction_status(t,
+				buf_get_u32(tapstatus[i], 0, 32));
+		if (retval != ERROR_OK)
+			return retval;
+	}
+	return ERROR_OK;
+}
 
+/*
+ * Read count (at most MEM_BATCH) consecutive items of size bytes. All
+ * the probemode scans are queued first, including the EDX and TAPSTATUS
+ * captures, so the whole batch costs a single queue flush.
+ */
+static int read_mem(struct target *t, uint32_t size,
+			uint32_t addr, uint32_t count, uint8_t *buf)
+{
+	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t edx[MEM_BATCH][4];
+	uint8_t tapstatus[MEM_BATCH][4];
+	int instr;
+	int retval = ERROR_OK;
+
+	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
+	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
 	switch (size) {
 		case BYTE:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMRDB32);
-			else
-				retval = x86_32->submit_instruction(t, MEMRDB16);
+			instr = use32 ? MEMRDB32 : MEMRDB16;
 			break;
 		case WORD:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMRDH32);
-			else
-				retval = x86_32->submit_instruction(t, MEMRDH16);
+			instr = use32 ? MEMRDH32 : MEMRDH16;
 			break;
 		case DWORD:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMRDW32);
-			else
-				retval = x86_32->submit_instruction(t, MEMRDW16);
+			instr = use32 ? MEMRDW32 : MEMRDW16;
 			break;
 		default:
 			LOG_ERROR("%s invalid read mem size", __func__);
-			break;
+			return ERROR_FAIL;
 	}
 
-	/* read_hw_reg() will write to 4 bytes (uint32_t)
-	 * Watch out, the buffer passed into read_mem() might be 1 or 2 bytes.
-	 */
-	uint32_t regval;
-	retval = x86_32->read_hw_reg(t, EDX, &regval, 0);
-
-	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error read EDX", __func__);
-		return retval;
+	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	for (uint32_t i = 0; i < count; i++) {
+		retval = x86_32->write_hw_reg(t, EAX, addr + i * size, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error write EAX", __func__);
+			break;
+		}
+		retval = x86_32->submit_instruction(t, instr);
+		if (retval != ERROR_OK)
+			break;
+		/* EDX is captured as 4 bytes, even for byte and halfword reads */
+		retval = x86_32->queue_read_hw_reg(t, EDX, edx[i]);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error read EDX", __func__);
+			break;
+		}
+		retval = x86_32->queue_tapstatus(t, tapstatus[i]);
+		if (retval != ERROR_OK)
+			break;
 	}
-	for (uint8_t i = 0; i < size; i++)
-		buf[i] = (regval >> (i*8)) & 0x000000FF;
+	x86_32->flush = 1;
+	if (retval != ERROR_OK)
+		return retval;
 
-	retval = x86_32->transaction_status(t);
+	retval = mem_batch_status(t, count, tapstatus);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s error on mem read", __func__);
 		return retval;
 	}
-	return retval;
+	for (uint32_t i = 0; i < count; i++)
+		memcpy(buf + i * size, edx[i], size);
+	return ERROR_OK;
 }
 
+/* write count (at most MEM_BATCH) consecutive items, with one queue flush */
 static int write_mem(struct target *t, uint32_t size,
-			uint32_t addr, const uint8_t *buf)
+			uint32_t addr, uint32_t count, const uint8_t *buf)
 {
-	uint32_t i = 0;
-	uint32_t buf4bytes = 0;
-	int retval = ERROR_OK;
 	struct x86_32_common *x86_32 = target_to_x86_32(t);
+	uint8_t tapstatus[MEM_BATCH][4];
+	int instr;
+	int retval = ERROR_OK;
 
-	for (i = 0; i < size; ++i) {
-		buf4bytes = buf4bytes << 8; /* first time we only shift 0s */
-		buf4bytes += buf[(size-1)-i]; /* it was hard to write, should be hard to read! */
-	}
 	/* if CS.D bit=1 then its a 32 bit code segment, else 16 */
 	bool use32 = (buf_get_u32(x86_32->cache->reg_list[CSAR].value, 0, 32)) & CSAR_D;
-	retval = x86_32->write_hw_reg(t, EAX, addr, 0);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error write EAX", __func__);
-		return retval;
-	}
-
-	/* write_hw_reg() will write to 4 bytes (uint32_t)
-	 * Watch out, the buffer passed into write_mem() might be 1 or 2 bytes.
-	 */
-	retval = x86_32->write_hw_reg(t, EDX, buf4bytes, 0);
-	if (retval != ERROR_OK) {
-		LOG_ERROR("%s error write EDX", __func__);
-		return retval;
-	}
 	switch (size) {
 		case BYTE:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMWRB32);
-			else
-				retval = x86_32->submit_instruction(t, MEMWRB16);
+			instr = use32 ? MEMWRB32 : MEMWRB16;
 			break;
 		case WORD:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMWRH32);
-			else
-				retval = x86_32->submit_instruction(t, MEMWRH16);
+			instr = use32 ? MEMWRH32 : MEMWRH16;
 			break;
 		case DWORD:
-			if (use32)
-				retval = x86_32->submit_instruction(t, MEMWRW32);
-			else
-				retval = x86_32->submit_instruction(t, MEMWRW16);
+			instr = use32 ? MEMWRW32 : MEMWRW16;
 			break;
 		default:
 			LOG_ERROR("%s invalid write mem size", __func__);
 			return ERROR_FAIL;
 	}
-	retval = x86_32->transaction_status(t);
+
+	x86_32->flush = 0; /* dont flush scans till we have a batch */
+	for (uint32_t i = 0; i < count; i++) {
+		/* EDX is written as 4 bytes, even for byte and halfword writes */
+		uint32_t buf4bytes = 0;
+		for (uint32_t j = 0; j < size; ++j)
+			buf4bytes |= (uint32_t)buf[i * size + j] << (j * 8);
+
+		retval = x86_32->write_hw_reg(t, EAX, addr + i * size, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error write EAX", __func__);
+			break;
+		}
+		retval = x86_32->write_hw_reg(t, EDX, buf4bytes, 0);
+		if (retval != ERROR_OK) {
+			LOG_ERROR("%s error write EDX", __func__);
+			break;
+		}
+		retval = x86_32->submit_instruction(t, instr);
+		if (retval != ERROR_OK)
+			break;
+		retval = x86_32->queue_tapstatus(t, tapstatus[i]);
+		if (retval != ERROR_OK)
+			break;
+	}
+	x86_32->flush = 1;
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = mem_batch_status(t, count, tapstatus);
 	if (retval != ERROR_OK) {
 		LOG_ERROR("%s error on mem write", __func__);
 		return retval;
 	}
-	return retval;
+	return ERROR_OK;
 }
 
 int calcaddr_physfromlin(struct target *t, target_addr_t addr, target_addr_t *physaddr)
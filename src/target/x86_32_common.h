@@ -42,6 +42,7 @@ extern const struct command_registration x86_32_command_handlers[];
 #define BYTE			1
 #define WORD			2
 #define DWORD			4
+#define MEM_BATCH		64 /* accesses queued per scan flush */
 
 #define EFLAGS_TF		((uint32_t)0x00000100) /* Trap Flag */
 #define EFLAGS_IF		((uint32_t)0x00000200) /* Interrupt Flag */
@@ -241,6 +242,12 @@ struct x86_32_common {
 	int (*write_hw_reg)(struct target *t, int reg,
 				uint32_t regval, uint8_t cache);
 
+	/* queued variants, their results are only valid after the next
+	 * jtag_execute_queue(); used to batch block memory transfers */
+	int (*queue_read_hw_reg)(struct target *t, int reg, uint8_t *regval);
+	int (*queue_tapstatus)(struct target *t, uint8_t *tapstatus);
+	int (*check_transaction_status)(struct target *t, uint32_t tapstatus);
+
 	/* register cache to processor synchronization */
 	int (*read_hw_reg_to_cache)(struct target *target, int num);
 	int (*write_hw_reg_from_cache)(struct target *target, int num);
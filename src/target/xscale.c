@@ -306,18 +306,13 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 			break;
 		}
 
-		/* examine results */
+		/* examine results, keeping only the words that were valid */
+		int words_valid = words_done;
 		for (i = words_done; i < num_words; i++) {
-			if (!(field0[i] & 1)) {
-				/* move backwards if necessary */
-				int j;
-				for (j = i; j < num_words - 1; j++) {
-					field0[j] = field0[j + 1];
-					field1[j] = field1[j + 1];
-				}
-				words_scheduled--;
-			}
+			if (field0[i] & 1)
+				field1[words_valid++] = field1[i];
 		}
+		words_scheduled = words_valid - words_done;
 		if (words_scheduled == 0) {
 			if (attempts++ == 1000) {
 				LOG_ERROR(
@@ -333,6 +328,7 @@ static int xscale_receive(struct target *target, uint32_t *buffer, int num_words
 	for (i = 0; i < num_words; i++)
 		*(buffer++) = buf_get_u32((uint8_t *)&field1[i], 0, 32);
 
+	free(field0);
 	free(field1);
 
 	return retval;
@@ -503,12 +499,18 @@ done:
 	return ERROR_OK;
 }
 
-/* send count elements of size byte to the debug handler */
+/* send count elements of size byte to the debug handler
+ *
+ * The words are streamed in a single queue without waiting for the
+ * handler to consume each one.  The RX status captured by every scan is
+ * checked afterwards, to catch a word that overwrote an unread one.
+ */
 static int xscale_send(struct target *target, const uint8_t *buffer, int count, int size)
 {
 	struct xscale_common *xscale = target_to_xscale(target);
 	int retval;
 	int done_count = 0;
+	uint8_t *rx_status;
 
 	xscale_jtag_set_instr(target->tap,
 		XSCALE_DBGRX << xscale->xscale_variant,
@@ -523,8 +525,12 @@ static int xscale_send(struct target *target, const uint8_t *buffer, int count,
 			{ .num_bits = 1, .out_value = &t2 },
 	};
 
+	rx_status = malloc(count);
+	if (rx_status == NULL)
+		return ERROR_FAIL;
+
 	int endianness = target->endianness;
-	while (done_count++ < count) {
+	for (done_count = 0; done_count < count; done_count++) {
 		uint32_t t;
 
 		switch (size) {
@@ -545,11 +551,13 @@ static int xscale_send(struct target *target, const uint8_t *buffer, int count,
 				break;
 			default:
 				LOG_ERROR("BUG: size neither 4, 2 nor 1");
+				free(rx_status);
 				return ERROR_COMMAND_SYNTAX_ERROR;
 		}
 
 		buf_set_u32(t1, 0, 32, t);
 
+		fields[0].in_value = &rx_status[done_count];
 		jtag_add_dr_scan(target->tap,
 			3,
 			fields,
@@ -560,10 +568,23 @@ static int xscale_send(struct target *target, const uint8_t *buffer, int count,
 	retval = jtag_execute_queue();
 	if (retval != ERROR_OK) {
 		LOG_ERROR("JTAG error while sending data to debug handler");
+		free(rx_status);
 		return retval;
 	}
 
-	return ERROR_OK;
+	/* rx_read still set when a word was shifted in means the previous
+	 * one had not been consumed yet */
+	for (done_count = 0; done_count < count; done_count++) {
+		if (rx_status[done_count] & 1) {
+			LOG_ERROR("debug handler overrun at word %i of %i", done_count, count);
+			retval = ERROR_TARGET_TIMEOUT;
+			break;
+		}
+	}
+
+	free(rx_status);
+
+	return retval;
 }
 
 static int xscale_send_u32(struct target *target, uint32_t value)
@@ -574,6 +595,18 @@ static int xscale_send_u32(struct target *target, uint32_t value)
 	return xscale_write_rx(target);
 }
 
+/* send the address and count of a memory request in one burst; the
+ * command word before it went through the RX handshake */
+static int xscale_send_request(struct target *target, uint32_t address, uint32_t count)
+{
+	uint8_t buf[8];
+
+	target_buffer_set_u32(target, buf, address);
+	target_buffer_set_u32(target, buf + 4, count);
+
+	return xscale_send(target, buf, 2, 4);
+}
+
 static int xscale_write_dcsr(struct target *target, int hold_rst, int ext_dbg_brk)
 {
 	struct xscale_common *xscale = target_to_xscale(target);
@@ -643,6 +676,7 @@ static unsigned int parity(unsigned int v)
 	return (0x6996 >> v) & 1;
 }
 
+/* queue loading a cache line into the mini i-cache, the caller flushes */
 static int xscale_load_ic(struct target *target, uint32_t va, uint32_t buffer[8])
 {
 	struct xscale_common *xscale = target_to_xscale(target);
@@ -694,7 +728,7 @@ static int xscale_load_ic(struct target *target, uint32_t va, uint32_t buffer[8]
 		jtag_add_dr_scan(target->tap, 2, fields, TAP_IDLE);
 	}
 
-	return jtag_execute_queue();
+	return ERROR_OK;
 }
 
 static int xscale_invalidate_ic_line(struct target *target, uint32_t va)
@@ -727,42 +761,57 @@ static int xscale_invalidate_ic_line(struct target *target, uint32_t va)
 	return ERROR_OK;
 }
 
-static int xscale_update_vectors(struct target *target)
+/* read exception vectors 1..7 at base, trying one block read first */
+static int xscale_read_vectors(struct target *target, uint32_t base,
+	uint32_t *vectors, uint8_t static_set, const uint32_t *static_vectors)
 {
-	struct xscale_common *xscale = target_to_xscale(target);
+	uint8_t buf[7 * 4];
 	int i;
-	int retval;
+	int retval = ERROR_FAIL;
 
-	uint32_t low_reset_branch, high_reset_branch;
+	if ((static_set & 0xfe) != 0xfe) {
+		retval = target_read_memory(target, base + 4, 4, 7, buf);
+		if (retval == ERROR_TARGET_TIMEOUT)
+			return retval;
+	}
 
 	for (i = 1; i < 8; i++) {
 		/* if there's a static vector specified for this exception, override */
-		if (xscale->static_high_vectors_set & (1 << i))
-			xscale->high_vectors[i] = xscale->static_high_vectors[i];
+		if (static_set & (1 << i))
+			vectors[i] = static_vectors[i];
+		else if (retval == ERROR_OK)
+			vectors[i] = target_buffer_get_u32(target, buf + 4 * (i - 1));
 		else {
-			retval = target_read_u32(target, 0xffff0000 + 4*i, &xscale->high_vectors[i]);
-			if (retval == ERROR_TARGET_TIMEOUT)
-				return retval;
-			if (retval != ERROR_OK) {
+			/* the block read faulted, find out which vectors are readable */
+			int retval2 = target_read_u32(target, base + 4*i, &vectors[i]);
+			if (retval2 == ERROR_TARGET_TIMEOUT)
+				return retval2;
+			if (retval2 != ERROR_OK) {
 				/* Some of these reads will fail as part of normal execution */
-				xscale->high_vectors[i] = ARMV4_5_B(0xfffffe, 0);
+				vectors[i] = ARMV4_5_B(0xfffffe, 0);
 			}
 		}
 	}
 
-	for (i = 1; i < 8; i++) {
-		if (xscale->static_low_vectors_set & (1 << i))
-			xscale->low_vectors[i] = xscale->static_low_vectors[i];
-		else {
-			retval = target_read_u32(target, 0x0 + 4*i, &xscale->low_vectors[i]);
-			if (retval == ERROR_TARGET_TIMEOUT)
-				return retval;
-			if (retval != ERROR_OK) {
-				/* Some of these reads will fail as part of normal execution */
-				xscale->low_vectors[i] = ARMV4_5_B(0xfffffe, 0);
-			}
-		}
-	}
+	return ERROR_OK;
+}
+
+static int xscale_update_vectors(struct target *target)
+{
+	struct xscale_common *xscale = target_to_xscale(target);
+	int retval;
+
+	uint32_t low_reset_branch, high_reset_branch;
+
+	retval = xscale_read_vectors(target, 0xffff0000, xscale->high_vectors,
+			xscale->static_high_vectors_set, xscale->static_high_vectors);
+	if (retval != ERROR_OK)
+		return retval;
+
+	retval = xscale_read_vectors(target, 0x0, xscale->low_vectors,
+			xscale->static_low_vectors_set, xscale->static_low_vectors);
+	if (retval != ERROR_OK)
+		return retval;
 
 	/* calculate branches to debug handler */
 	low_reset_branch = (xscale->handler_address + 0x20 - 0x0 - 0x8) >> 2;
@@ -771,6 +820,13 @@ static int xscale_update_vectors(struct target *target)
 	xscale->low_vectors[0] = ARMV4_5_B((low_reset_branch & 0xffffff), 0);
 	xscale->high_vectors[0] = ARMV4_5_B((high_reset_branch & 0xffffff), 0);
 
+	/* the mini i-cache keeps its lines until reset or until we reload
+	 * them, so skip the reload if nothing changed */
+	if (xscale->ic_vectors_valid
+			&& !memcmp(xscale->ic_low_vectors, xscale->low_vectors, sizeof(xscale->low_vectors))
+			&& !memcmp(xscale->ic_high_vectors, xscale->high_vectors, sizeof(xscale->high_vectors)))
+		return ERROR_OK;
+
 	/* invalidate and load exception vectors in mini i-cache */
 	xscale_invalidate_ic_line(target, 0x0);
 	xscale_invalidate_ic_line(target, 0xffff0000);
@@ -778,6 +834,15 @@ static int xscale_update_vectors(struct target *target)
 	xscale_load_ic(target, 0x0, xscale->low_vectors);
 	xscale_load_ic(target, 0xffff0000, xscale->high_vectors);
 
+	xscale->ic_vectors_valid = 0;
+	retval = jtag_execute_queue();
+	if (retval != ERROR_OK)
+		return retval;
+
+	memcpy(xscale->ic_low_vectors, xscale->low_vectors, sizeof(xscale->low_vectors));
+	memcpy(xscale->ic_high_vectors, xscale->high_vectors, sizeof(xscale->high_vectors));
+	xscale->ic_vectors_valid = 1;
+
 	return ERROR_OK;
 }
 
@@ -1517,6 +1582,9 @@ static int xscale_deassert_reset(struct target *target)
 
 	register_cache_invalidate(xscale->arm.core_cache);
 
+	/* reset invalidates the mini i-cache */
+	xscale->ic_vectors_valid = 0;
+
 	/* FIXME mark hardware watchpoints got unset too.  Also,
 	 * at least some of the XScale registers are invalid...
 	 */
@@ -1590,6 +1658,15 @@ static int xscale_deassert_reset(struct target *target)
 		if (retval != ERROR_OK)
 			return retval;
 
+		/* the whole handler and both vector lines go out in one queue */
+		retval = jtag_execute_queue();
+		if (retval != ERROR_OK)
+			return retval;
+
+		memcpy(xscale->ic_low_vectors, xscale->low_vectors, sizeof(xscale->low_vectors));
+		memcpy(xscale->ic_high_vectors, xscale->high_vectors, sizeof(xscale->high_vectors));
+		xscale->ic_vectors_valid = 1;
+
 		jtag_add_runtest(30, TAP_IDLE);
 
 		jtag_add_sleep(100000);
@@ -1810,13 +1887,8 @@ static int xscale_read_memory(struct target *target, target_addr_t address,
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* send base address for read request */
-	retval = xscale_send_u32(target, address);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* send number of requested data words */
-	retval = xscale_send_u32(target, count);
+	/* send base address and number of requested data words */
+	retval = xscale_send_request(target, address, count);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -1904,18 +1976,15 @@ static int xscale_write_memory(struct target *target, target_addr_t address,
 	if (((size == 4) && (address & 0x3u)) || ((size == 2) && (address & 0x1u)))
 		return ERROR_TARGET_UNALIGNED_ACCESS;
 
+	arm_sim_cache_invalidate(&xscale->arm, address, size * count);
+
 	/* send memory write request (command 0x2n, n: access size) */
 	retval = xscale_send_u32(target, 0x20 | size);
 	if (retval != ERROR_OK)
 		return retval;
 
-	/* send base address for read request */
-	retval = xscale_send_u32(target, address);
-	if (retval != ERROR_OK)
-		return retval;
-
-	/* send number of requested data words to be written*/
-	retval = xscale_send_u32(target, count);
+	/* send base address and number of data words to be written */
+	retval = xscale_send_request(target, address, count);
 	if (retval != ERROR_OK)
 		return retval;
 
@@ -2910,6 +2979,13 @@ static int xscale_init_target(struct command_context *cmd_ctx,
 	return ERROR_OK;
 }
 
+static void xscale_deinit_target(struct target *target)
+{
+	struct xscale_common *xscale = target_to_xscale(target);
+
+	arm_sim_cache_release(&xscale->arm);
+}
+
 static int xscale_init_arch_info(struct target *target,
 	struct xscale_common *xscale, struct jtag_tap *tap)
 {
@@ -3712,6 +3788,7 @@ struct target_type xscale_target = {
 	.write_phys_memory = xscale_write_phys_memory,
 
 	.checksum_memory = arm_checksum_memory,
+	.checksum_memory_regions = arm_checksum_memory_regions,
 	.blank_check_memory = arm_blank_check_memory,
 
 	.run_algorithm = armv4_5_run_algorithm,
@@ -3724,6 +3801,7 @@ struct target_type xscale_target = {
 	.commands = xscale_command_handlers,
 	.target_create = xscale_target_create,
 	.init_target = xscale_init_target,
+	.deinit_target = xscale_deinit_target,
 
 	.virt2phys = xscale_virt2phys,
 	.mmu = xscale_mmu
@@ -97,6 +97,11 @@ struct xscale_common {
 	uint32_t low_vectors[8];
 	uint32_t high_vectors[8];
 
+	/* exception vectors last loaded into the mini i-cache */
+	int ic_vectors_valid;
+	uint32_t ic_low_vectors[8];
+	uint32_t ic_high_vectors[8];
+
 	/* static low vectors */
 	uint8_t static_low_vectors_set;	/* bit field with static vectors set by the user */
 	uint8_t static_high_vectors_set; /* bit field with static vectors set by the user */
@@ -0,0 +1,246 @@
+# Throughput and latency benchmarks for the currently selected target.
+#
+# Usage, after the interface/target configuration and "init":
+#
+#   source [find tools/benchmark.tcl]
+#   bench_memory 0x20000000 0x4000
+#   bench_image  /tmp/bench.bin 0x20000000 0x4000
+#   bench_flash  /tmp/bench.bin 0 0x08000000 0x4000
+#   bench_run_control 100
+#   bench_report
+#   bench_save /tmp/bench-baseline.txt
+#
+# Every measurement is emitted as one JSON object per line prefixed with
+# "BENCH ", so results can be grepped out of the log and compared between
+# builds. bench_report appends the internal "perf json" counters, which
+# include GDB packet service latency by packet type.
+#
+# bench_save stores the results of this run as a baseline; a later run
+# ending in "bench_compare /tmp/bench-baseline.txt 10" fails when any
+# result is more than 10% slower than the baseline, so a regression check
+# can be scripted as
+#
+#   openocd -f board.cfg -c init -c "source [find tools/benchmark.tcl]" \
+#	-c "bench_memory 0x20000000 0x4000; bench_compare base.txt 10" \
+#	-c shutdown
+#
+# which exits nonzero on regression.
+#
+# The memory benchmarks need RAM (e.g. the work area) that may be
+# clobbered; bench_flash erases and reprograms the given range.
+
+set BENCH_REPEAT 4
+
+# results of this run, "name,key=value,..." -> {ms kbps}
+array set BENCH_RESULTS {}
+
+# the key identifying a result: its name and every field but the metrics
+proc bench_key {name fields} {
+	set key [list $name]
+	foreach {k v} $fields {
+		if {$k ni {ms kbps}} {
+			lappend key "$k=$v"
+		}
+	}
+	return [join $key ,]
+}
+
+proc bench_emit {name args} {
+	global BENCH_RESULTS
+	set fields [list "\"bench\":\"$name\""]
+	set ms ""
+	set kbps ""
+	foreach {key value} $args {
+		if {[string is double -strict $value]} {
+			lappend fields "\"$key\":$value"
+		} else {
+			lappend fields "\"$key\":\"$value\""
+		}
+		if {$key eq "ms"} {
+			set ms $value
+		} elseif {$key eq "kbps"} {
+			set kbps $value
+		}
+	}
+	echo "BENCH \{[join $fields ,]\}"
+	if {$ms ne ""} {
+		set BENCH_RESULTS([bench_key $name $args]) [list $ms $kbps]
+	}
+}
+
+# Run "script" BENCH_REPEAT times and return the elapsed time per run in ms
+proc bench_time {script} {
+	global BENCH_REPEAT
+	set start [ms]
+	for {set i 0} {$i < $BENCH_REPEAT} {incr i} {
+		uplevel 1 $script
+	}
+	return [expr {double([ms] - $start) / $BENCH_REPEAT}]
+}
+
+proc bench_kbps {bytes t} {
+	if {$t <= 0} {
+		return 0
+	}
+	return [format %.1f [expr {$bytes / 1.024 / $t}]]
+}
+
+# target_read_memory/target_write_memory (md and mw) at each access size
+# and at each byte offset from "address"; an access the target rejects as
+# unaligned is reported with an "error" field instead of a time
+proc bench_memory {address size} {
+	set len [expr {$size - 4}]
+	foreach align {0 1 2 3} {
+		set a [expr {$address + $align}]
+		foreach {width suffix value} {8 b 0x5a 16 h 0x5aa5 32 w 0x5aa5c33c} {
+			set count [expr {$len / ($width / 8)}]
+			set bytes [expr {$count * ($width / 8)}]
+
+			if {[catch {bench_time {mw$suffix $a $value $count}} t]} {
+				bench_emit write_memory width $width align $align error $t
+			} else {
+				bench_emit write_memory width $width align $align bytes $bytes \
+					ms $t kbps [bench_kbps $bytes $t]
+			}
+
+			if {[catch {bench_time {capture "md$suffix $a $count"}} t]} {
+				bench_emit read_memory width $width align $align error $t
+			} else {
+				bench_emit read_memory width $width align $align bytes $bytes \
+					ms $t kbps [bench_kbps $bytes $t]
+			}
+		}
+	}
+}
+
+# target_read_buffer/target_write_buffer paths (dump_image, load_image,
+# verify_image) at every byte alignment; uses "file" as scratch space
+proc bench_image {file address size} {
+	foreach align {0 1 2 3} {
+		set a [expr {$address + $align}]
+		set len [expr {$size - 4}]
+
+		set t [bench_time {dump_image $file $a $len}]
+		bench_emit dump_image align $align bytes $len ms $t kbps [bench_kbps $len $t]
+
+		set t [bench_time {load_image $file $a bin}]
+		bench_emit load_image align $align bytes $len ms $t kbps [bench_kbps $len $t]
+
+		set t [bench_time {verify_image $file $a bin}]
+		bench_emit verify_image align $align bytes $len ms $t kbps [bench_kbps $len $t]
+	}
+}
+
+# erase, program, read and verify "size" bytes at "address" of flash bank
+# "bank"; uses "file" as scratch space
+proc bench_flash {file bank address size} {
+	set offset [expr {$address - [lindex [lindex [flash list] $bank] 3]}]
+
+	set start [ms]
+	flash erase_address $address $size
+	set t [expr {[ms] - $start}]
+	bench_emit flash_erase bank $bank bytes $size ms $t kbps [bench_kbps $size $t]
+
+	set start [ms]
+	flash fillw $address 0x5aa5c33c [expr {$size / 4}]
+	set t [expr {[ms] - $start}]
+	bench_emit flash_program bank $bank bytes $size ms $t kbps [bench_kbps $size $t]
+
+	set t [bench_time {flash read_bank $bank $file $offset $size}]
+	bench_emit flash_read bank $bank bytes $size ms $t kbps [bench_kbps $size $t]
+
+	set t [bench_time {flash verify_bank $bank $file $offset}]
+	bench_emit flash_verify bank $bank bytes $size ms $t kbps [bench_kbps $size $t]
+}
+
+# halt, single step and resume latency, averaged over "iterations"
+proc bench_run_control {iterations} {
+	halt
+
+	set start [ms]
+	for {set i 0} {$i < $iterations} {incr i} {
+		step
+	}
+	bench_emit step iterations $iterations \
+		ms [expr {double([ms] - $start) / $iterations}]
+
+	set start [ms]
+	for {set i 0} {$i < $iterations} {incr i} {
+		resume
+		halt
+	}
+	bench_emit resume_halt iterations $iterations \
+		ms [expr {double([ms] - $start) / $iterations}]
+}
+
+# dump the perf counters gathered while the benchmarks ran
+proc bench_report {} {
+	echo "BENCH_PERF [string trim [capture {perf json}]]"
+}
+
+# write the results of this run to "file", one "key ms kbps" list per line
+proc bench_save {file} {
+	global BENCH_RESULTS
+	set f [open $file w]
+	foreach key [lsort [array names BENCH_RESULTS]] {
+		puts $f [concat [list $key] $BENCH_RESULTS($key)]
+	}
+	close $f
+}
+
+# compare the results of this run against a baseline written by bench_save;
+# a result is a regression when its throughput (or, without one, its time)
+# is more than "threshold" percent worse than the baseline, and any
+# regression makes the command fail
+proc bench_compare {file {threshold 10}} {
+	global BENCH_RESULTS
+	set f [open $file r]
+	set regressions 0
+	while {[gets $f line] >= 0} {
+		if {[llength $line] != 3} {
+			continue
+		}
+		lassign $line key base_ms base_kbps
+		if {![info exists BENCH_RESULTS($key)]} {
+			continue
+		}
+		lassign $BENCH_RESULTS($key) ms kbps
+
+		if {$kbps ne "" && $base_kbps ne "" && $base_kbps > 0} {
+			set change [expr {100.0 * ($base_kbps - $kbps) / $base_kbps}]
+		} elseif {$base_ms > 0} {
+			set change [expr {100.0 * ($ms - $base_ms) / $base_ms}]
+		} else {
+			continue
+		}
+
+		if {$change > $threshold} {
+			set status regression
+			incr regressions
+		} else {
+			set status ok
+		}
+		echo [format "BENCH_CMP %s %s baseline %s ms current %s ms slowdown %.1f%%" \
+			$status $key $base_ms $ms $change]
+	}
+	close $f
+
+	if {$regressions > 0} {
+		error "$regressions benchmark(s) more than $threshold% slower than $file"
+	}
+}
+
+add_help_text bench_memory "measure md/mw throughput at each access size and byte offset"
+add_usage_text bench_memory "address size"
+add_help_text bench_image "measure dump_image/load_image/verify_image throughput at each alignment"
+add_usage_text bench_image "scratch_file address size"
+add_help_text bench_flash "measure flash erase/program/read/verify throughput"
+add_usage_text bench_flash "scratch_file bank address size"
+add_help_text bench_run_control "measure step and resume/halt latency"
+add_usage_text bench_run_control "iterations"
+add_help_text bench_report "print the perf counters as a BENCH_PERF line"
+add_usage_text bench_report ""
+add_help_text bench_save "write the results of this run to a baseline file"
+add_usage_text bench_save "file"
+add_help_text bench_compare "fail if any result is more than threshold percent slower than the baseline"
+add_usage_text bench_compare "file \[threshold_percent\]"